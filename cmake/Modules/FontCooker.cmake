@@ -0,0 +1,37 @@
+
+# Builds the font cooker for the host, the main project may be cross compiling to WASM
+set(FONT_COOKER_DIR "${CMAKE_BINARY_DIR}/font_cooker")
+if(CMAKE_HOST_WIN32)
+    set(FONT_COOKER_EXE "${FONT_COOKER_DIR}/cook_font.exe")
+else()
+    set(FONT_COOKER_EXE "${FONT_COOKER_DIR}/cook_font")
+endif()
+
+ExternalProject_Add(font_cooker
+    SOURCE_DIR "${CMAKE_SOURCE_DIR}/tools/font_cooker"
+    BINARY_DIR "${FONT_COOKER_DIR}"
+    CMAKE_ARGS "-DCMAKE_BUILD_TYPE=Release"
+    INSTALL_COMMAND ""
+    BUILD_ALWAYS ON
+    BUILD_BYPRODUCTS "${FONT_COOKER_EXE}")
+
+function(font_cook OUTPUT FONT_FILE OUT_DIR)
+    get_filename_component(NAME "${FONT_FILE}" NAME_WE)
+
+    set(METRICS_FILE ${OUT_DIR}/${NAME}.font)
+    set(IMAGE_FILE ${OUT_DIR}/${NAME}.png)
+
+    add_custom_command(
+        OUTPUT "${METRICS_FILE}" "${IMAGE_FILE}"
+        COMMAND ${CMAKE_COMMAND} -E make_directory "${OUT_DIR}"
+        COMMAND "${FONT_COOKER_EXE}"
+            "${FONT_FILE}"
+            "${OUT_DIR}"
+            --name "${NAME}"
+            --ranges "${EMBER_FONT_GLYPH_RANGES}"
+            --page-size ${EMBER_FONT_PAGE_SIZE}
+        COMMENT "Cooking font ${NAME}"
+        DEPENDS "${FONT_FILE}" "${FONT_COOKER_EXE}" font_cooker)
+
+    set(${OUTPUT} "${METRICS_FILE}" "${IMAGE_FILE}" PARENT_SCOPE)
+endfunction()
@@ -0,0 +1,21 @@
+
+function(texture_atlas_pack OUTPUT NAME TEXTURE_DIR OUT_DIR)
+    file(GLOB TEXTURE_FILES CONFIGURE_DEPENDS "${TEXTURE_DIR}/*.png")
+
+    set(TABLE_FILE ${OUT_DIR}/${NAME}.json)
+
+    # Page count depends on the inputs, pages are written next to the table
+    add_custom_command(
+        OUTPUT "${TABLE_FILE}"
+        COMMAND "${Python_EXECUTABLE}"
+            "${ATLAS_PACKER_PY}"
+            "${OUT_DIR}"
+            ${TEXTURE_FILES}
+            --name "${NAME}"
+            --page-size ${EMBER_ATLAS_PAGE_SIZE}
+            --max-size ${EMBER_ATLAS_MAX_TEXTURE_SIZE}
+        COMMENT "Packing texture atlas ${NAME}"
+        DEPENDS ${TEXTURE_FILES} "${ATLAS_PACKER_PY}")
+
+    set(${OUTPUT} "${TABLE_FILE}" PARENT_SCOPE)
+endfunction()
@@ -1,13 +1,27 @@
-local visitor = require('visitor')
-
 local scripting = {}
 
+local scripts_query = nil
+local scripts_query_db = nil
+
+-- Actor modules by script name, avoids building the require path every tick
+local actors = setmetatable({}, {
+    __index = function (t, name)
+        local impl = require('actors.' .. name)
+        t[name] = impl
+        return impl
+    end
+})
+
 function scripting.visit(delta)
-    visitor.visit(
-        entities,
-        {component.script},
+    -- Queries are bound to a database, so rebuild when a new scene replaces it
+    if not rawequal(scripts_query_db, entities) then
+        scripts_query = entities:query({component.script})
+        scripts_query_db = entities
+    end
+
+    scripts_query:each(
         function (eid, script)
-            local script_impl = require('actors.' .. script.name)
+            local script_impl = actors[script.name]
             if script_impl.update then
                 local success, ret = pcall(script_impl.update, eid, delta)
                 if not success then
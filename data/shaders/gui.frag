@@ -0,0 +1,29 @@
+#extension GL_OES_standard_derivatives : enable
+precision mediump float;
+
+varying vec2 v_texcoord;
+varying vec4 v_color;
+varying vec2 v_msdf_unit; /** pxRange/texSize for MSDF glyphs, zero for plain textured quads */
+
+uniform sampler2D s_texture;
+
+float median(float r, float g, float b) {
+    return max(min(r, g), min(max(r, g), b));
+}
+
+void main() {
+    vec4 sample = texture2D(s_texture, v_texcoord);
+
+    if (v_msdf_unit.x > 0.0) {
+        float sigDist = median(sample.r, sample.g, sample.b) - 0.5;
+        sigDist *= dot(v_msdf_unit, 0.5/fwidth(v_texcoord));
+        float opacity = clamp(sigDist + 0.5, 0.0, 1.0);
+        gl_FragColor = vec4(v_color.rgb, v_color.a*opacity);
+    } else {
+        vec4 color = sample * v_color;
+
+        if (color.a < 1.0/255.0) discard;
+
+        gl_FragColor = color;
+    }
+}
@@ -0,0 +1,19 @@
+attribute vec3 VertexPosition;
+attribute vec2 VertexTexCoord;
+
+// Per vertex, so quads with different colors and glyph sizes share a draw call
+attribute vec4 VertexColor;
+attribute vec2 VertexMsdfUnit;
+
+varying vec2 v_texcoord;
+varying vec4 v_color;
+varying vec2 v_msdf_unit;
+
+uniform mat4 MVP;
+
+void main() {
+    v_texcoord = VertexTexCoord;
+    v_color = VertexColor;
+    v_msdf_unit = VertexMsdfUnit;
+    gl_Position = MVP * vec4(VertexPosition.xy, 0.0, 1.0);
+}
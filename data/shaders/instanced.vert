@@ -0,0 +1,29 @@
+attribute vec3 VertexPosition;
+attribute vec2 VertexTexCoord;
+attribute vec3 VertexNormal;
+
+// Per instance
+attribute vec4 InstanceModel0;
+attribute vec4 InstanceModel1;
+attribute vec4 InstanceModel2;
+attribute vec4 InstanceModel3;
+attribute vec4 InstanceTint;
+
+varying vec2 v_texcoord;
+varying vec3 v_normal;
+varying vec4 v_tint;
+
+uniform mat4 ViewProj;
+uniform mat4 View;
+
+void main() {
+    mat4 model = mat4(InstanceModel0, InstanceModel1, InstanceModel2, InstanceModel3);
+
+    // Assumes uniform scale, GLSL ES 1.0 has no inverse()
+    mat4 normal_mat = View * model;
+
+    v_texcoord = VertexTexCoord;
+    v_normal = normalize(vec3(normal_mat * vec4(VertexNormal, 0.0)));
+    v_tint = InstanceTint;
+    gl_Position = ViewProj * model * vec4(VertexPosition, 1.0);
+}
@@ -2,6 +2,9 @@
 #include "../msdfgen.h"
 
 #include "arithmetics.hpp"
+#include "simd.h"
+
+#include <algorithm>
 
 namespace msdfgen {
 
@@ -204,7 +207,336 @@ void generatePseudoSDF(Bitmap<float> &output, const Shape &shape, double range,
     }
 }
 
+// Relative and absolute slack when culling edges by their bounding box, so rounding differences between the box
+// and the exact distance never cull an edge that would tie or win.
+#define MSDFGEN_CULL_MARGIN 1e-9
+
+/// Generates multi-channel distance field rows edge by edge instead of pixel by pixel.
+/// Each edge is tested against a whole row at once: pixels whose closest distance so far is nearer than the edge's
+/// bounding box skip it, and linear segments are evaluated for several pixels at a time using SIMD lanes.
+/// Edges are still visited in the same order for every pixel, so the result matches generateMSDF_scalar.
+class MSDFRowGenerator {
+
+public:
+    MSDFRowGenerator(Bitmap<FloatRGB> &output, const Shape &shape, double range, const Vector2 &scale, const Vector2 &translate);
+    void generateRow(int y);
+
+private:
+    struct BatchEdge {
+        const EdgeHolder *holder;
+        int color;
+        double l, b, r, t;
+        bool linear;
+        Point2 p0, p1;
+        Vector2 ab, orthonormal, direction;
+        double abLengthSquared;
+    };
+    struct EdgePoint {
+        SignedDistance minDistance;
+        const EdgeHolder *nearEdge;
+        double nearParam;
+    };
+    /// Closest edge of one color channel within the current contour, for every pixel of the row.
+    struct RowChannel {
+        std::vector<double> distance, dot, param;
+        std::vector<const EdgeHolder *> nearEdge;
+    };
+    struct PixelState {
+        EdgePoint sr, sg, sb;
+        double d, negDist, posDist;
+        int winding;
+    };
+
+    Bitmap<FloatRGB> &output;
+    const Shape &shape;
+    double range;
+    Vector2 scale, translate;
+    int width, paddedWidth;
+    std::vector<int> windings;
+    std::vector<BatchEdge> edges;
+    std::vector<int> contourStart;
+    std::vector<double> px;
+    RowChannel channels[3];
+    std::vector<PixelState> pixels;
+    std::vector<MultiDistance> contourSD;
+
+    void evaluateEdge(const BatchEdge &edge, double py);
+    void updateChannels(int x, const BatchEdge &edge, SignedDistance distance, double param);
+    void finishContour(int contour, int x, double py);
+    void finishPixel(int x, int row, double py);
+
+};
+
+static const int channelColors[3] = { RED, GREEN, BLUE };
+
+/// Evaluates LinearSegment::signedDistance for a group of origins on the same row, with the same arithmetic.
+static inline void linearSignedDistance(const Point2 &p0, const Point2 &p1, const Vector2 &ab, const Vector2 &orthonormal, const Vector2 &direction, double abLengthSquared, LaneDouble px, double py, double *distance, double *dot, double *param) {
+    LaneDouble zero = laneSplat(0), one = laneSplat(1);
+    LaneDouble aqx = laneSub(px, laneSplat(p0.x));
+    LaneDouble aqy = laneSplat(py-p0.y);
+    LaneDouble abx = laneSplat(ab.x), aby = laneSplat(ab.y);
+    LaneDouble t = laneDiv(laneAdd(laneMul(aqx, abx), laneMul(aqy, aby)), laneSplat(abLengthSquared));
+    LaneMask farEnd = laneGreater(t, laneSplat(.5));
+    LaneDouble eqx = laneSub(laneSelect(farEnd, laneSplat(p1.x), laneSplat(p0.x)), px);
+    LaneDouble eqy = laneSelect(farEnd, laneSplat(p1.y-py), laneSplat(p0.y-py));
+    LaneDouble endpointDistance = laneSqrt(laneAdd(laneMul(eqx, eqx), laneMul(eqy, eqy)));
+    LaneDouble orthoDistance = laneAdd(laneMul(laneSplat(orthonormal.x), aqx), laneMul(laneSplat(orthonormal.y), aqy));
+    LaneMask useOrtho = laneAnd(laneAnd(laneGreater(t, zero), laneLess(t, one)), laneLess(laneAbs(orthoDistance), endpointDistance));
+    LaneDouble sign = laneSelect(laneGreater(laneSub(laneMul(aqx, aby), laneMul(aqy, abx)), zero), one, laneSplat(-1));
+    // Vector2::normalize returns (0, 1) for a zero vector
+    LaneMask zeroLength = laneEqual(endpointDistance, zero);
+    LaneDouble eqnx = laneSelect(zeroLength, zero, laneDiv(eqx, endpointDistance));
+    LaneDouble eqny = laneSelect(zeroLength, one, laneDiv(eqy, endpointDistance));
+    LaneDouble alignment = laneAbs(laneAdd(laneMul(laneSplat(direction.x), eqnx), laneMul(laneSplat(direction.y), eqny)));
+    laneStore(distance, laneSelect(useOrtho, orthoDistance, laneMul(sign, endpointDistance)));
+    laneStore(dot, laneSelect(useOrtho, zero, alignment));
+    laneStore(param, t);
+}
+
+MSDFRowGenerator::MSDFRowGenerator(Bitmap<FloatRGB> &output, const Shape &shape, double range, const Vector2 &scale, const Vector2 &translate) : output(output), shape(shape), range(range), scale(scale), translate(translate) {
+    width = output.width();
+    paddedWidth = (width+MSDFGEN_SIMD_LANES-1)/MSDFGEN_SIMD_LANES*MSDFGEN_SIMD_LANES;
+    int contourCount = shape.contours.size();
+    windings.reserve(contourCount);
+    contourStart.reserve(contourCount+1);
+    for (std::vector<Contour>::const_iterator contour = shape.contours.begin(); contour != shape.contours.end(); ++contour) {
+        windings.push_back(contour->winding());
+        contourStart.push_back(edges.size());
+        for (std::vector<EdgeHolder>::const_iterator edge = contour->edges.begin(); edge != contour->edges.end(); ++edge) {
+            BatchEdge e;
+            e.holder = &*edge;
+            e.color = (*edge)->color;
+            e.l = e.b = 1e240, e.r = e.t = -1e240;
+            const LinearSegment *linear = dynamic_cast<const LinearSegment *>(&**edge);
+            const CubicSegment *cubic = dynamic_cast<const CubicSegment *>(&**edge);
+            e.linear = linear != NULL;
+            if (cubic) {
+                // The control polygon always contains the curve, the exact cubic bounds rely on a root solver
+                for (int i = 0; i < 4; ++i) {
+                    e.l = min(e.l, cubic->p[i].x), e.b = min(e.b, cubic->p[i].y);
+                    e.r = max(e.r, cubic->p[i].x), e.t = max(e.t, cubic->p[i].y);
+                }
+            } else
+                (*edge)->bounds(e.l, e.b, e.r, e.t);
+            if (linear) {
+                e.p0 = linear->p[0];
+                e.p1 = linear->p[1];
+                e.ab = e.p1-e.p0;
+                e.orthonormal = e.ab.getOrthonormal(false);
+                e.direction = e.ab.normalize();
+                e.abLengthSquared = dotProduct(e.ab, e.ab);
+            }
+            edges.push_back(e);
+        }
+    }
+    contourStart.push_back(edges.size());
+
+    px.resize(paddedWidth);
+    for (int x = 0; x < paddedWidth; ++x)
+        px[x] = (x+.5)/scale.x-translate.x;
+    for (int c = 0; c < 3; ++c) {
+        channels[c].distance.resize(paddedWidth);
+        channels[c].dot.resize(paddedWidth);
+        channels[c].param.resize(paddedWidth);
+        channels[c].nearEdge.resize(paddedWidth);
+    }
+    pixels.resize(width);
+    contourSD.resize(contourCount*width);
+}
+
+void MSDFRowGenerator::generateRow(int y) {
+    int h = output.height();
+    int row = shape.inverseYAxis ? h-y-1 : y;
+    double py = (y+.5)/scale.y-translate.y;
+
+    for (int x = 0; x < width; ++x) {
+        PixelState &s = pixels[x];
+        s.sr.minDistance = s.sg.minDistance = s.sb.minDistance = SignedDistance();
+        s.sr.nearEdge = s.sg.nearEdge = s.sb.nearEdge = NULL;
+        s.sr.nearParam = s.sg.nearParam = s.sb.nearParam = 0;
+        s.d = fabs(SignedDistance::INFINITE.distance);
+        s.negDist = -SignedDistance::INFINITE.distance;
+        s.posDist = SignedDistance::INFINITE.distance;
+        s.winding = 0;
+    }
+
+    for (int i = 0; i < (int) windings.size(); ++i) {
+        SignedDistance none;
+        for (int c = 0; c < 3; ++c) {
+            std::fill(channels[c].distance.begin(), channels[c].distance.end(), none.distance);
+            std::fill(channels[c].dot.begin(), channels[c].dot.end(), none.dot);
+            std::fill(channels[c].param.begin(), channels[c].param.end(), 0.);
+            std::fill(channels[c].nearEdge.begin(), channels[c].nearEdge.end(), (const EdgeHolder *) NULL);
+        }
+        for (int e = contourStart[i]; e < contourStart[i+1]; ++e)
+            evaluateEdge(edges[e], py);
+        for (int x = 0; x < width; ++x)
+            finishContour(i, x, py);
+    }
+
+    for (int x = 0; x < width; ++x)
+        finishPixel(x, row, py);
+}
+
+void MSDFRowGenerator::evaluateEdge(const BatchEdge &edge, double py) {
+    LaneDouble zero = laneSplat(0);
+    LaneDouble l = laneSplat(edge.l), r = laneSplat(edge.r);
+    double dy = max(max(edge.b-py, py-edge.t), 0.);
+    LaneDouble dy2 = laneSplat(dy*dy);
+    LaneDouble relativeMargin = laneSplat(1+MSDFGEN_CULL_MARGIN), absoluteMargin = laneSplat(MSDFGEN_CULL_MARGIN);
+
+    for (int x = 0; x < paddedWidth; x += MSDFGEN_SIMD_LANES) {
+        LaneDouble p = laneLoad(&px[x]);
+        // Squared distance to the bounding box is a lower bound of the squared distance to the edge
+        LaneDouble dx = laneMax(laneMax(laneSub(l, p), laneSub(p, r)), zero);
+        LaneDouble lowerBound = laneAdd(laneMul(dx, dx), dy2);
+        LaneDouble threshold = zero;
+        for (int c = 0; c < 3; ++c)
+            if (edge.color&channelColors[c])
+                threshold = laneMax(threshold, laneAbs(laneLoad(&channels[c].distance[x])));
+        threshold = laneAdd(laneMul(threshold, relativeMargin), absoluteMargin);
+        int candidates = laneBits(laneLessEqual(lowerBound, laneMul(threshold, threshold)));
+        if (!candidates)
+            continue;
+
+        if (edge.linear) {
+            double distance[MSDFGEN_SIMD_LANES], dot[MSDFGEN_SIMD_LANES], param[MSDFGEN_SIMD_LANES];
+            linearSignedDistance(edge.p0, edge.p1, edge.ab, edge.orthonormal, edge.direction, edge.abLengthSquared, p, py, distance, dot, param);
+            for (int k = 0; k < MSDFGEN_SIMD_LANES && x+k < width; ++k)
+                if (candidates&1<<k)
+                    updateChannels(x+k, edge, SignedDistance(distance[k], dot[k]), param[k]);
+        } else {
+            for (int k = 0; k < MSDFGEN_SIMD_LANES && x+k < width; ++k)
+                if (candidates&1<<k) {
+                    double param;
+                    SignedDistance distance = (*edge.holder)->signedDistance(Point2(px[x+k], py), param);
+                    updateChannels(x+k, edge, distance, param);
+                }
+        }
+    }
+}
+
+void MSDFRowGenerator::updateChannels(int x, const BatchEdge &edge, SignedDistance distance, double param) {
+    for (int c = 0; c < 3; ++c) {
+        RowChannel &channel = channels[c];
+        if (edge.color&channelColors[c] && distance < SignedDistance(channel.distance[x], channel.dot[x])) {
+            channel.distance[x] = distance.distance;
+            channel.dot[x] = distance.dot;
+            channel.nearEdge[x] = edge.holder;
+            channel.param[x] = param;
+        }
+    }
+}
+
+void MSDFRowGenerator::finishContour(int i, int x, double py) {
+    Point2 p(px[x], py);
+    PixelState &s = pixels[x];
+    EdgePoint r, g, b;
+    EdgePoint *points[3] = { &r, &g, &b };
+    for (int c = 0; c < 3; ++c) {
+        points[c]->minDistance = SignedDistance(channels[c].distance[x], channels[c].dot[x]);
+        points[c]->nearEdge = channels[c].nearEdge[x];
+        points[c]->nearParam = channels[c].param[x];
+    }
+
+    if (r.minDistance < s.sr.minDistance)
+        s.sr = r;
+    if (g.minDistance < s.sg.minDistance)
+        s.sg = g;
+    if (b.minDistance < s.sb.minDistance)
+        s.sb = b;
+
+    double medMinDistance = fabs(median(r.minDistance.distance, g.minDistance.distance, b.minDistance.distance));
+    if (medMinDistance < s.d) {
+        s.d = medMinDistance;
+        s.winding = -windings[i];
+    }
+    if (r.nearEdge)
+        (*r.nearEdge)->distanceToPseudoDistance(r.minDistance, p, r.nearParam);
+    if (g.nearEdge)
+        (*g.nearEdge)->distanceToPseudoDistance(g.minDistance, p, g.nearParam);
+    if (b.nearEdge)
+        (*b.nearEdge)->distanceToPseudoDistance(b.minDistance, p, b.nearParam);
+    medMinDistance = median(r.minDistance.distance, g.minDistance.distance, b.minDistance.distance);
+    MultiDistance &sd = contourSD[i*width+x];
+    sd.r = r.minDistance.distance;
+    sd.g = g.minDistance.distance;
+    sd.b = b.minDistance.distance;
+    sd.med = medMinDistance;
+    if (windings[i] > 0 && medMinDistance >= 0 && fabs(medMinDistance) < fabs(s.posDist))
+        s.posDist = medMinDistance;
+    if (windings[i] < 0 && medMinDistance <= 0 && fabs(medMinDistance) < fabs(s.negDist))
+        s.negDist = medMinDistance;
+}
+
+void MSDFRowGenerator::finishPixel(int x, int row, double py) {
+    Point2 p(px[x], py);
+    PixelState &s = pixels[x];
+    int contourCount = windings.size();
+    const MultiDistance *sd = &contourSD[x];
+
+    if (s.sr.nearEdge)
+        (*s.sr.nearEdge)->distanceToPseudoDistance(s.sr.minDistance, p, s.sr.nearParam);
+    if (s.sg.nearEdge)
+        (*s.sg.nearEdge)->distanceToPseudoDistance(s.sg.minDistance, p, s.sg.nearParam);
+    if (s.sb.nearEdge)
+        (*s.sb.nearEdge)->distanceToPseudoDistance(s.sb.minDistance, p, s.sb.nearParam);
+
+    MultiDistance msd;
+    msd.r = msd.g = msd.b = msd.med = SignedDistance::INFINITE.distance;
+    if (s.posDist >= 0 && fabs(s.posDist) <= fabs(s.negDist)) {
+        msd.med = SignedDistance::INFINITE.distance;
+        s.winding = 1;
+        for (int i = 0; i < contourCount; ++i)
+            if (windings[i] > 0 && sd[i*width].med > msd.med && fabs(sd[i*width].med) < fabs(s.negDist))
+                msd = sd[i*width];
+    } else if (s.negDist <= 0 && fabs(s.negDist) <= fabs(s.posDist)) {
+        msd.med = -SignedDistance::INFINITE.distance;
+        s.winding = -1;
+        for (int i = 0; i < contourCount; ++i)
+            if (windings[i] < 0 && sd[i*width].med < msd.med && fabs(sd[i*width].med) < fabs(s.posDist))
+                msd = sd[i*width];
+    }
+    for (int i = 0; i < contourCount; ++i)
+        if (windings[i] != s.winding && fabs(sd[i*width].med) < fabs(msd.med))
+            msd = sd[i*width];
+    if (median(s.sr.minDistance.distance, s.sg.minDistance.distance, s.sb.minDistance.distance) == msd.med) {
+        msd.r = s.sr.minDistance.distance;
+        msd.g = s.sg.minDistance.distance;
+        msd.b = s.sb.minDistance.distance;
+    }
+
+    output(x, row).r = float(msd.r/range+.5);
+    output(x, row).g = float(msd.g/range+.5);
+    output(x, row).b = float(msd.b/range+.5);
+}
+
+void generateMSDFRows(Bitmap<FloatRGB> &output, const Shape &shape, double range, const Vector2 &scale, const Vector2 &translate, int rowBegin, int rowEnd) {
+    MSDFRowGenerator generator(output, shape, range, scale, translate);
+    for (int y = rowBegin; y < rowEnd; ++y)
+        generator.generateRow(y);
+}
+
 void generateMSDF(Bitmap<FloatRGB> &output, const Shape &shape, double range, const Vector2 &scale, const Vector2 &translate, double edgeThreshold) {
+    int h = output.height();
+
+#ifdef MSDFGEN_USE_OPENMP
+    #pragma omp parallel
+#endif
+    {
+        MSDFRowGenerator generator(output, shape, range, scale, translate);
+#ifdef MSDFGEN_USE_OPENMP
+        #pragma omp for
+#endif
+        for (int y = 0; y < h; ++y)
+            generator.generateRow(y);
+    }
+
+    if (edgeThreshold > 0)
+        msdfErrorCorrection(output, edgeThreshold/(scale*range));
+}
+
+void generateMSDF_scalar(Bitmap<FloatRGB> &output, const Shape &shape, double range, const Vector2 &scale, const Vector2 &translate, double edgeThreshold) {
     int contourCount = shape.contours.size();
     int w = output.width(), h = output.height();
     std::vector<int> windings;
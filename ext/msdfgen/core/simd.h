@@ -0,0 +1,122 @@
+
+#pragma once
+
+// Minimal double precision lane abstraction for evaluating several pixels at once.
+// Uses AVX (4 lanes) or SSE2 (2 lanes) natively and SIMD128 (2 lanes) under WebAssembly, with a single lane fallback.
+// Define MSDFGEN_NO_SIMD to force the fallback.
+
+#include <cmath>
+
+#if !defined(MSDFGEN_NO_SIMD) && defined(__AVX__)
+    #include <immintrin.h>
+    #define MSDFGEN_SIMD_AVX
+    #define MSDFGEN_SIMD_LANES 4
+#elif !defined(MSDFGEN_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+    #include <emmintrin.h>
+    #define MSDFGEN_SIMD_SSE2
+    #define MSDFGEN_SIMD_LANES 2
+#elif !defined(MSDFGEN_NO_SIMD) && defined(__wasm_simd128__)
+    #include <wasm_simd128.h>
+    #define MSDFGEN_SIMD_WASM
+    #define MSDFGEN_SIMD_LANES 2
+#else
+    #define MSDFGEN_SIMD_LANES 1
+#endif
+
+namespace msdfgen {
+
+#if defined(MSDFGEN_SIMD_AVX)
+
+typedef __m256d LaneDouble;
+typedef __m256d LaneMask;
+
+inline LaneDouble laneSplat(double value) { return _mm256_set1_pd(value); }
+inline LaneDouble laneLoad(const double *values) { return _mm256_loadu_pd(values); }
+inline void laneStore(double *values, LaneDouble a) { _mm256_storeu_pd(values, a); }
+inline LaneDouble laneAdd(LaneDouble a, LaneDouble b) { return _mm256_add_pd(a, b); }
+inline LaneDouble laneSub(LaneDouble a, LaneDouble b) { return _mm256_sub_pd(a, b); }
+inline LaneDouble laneMul(LaneDouble a, LaneDouble b) { return _mm256_mul_pd(a, b); }
+inline LaneDouble laneDiv(LaneDouble a, LaneDouble b) { return _mm256_div_pd(a, b); }
+inline LaneDouble laneSqrt(LaneDouble a) { return _mm256_sqrt_pd(a); }
+inline LaneDouble laneAbs(LaneDouble a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+inline LaneDouble laneMax(LaneDouble a, LaneDouble b) { return _mm256_max_pd(a, b); }
+inline LaneMask laneLess(LaneDouble a, LaneDouble b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+inline LaneMask laneLessEqual(LaneDouble a, LaneDouble b) { return _mm256_cmp_pd(a, b, _CMP_LE_OQ); }
+inline LaneMask laneGreater(LaneDouble a, LaneDouble b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+inline LaneMask laneEqual(LaneDouble a, LaneDouble b) { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+inline LaneMask laneAnd(LaneMask a, LaneMask b) { return _mm256_and_pd(a, b); }
+inline LaneDouble laneSelect(LaneMask mask, LaneDouble a, LaneDouble b) { return _mm256_blendv_pd(b, a, mask); }
+inline int laneBits(LaneMask mask) { return _mm256_movemask_pd(mask); }
+
+#elif defined(MSDFGEN_SIMD_SSE2)
+
+typedef __m128d LaneDouble;
+typedef __m128d LaneMask;
+
+inline LaneDouble laneSplat(double value) { return _mm_set1_pd(value); }
+inline LaneDouble laneLoad(const double *values) { return _mm_loadu_pd(values); }
+inline void laneStore(double *values, LaneDouble a) { _mm_storeu_pd(values, a); }
+inline LaneDouble laneAdd(LaneDouble a, LaneDouble b) { return _mm_add_pd(a, b); }
+inline LaneDouble laneSub(LaneDouble a, LaneDouble b) { return _mm_sub_pd(a, b); }
+inline LaneDouble laneMul(LaneDouble a, LaneDouble b) { return _mm_mul_pd(a, b); }
+inline LaneDouble laneDiv(LaneDouble a, LaneDouble b) { return _mm_div_pd(a, b); }
+inline LaneDouble laneSqrt(LaneDouble a) { return _mm_sqrt_pd(a); }
+inline LaneDouble laneAbs(LaneDouble a) { return _mm_andnot_pd(_mm_set1_pd(-0.0), a); }
+inline LaneDouble laneMax(LaneDouble a, LaneDouble b) { return _mm_max_pd(a, b); }
+inline LaneMask laneLess(LaneDouble a, LaneDouble b) { return _mm_cmplt_pd(a, b); }
+inline LaneMask laneLessEqual(LaneDouble a, LaneDouble b) { return _mm_cmple_pd(a, b); }
+inline LaneMask laneGreater(LaneDouble a, LaneDouble b) { return _mm_cmpgt_pd(a, b); }
+inline LaneMask laneEqual(LaneDouble a, LaneDouble b) { return _mm_cmpeq_pd(a, b); }
+inline LaneMask laneAnd(LaneMask a, LaneMask b) { return _mm_and_pd(a, b); }
+inline LaneDouble laneSelect(LaneMask mask, LaneDouble a, LaneDouble b) { return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b)); }
+inline int laneBits(LaneMask mask) { return _mm_movemask_pd(mask); }
+
+#elif defined(MSDFGEN_SIMD_WASM)
+
+typedef v128_t LaneDouble;
+typedef v128_t LaneMask;
+
+inline LaneDouble laneSplat(double value) { return wasm_f64x2_splat(value); }
+inline LaneDouble laneLoad(const double *values) { return wasm_v128_load(values); }
+inline void laneStore(double *values, LaneDouble a) { wasm_v128_store(values, a); }
+inline LaneDouble laneAdd(LaneDouble a, LaneDouble b) { return wasm_f64x2_add(a, b); }
+inline LaneDouble laneSub(LaneDouble a, LaneDouble b) { return wasm_f64x2_sub(a, b); }
+inline LaneDouble laneMul(LaneDouble a, LaneDouble b) { return wasm_f64x2_mul(a, b); }
+inline LaneDouble laneDiv(LaneDouble a, LaneDouble b) { return wasm_f64x2_div(a, b); }
+inline LaneDouble laneSqrt(LaneDouble a) { return wasm_f64x2_sqrt(a); }
+inline LaneDouble laneAbs(LaneDouble a) { return wasm_f64x2_abs(a); }
+inline LaneDouble laneMax(LaneDouble a, LaneDouble b) { return wasm_f64x2_pmax(a, b); }
+inline LaneMask laneLess(LaneDouble a, LaneDouble b) { return wasm_f64x2_lt(a, b); }
+inline LaneMask laneLessEqual(LaneDouble a, LaneDouble b) { return wasm_f64x2_le(a, b); }
+inline LaneMask laneGreater(LaneDouble a, LaneDouble b) { return wasm_f64x2_gt(a, b); }
+inline LaneMask laneEqual(LaneDouble a, LaneDouble b) { return wasm_f64x2_eq(a, b); }
+inline LaneMask laneAnd(LaneMask a, LaneMask b) { return wasm_v128_and(a, b); }
+inline LaneDouble laneSelect(LaneMask mask, LaneDouble a, LaneDouble b) { return wasm_v128_bitselect(a, b, mask); }
+inline int laneBits(LaneMask mask) { return wasm_i64x2_bitmask(mask); }
+
+#else
+
+typedef double LaneDouble;
+typedef bool LaneMask;
+
+inline LaneDouble laneSplat(double value) { return value; }
+inline LaneDouble laneLoad(const double *values) { return *values; }
+inline void laneStore(double *values, LaneDouble a) { *values = a; }
+inline LaneDouble laneAdd(LaneDouble a, LaneDouble b) { return a+b; }
+inline LaneDouble laneSub(LaneDouble a, LaneDouble b) { return a-b; }
+inline LaneDouble laneMul(LaneDouble a, LaneDouble b) { return a*b; }
+inline LaneDouble laneDiv(LaneDouble a, LaneDouble b) { return a/b; }
+inline LaneDouble laneSqrt(LaneDouble a) { return sqrt(a); }
+inline LaneDouble laneAbs(LaneDouble a) { return fabs(a); }
+inline LaneDouble laneMax(LaneDouble a, LaneDouble b) { return a > b ? a : b; }
+inline LaneMask laneLess(LaneDouble a, LaneDouble b) { return a < b; }
+inline LaneMask laneLessEqual(LaneDouble a, LaneDouble b) { return a <= b; }
+inline LaneMask laneGreater(LaneDouble a, LaneDouble b) { return a > b; }
+inline LaneMask laneEqual(LaneDouble a, LaneDouble b) { return a == b; }
+inline LaneMask laneAnd(LaneMask a, LaneMask b) { return a && b; }
+inline LaneDouble laneSelect(LaneMask mask, LaneDouble a, LaneDouble b) { return mask ? a : b; }
+inline int laneBits(LaneMask mask) { return mask; }
+
+#endif
+
+}
@@ -37,6 +37,16 @@ void generatePseudoSDF(Bitmap<float> &output, const Shape &shape, double range,
 /// Generates a multi-channel signed distance field. Edge colors must be assigned first! (see edgeColoringSimple)
 void generateMSDF(Bitmap<FloatRGB> &output, const Shape &shape, double range, const Vector2 &scale, const Vector2 &translate, double edgeThreshold = 1.00000001);
 
+/// Generates rows [rowBegin, rowEnd) of a multi-channel signed distance field, counted in the order generateMSDF samples them.
+/// Disjoint row ranges can be generated concurrently into the same bitmap. Skips error correction, which needs the whole field.
+void generateMSDFRows(Bitmap<FloatRGB> &output, const Shape &shape, double range, const Vector2 &scale, const Vector2 &translate, int rowBegin, int rowEnd);
+
+/// Resolves clashes between neighboring pixels of a finished multi-channel signed distance field, as done by generateMSDF.
+void msdfErrorCorrection(Bitmap<FloatRGB> &output, const Vector2 &threshold);
+
+/// Per-pixel version of generateMSDF without edge culling or SIMD, kept as a reference for the batched implementation.
+void generateMSDF_scalar(Bitmap<FloatRGB> &output, const Shape &shape, double range, const Vector2 &scale, const Vector2 &translate, double edgeThreshold = 1.00000001);
+
 // Original simpler versions of the previous functions, which work well under normal circumstances, but cannot deal with overlapping contours.
 void generateSDF_legacy(Bitmap<float> &output, const Shape &shape, double range, const Vector2 &scale, const Vector2 &translate);
 void generatePseudoSDF_legacy(Bitmap<float> &output, const Shape &shape, double range, const Vector2 &scale, const Vector2 &translate);
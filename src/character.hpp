@@ -1,18 +1,27 @@
 #pragma once
 
+#include "ember/atom.hpp"
+#include "ember/reflection.hpp"
+
 #include <vector>
 #include <string>
 
+#include "ember/reflection_start.hpp"
+
 struct attack_pattern {
     int x;
     int y;
 };
+REFLECT(attack_pattern, (x)(y))
 
 struct character {
     int max_health;
     int health;
     int power;
-    std::string portrait;
+    ember::atom portrait;
     std::vector<attack_pattern> attack_patterns;
     bool returning;
 };
+REFLECT(character, (max_health)(health)(power)(portrait)(attack_patterns)(returning))
+
+#include "ember/reflection_end.hpp"
@@ -3,6 +3,7 @@
 #include "character.hpp"
 #include "movement.hpp"
 
+#include "ember/atom.hpp"
 #include "ember/component_common.hpp"
 #include "ember/entities.hpp"
 #include "ember/net_id.hpp"
@@ -24,7 +25,7 @@ namespace component {
 
 /** Actor script used for various events */
 struct script {
-    std::string name; /** Script name within the 'actors.' namespace */
+    ember::atom name; /** Script name within the 'actors.' namespace */
 };
 REFLECT(script, (name))
 
@@ -33,13 +34,13 @@ struct transform : sushi::transform {};
 REFLECT(transform, (pos)(rot)(scl))
 
 struct sprite {
-    std::string texture;
+    ember::atom texture;
     glm::vec2 size = {1, 1};
     glm::vec2 inset = {0, 0};
     std::vector<int> frames;
     float time = 0;
 };
-REFLECT(sprite, (texture)(size)(frames)(time))
+REFLECT(sprite, (texture)(size)(inset)(frames)(time))
 
 struct character_ref {
     enum action {
@@ -55,7 +56,7 @@ struct character_ref {
     bool player_controlled = false;
     bool did_move = false;
 };
-REFLECT(character_ref, (c)(m)(board_pos)(a)(player_controlled))
+REFLECT(character_ref, (c)(m)(board_pos)(a)(move_index)(player_controlled)(did_move))
 
 struct ephemeral_character {
     character c;
@@ -69,7 +70,7 @@ struct locomotion {
     float return_duration = 0;
     bool bring_me_peace = false;
 };
-REFLECT(locomotion, (target)(duration))
+REFLECT(locomotion, (target)(duration)(return_target)(return_duration)(bring_me_peace))
 
 } // namespace component
 
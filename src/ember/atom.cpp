@@ -0,0 +1,51 @@
+#include "atom.hpp"
+
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+namespace ember {
+
+namespace { // static
+
+struct atom_table {
+    std::mutex mutex;
+    std::deque<std::string> strings; /** Deque keeps addresses stable as it grows */
+    std::unordered_map<std::string_view, const std::string*> index;
+};
+
+auto get_table() -> atom_table& {
+    static auto table = atom_table{};
+    return table;
+}
+
+auto get_empty() -> const std::string* {
+    static const auto empty = std::string{};
+    return &empty;
+}
+
+} // static
+
+atom::atom() : value(get_empty()) {}
+
+atom::atom(std::string_view str) {
+    if (str.empty()) {
+        value = get_empty();
+        return;
+    }
+
+    auto& table = get_table();
+    auto lock = std::lock_guard(table.mutex);
+
+    auto iter = table.index.find(str);
+
+    if (iter != table.index.end()) {
+        value = iter->second;
+    } else {
+        auto& stored = table.strings.emplace_back(str);
+        table.index.emplace(std::string_view(stored), &stored);
+        value = &stored;
+    }
+}
+
+} // namespace ember
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <sol.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace ember {
+
+/**
+ * Interned string.
+ * Equal strings share one immutable copy for the lifetime of the program, so comparison and hashing are a pointer
+ * compare. Creating an atom hashes the string once, atoms used in hot paths should be created ahead of time.
+ * Ordering compares addresses, it is consistent but not lexicographic.
+ */
+class atom {
+public:
+    /** The empty string */
+    atom();
+
+    atom(std::string_view str);
+
+    atom(const std::string& str) : atom(std::string_view(str)) {}
+
+    atom(const char* str) : atom(std::string_view(str)) {}
+
+    auto str() const -> const std::string& { return *value; }
+
+    auto c_str() const -> const char* { return value->c_str(); }
+
+    bool empty() const { return value->empty(); }
+
+    friend bool operator==(const atom& a, const atom& b) { return a.value == b.value; }
+
+    friend bool operator!=(const atom& a, const atom& b) { return a.value != b.value; }
+
+    friend bool operator<(const atom& a, const atom& b) { return std::less<const std::string*>{}(a.value, b.value); }
+
+    friend auto operator<<(std::ostream& out, const atom& a) -> std::ostream& { return out << *a.value; }
+
+private:
+    friend struct std::hash<atom>;
+
+    const std::string* value;
+};
+
+// Lua sees atoms as plain strings
+
+inline auto sol_lua_get(sol::types<atom>, lua_State* L, int index, sol::stack::record& tracking) -> atom {
+    tracking.use(1);
+    auto len = std::size_t{};
+    auto str = lua_tolstring(L, index, &len);
+    return atom(std::string_view(str, len));
+}
+
+inline int sol_lua_push(sol::types<atom>, lua_State* L, const atom& a) {
+    lua_pushlstring(L, a.str().data(), a.str().size());
+    return 1;
+}
+
+template <typename Handler>
+bool sol_lua_check(sol::types<atom>, lua_State* L, int index, Handler&& handler, sol::stack::record& tracking) {
+    tracking.use(1);
+    if (lua_type(L, index) == LUA_TSTRING) {
+        return true;
+    }
+    handler(L, index, sol::type::string, sol::type_of(L, index), "expected a string");
+    return false;
+}
+
+} // namespace ember
+
+template <>
+struct std::hash<ember::atom> {
+    auto operator()(const ember::atom& a) const noexcept -> std::size_t {
+        return std::hash<const std::string*>{}(a.value);
+    }
+};
+
+template <>
+struct sol::lua_type_of<ember::atom> : std::integral_constant<sol::type, sol::type::string> {};
@@ -0,0 +1,108 @@
+#include "bounds.hpp"
+
+#include <glm/gtc/matrix_access.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace ember {
+
+auto mesh_bounds::from_points(const std::vector<glm::vec3>& points) -> mesh_bounds {
+    auto bounds = mesh_bounds{};
+    bounds.box = {points.front(), points.front()};
+
+    for (const auto& p : points) {
+        bounds.box.min = glm::min(bounds.box.min, p);
+        bounds.box.max = glm::max(bounds.box.max, p);
+    }
+
+    // Centered on the box, which is tighter than the box's own circumsphere for most meshes
+    auto center = (bounds.box.min + bounds.box.max) * 0.5f;
+    auto radius2 = 0.f;
+
+    for (const auto& p : points) {
+        auto d = p - center;
+        radius2 = std::max(radius2, glm::dot(d, d));
+    }
+
+    bounds.sphere = {center, std::sqrt(radius2)};
+
+    return bounds;
+}
+
+auto merge(const aabb& a, const aabb& b) -> aabb {
+    return {glm::min(a.min, b.min), glm::max(a.max, b.max)};
+}
+
+auto contains(const aabb& outer, const aabb& inner) -> bool {
+    return glm::all(glm::lessThanEqual(outer.min, inner.min)) && glm::all(glm::lessThanEqual(inner.max, outer.max));
+}
+
+auto surface_area(const aabb& box) -> float {
+    auto d = box.max - box.min;
+    return 2.f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+auto transform(const aabb& box, const glm::mat4& mat) -> aabb {
+    // Arvo's method, each matrix element contributes its extreme to min and max independently
+    auto out = aabb{glm::vec3(mat[3]), glm::vec3(mat[3])};
+
+    for (int col = 0; col < 3; ++col) {
+        for (int row = 0; row < 3; ++row) {
+            auto a = mat[col][row] * box.min[col];
+            auto b = mat[col][row] * box.max[col];
+            out.min[row] += std::min(a, b);
+            out.max[row] += std::max(a, b);
+        }
+    }
+
+    return out;
+}
+
+frustum_planes::frustum_planes(const glm::mat4& projview) {
+    // Gribb and Hartmann, each plane is the sum or difference of the w row and another row
+    auto x = glm::row(projview, 0);
+    auto y = glm::row(projview, 1);
+    auto z = glm::row(projview, 2);
+    auto w = glm::row(projview, 3);
+
+    planes = {w + x, w - x, w + y, w - y, w + z, w - z};
+
+    for (auto& p : planes) {
+        p /= glm::length(glm::vec3(p));
+    }
+}
+
+auto frustum_planes::classify(const aabb& box) const -> containment {
+    auto center = (box.min + box.max) * 0.5f;
+    auto extents = (box.max - box.min) * 0.5f;
+    auto result = containment::INSIDE;
+
+    for (const auto& p : planes) {
+        auto normal = glm::vec3(p);
+        auto distance = glm::dot(normal, center) + p.w;
+        auto radius = glm::dot(glm::abs(normal), extents);
+
+        if (distance + radius < 0) {
+            return containment::OUTSIDE;
+        }
+
+        if (distance - radius < 0) {
+            result = containment::INTERSECTS;
+        }
+    }
+
+    return result;
+}
+
+auto frustum_planes::intersects(const bounding_sphere& sphere) const -> bool {
+    for (const auto& p : planes) {
+        if (glm::dot(glm::vec3(p), sphere.center) + p.w < -sphere.radius) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+} // namespace ember
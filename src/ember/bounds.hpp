@@ -0,0 +1,63 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <vector>
+
+namespace ember {
+
+/** Axis-aligned box, min and max inclusive */
+struct aabb {
+    glm::vec3 min;
+    glm::vec3 max;
+};
+
+struct bounding_sphere {
+    glm::vec3 center;
+    float radius;
+};
+
+/** Object space bounds of a mesh, computed once at load time */
+struct mesh_bounds {
+    aabb box;
+    bounding_sphere sphere;
+
+    /** Bounds of a point cloud, which must not be empty */
+    static auto from_points(const std::vector<glm::vec3>& points) -> mesh_bounds;
+};
+
+auto merge(const aabb& a, const aabb& b) -> aabb;
+
+auto contains(const aabb& outer, const aabb& inner) -> bool;
+
+auto surface_area(const aabb& box) -> float;
+
+/** Box around the transformed box, exact for the corners */
+auto transform(const aabb& box, const glm::mat4& mat) -> aabb;
+
+enum class containment {
+    OUTSIDE,
+    INTERSECTS,
+    INSIDE,
+};
+
+/** The six clip planes of a view-projection matrix, for culling boxes and spheres */
+class frustum_planes {
+public:
+    frustum_planes() = default;
+
+    /** Expects OpenGL clip space, z from -1 to 1 */
+    explicit frustum_planes(const glm::mat4& projview);
+
+    auto classify(const aabb& box) const -> containment;
+
+    auto intersects(const aabb& box) const -> bool { return classify(box) != containment::OUTSIDE; }
+
+    auto intersects(const bounding_sphere& sphere) const -> bool;
+
+private:
+    std::array<glm::vec4, 6> planes = {}; /** Normal in xyz, pointing inwards, and distance in w */
+};
+
+} // namespace ember
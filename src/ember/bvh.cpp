@@ -0,0 +1,367 @@
+#include "bvh.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace ember {
+
+bvh::bvh(float margin) : margin(margin) {
+    if (!(margin >= 0)) {
+        throw std::invalid_argument("bvh: margin must not be negative");
+    }
+}
+
+void bvh::update(database::ent_id eid, const aabb& bounds) {
+    auto index = eid.get_index();
+
+    if (index >= leaves.size()) {
+        leaves.resize(index + 1, null_node);
+    }
+
+    auto leaf = leaves[index];
+
+    // Entity slots are recycled, so a leaf for a different entity is replaced entirely
+    if (leaf != null_node && !(*nodes[leaf].eid == eid)) {
+        remove(*nodes[leaf].eid);
+        leaf = null_node;
+    }
+
+    auto fat = aabb{bounds.min - glm::vec3(margin), bounds.max + glm::vec3(margin)};
+
+    if (leaf != null_node) {
+        auto& n = nodes[leaf];
+        n.tight = bounds;
+
+        // Still inside its enlarged box and not much smaller than it, nothing else changes
+        if (contains(n.box, bounds) && surface_area(n.box) <= surface_area(fat) * 4) {
+            return;
+        }
+
+        remove_leaf(leaf);
+    } else {
+        leaf = allocate_node();
+        nodes[leaf].eid = eid;
+        nodes[leaf].tight = bounds;
+        leaves[index] = leaf;
+        ++count;
+    }
+
+    nodes[leaf].box = fat;
+    insert_leaf(leaf);
+}
+
+void bvh::remove(database::ent_id eid) {
+    auto index = eid.get_index();
+
+    if (index >= leaves.size() || leaves[index] == null_node || !(*nodes[leaves[index]].eid == eid)) {
+        return;
+    }
+
+    auto leaf = leaves[index];
+    remove_leaf(leaf);
+    free_node(leaf);
+    leaves[index] = null_node;
+    --count;
+}
+
+void bvh::clear() {
+    nodes.clear();
+    leaves.clear();
+    root = null_node;
+    free_list = null_node;
+    count = 0;
+}
+
+void bvh::query_frustum(const frustum_planes& frustum, std::vector<database::ent_id>& out) const {
+    if (root == null_node) {
+        return;
+    }
+
+    stack.clear();
+    stack.emplace_back(root, false);
+
+    while (!stack.empty()) {
+        auto [index, inside] = stack.back();
+        stack.pop_back();
+
+        const auto& n = nodes[index];
+
+        if (!inside) {
+            auto c = frustum.classify(n.is_leaf() ? n.tight : n.box);
+
+            if (c == containment::OUTSIDE) {
+                continue;
+            }
+
+            inside = c == containment::INSIDE;
+        }
+
+        if (n.is_leaf()) {
+            out.push_back(*n.eid);
+        } else {
+            stack.emplace_back(n.child1, inside);
+            stack.emplace_back(n.child2, inside);
+        }
+    }
+}
+
+void bvh::query_aabb(const aabb& area, std::vector<database::ent_id>& out) const {
+    if (root == null_node) {
+        return;
+    }
+
+    auto overlaps = [&](const aabb& box) {
+        return glm::all(glm::lessThanEqual(box.min, area.max)) && glm::all(glm::lessThanEqual(area.min, box.max));
+    };
+
+    stack.clear();
+    stack.emplace_back(root, false);
+
+    while (!stack.empty()) {
+        auto index = stack.back().first;
+        stack.pop_back();
+
+        const auto& n = nodes[index];
+
+        if (!overlaps(n.is_leaf() ? n.tight : n.box)) {
+            continue;
+        }
+
+        if (n.is_leaf()) {
+            out.push_back(*n.eid);
+        } else {
+            stack.emplace_back(n.child1, false);
+            stack.emplace_back(n.child2, false);
+        }
+    }
+}
+
+auto bvh::height() const -> int {
+    return root == null_node ? 0 : nodes[root].height;
+}
+
+auto bvh::allocate_node() -> int {
+    if (free_list != null_node) {
+        auto index = free_list;
+        free_list = nodes[index].parent;
+        nodes[index] = node{};
+        return index;
+    }
+
+    nodes.emplace_back();
+    return int(nodes.size() - 1);
+}
+
+void bvh::free_node(int index) {
+    auto& n = nodes[index];
+    n.eid.reset();
+    n.child1 = null_node;
+    n.child2 = null_node;
+    n.height = -1;
+    n.parent = free_list;
+    free_list = index;
+}
+
+void bvh::insert_leaf(int leaf) {
+    if (root == null_node) {
+        root = leaf;
+        nodes[root].parent = null_node;
+        return;
+    }
+
+    auto leaf_box = nodes[leaf].box;
+
+    // Walk down towards the sibling that grows the tree's total surface area the least
+    auto index = root;
+
+    while (!nodes[index].is_leaf()) {
+        const auto& n = nodes[index];
+
+        auto area = surface_area(n.box);
+        auto combined = surface_area(merge(n.box, leaf_box));
+
+        // Cost of making a new parent for this node and the leaf, and the growth every ancestor pays on descending
+        auto cost = 2 * combined;
+        auto inherited = 2 * (combined - area);
+
+        auto descend_cost = [&](int child) {
+            const auto& c = nodes[child];
+            auto grown = surface_area(merge(leaf_box, c.box));
+            return c.is_leaf() ? grown + inherited : grown - surface_area(c.box) + inherited;
+        };
+
+        auto cost1 = descend_cost(n.child1);
+        auto cost2 = descend_cost(n.child2);
+
+        if (cost < cost1 && cost < cost2) {
+            break;
+        }
+
+        index = cost1 < cost2 ? n.child1 : n.child2;
+    }
+
+    auto sibling = index;
+    auto old_parent = nodes[sibling].parent;
+    auto new_parent = allocate_node();
+
+    nodes[new_parent].parent = old_parent;
+    nodes[new_parent].box = merge(leaf_box, nodes[sibling].box);
+    nodes[new_parent].height = nodes[sibling].height + 1;
+    nodes[new_parent].child1 = sibling;
+    nodes[new_parent].child2 = leaf;
+
+    if (old_parent != null_node) {
+        if (nodes[old_parent].child1 == sibling) {
+            nodes[old_parent].child1 = new_parent;
+        } else {
+            nodes[old_parent].child2 = new_parent;
+        }
+    } else {
+        root = new_parent;
+    }
+
+    nodes[sibling].parent = new_parent;
+    nodes[leaf].parent = new_parent;
+
+    refit(old_parent);
+}
+
+void bvh::remove_leaf(int leaf) {
+    if (leaf == root) {
+        root = null_node;
+        return;
+    }
+
+    auto parent = nodes[leaf].parent;
+    auto grandparent = nodes[parent].parent;
+    auto sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+    // The parent only existed to join the leaf and its sibling, the sibling takes its place
+    if (grandparent != null_node) {
+        if (nodes[grandparent].child1 == parent) {
+            nodes[grandparent].child1 = sibling;
+        } else {
+            nodes[grandparent].child2 = sibling;
+        }
+
+        nodes[sibling].parent = grandparent;
+        free_node(parent);
+        refit(grandparent);
+    } else {
+        root = sibling;
+        nodes[sibling].parent = null_node;
+        free_node(parent);
+    }
+
+    nodes[leaf].parent = null_node;
+}
+
+void bvh::refit(int index) {
+    while (index != null_node) {
+        index = balance(index);
+
+        auto& n = nodes[index];
+        const auto& c1 = nodes[n.child1];
+        const auto& c2 = nodes[n.child2];
+
+        n.height = 1 + std::max(c1.height, c2.height);
+        n.box = merge(c1.box, c2.box);
+
+        index = n.parent;
+    }
+}
+
+auto bvh::balance(int a) -> int {
+    auto& na = nodes[a];
+
+    if (na.is_leaf() || na.height < 2) {
+        return a;
+    }
+
+    auto b = na.child1;
+    auto c = na.child2;
+    auto& nb = nodes[b];
+    auto& nc = nodes[c];
+
+    auto replace_in_parent = [&](int old_child, int new_child) {
+        auto parent = nodes[new_child].parent;
+
+        if (parent == null_node) {
+            root = new_child;
+        } else if (nodes[parent].child1 == old_child) {
+            nodes[parent].child1 = new_child;
+        } else {
+            nodes[parent].child2 = new_child;
+        }
+    };
+
+    // C is taller, it becomes the subtree root and A takes the shorter of C's children
+    if (nc.height - nb.height > 1) {
+        auto f = nc.child1;
+        auto g = nc.child2;
+        auto& nf = nodes[f];
+        auto& ng = nodes[g];
+
+        nc.child1 = a;
+        nc.parent = na.parent;
+        na.parent = c;
+        replace_in_parent(a, c);
+
+        if (nf.height > ng.height) {
+            nc.child2 = f;
+            na.child2 = g;
+            ng.parent = a;
+            na.box = merge(nb.box, ng.box);
+            nc.box = merge(na.box, nf.box);
+            na.height = 1 + std::max(nb.height, ng.height);
+            nc.height = 1 + std::max(na.height, nf.height);
+        } else {
+            nc.child2 = g;
+            na.child2 = f;
+            nf.parent = a;
+            na.box = merge(nb.box, nf.box);
+            nc.box = merge(na.box, ng.box);
+            na.height = 1 + std::max(nb.height, nf.height);
+            nc.height = 1 + std::max(na.height, ng.height);
+        }
+
+        return c;
+    }
+
+    // Mirror image, B is taller
+    if (nb.height - nc.height > 1) {
+        auto d = nb.child1;
+        auto e = nb.child2;
+        auto& nd = nodes[d];
+        auto& ne = nodes[e];
+
+        nb.child1 = a;
+        nb.parent = na.parent;
+        na.parent = b;
+        replace_in_parent(a, b);
+
+        if (nd.height > ne.height) {
+            nb.child2 = d;
+            na.child1 = e;
+            ne.parent = a;
+            na.box = merge(nc.box, ne.box);
+            nb.box = merge(na.box, nd.box);
+            na.height = 1 + std::max(nc.height, ne.height);
+            nb.height = 1 + std::max(na.height, nd.height);
+        } else {
+            nb.child2 = e;
+            na.child1 = d;
+            nd.parent = a;
+            na.box = merge(nc.box, nd.box);
+            nb.box = merge(na.box, ne.box);
+            na.height = 1 + std::max(nc.height, nd.height);
+            nb.height = 1 + std::max(na.height, ne.height);
+        }
+
+        return b;
+    }
+
+    return a;
+}
+
+} // namespace ember
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "bounds.hpp"
+#include "entities.hpp"
+
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace ember {
+
+/**
+ * Dynamic bounding volume hierarchy of entity bounds, for frustum culling and box queries.
+ * Leaves store their bounds enlarged by a margin, so entities moving a little do not change the tree. Insertion picks
+ * the sibling with the least added surface area and rotations keep the tree balanced, so queries visit O(log n) nodes
+ * per visible cluster. Kept up to date incrementally from the database change sets, see sync().
+ */
+class bvh {
+public:
+    explicit bvh(float margin = 0.1f);
+
+    /** Inserts an entity, or moves it if it is already present */
+    void update(database::ent_id eid, const aabb& bounds);
+
+    void remove(database::ent_id eid);
+
+    void clear();
+
+    /**
+     * Applies this frame's added, modified and removed Coms, call before database::clear_changes().
+     * bounds_of(const Com&) must return the aabb the component covers.
+     */
+    template <typename Com, typename F>
+    void sync(database& db, const F& bounds_of) {
+        for (auto eid : db.get_removed<Com>()) {
+            remove(eid);
+        }
+
+        auto refresh = [&](database::ent_id eid) {
+            if (db.exists(eid) && db.has_component<Com>(eid)) {
+                update(eid, bounds_of(db.get_component<Com>(eid)));
+            }
+        };
+
+        for (auto eid : db.get_added<Com>()) {
+            refresh(eid);
+        }
+
+        for (auto eid : db.get_modified<Com>()) {
+            refresh(eid);
+        }
+    }
+
+    /** Appends entities whose bounds intersect the frustum, subtrees fully inside are appended without testing */
+    void query_frustum(const frustum_planes& frustum, std::vector<database::ent_id>& out) const;
+
+    /** Appends entities whose bounds overlap the box */
+    void query_aabb(const aabb& area, std::vector<database::ent_id>& out) const;
+
+    auto size() const -> std::size_t { return count; }
+
+    /** Longest path from the root to a leaf, 0 for a single leaf */
+    auto height() const -> int;
+
+private:
+    static constexpr int null_node = -1;
+
+    struct node {
+        aabb box; /** Enlarged by the margin for leaves */
+        aabb tight; /** Leaves only, the bounds as given */
+        int parent = null_node; /** Next free node when on the free list */
+        int child1 = null_node;
+        int child2 = null_node;
+        int height = 0; /** 0 for leaves, -1 when free */
+        std::optional<database::ent_id> eid; /** Leaves only */
+
+        auto is_leaf() const -> bool { return child1 == null_node; }
+    };
+
+    auto allocate_node() -> int;
+
+    void free_node(int index);
+
+    void insert_leaf(int leaf);
+
+    void remove_leaf(int leaf);
+
+    /** Refits boxes and heights from index to the root, rebalancing on the way */
+    void refit(int index);
+
+    /** Rotates the subtree at index if its children heights differ by more than one, returns the new subtree root */
+    auto balance(int index) -> int;
+
+    float margin;
+    std::vector<node> nodes;
+    int root = null_node;
+    int free_list = null_node;
+    std::vector<int> leaves; /** Leaf node by entity index */
+    std::size_t count = 0;
+    mutable std::vector<std::pair<int, bool>> stack; /** Query traversal, node and whether it is inside the frustum */
+};
+
+} // namespace ember
@@ -2,6 +2,7 @@
 
 #include "scripting.hpp"
 #include "entities.hpp"
+#include "prefab.hpp"
 #include "reflection.hpp"
 
 #include <type_traits>
@@ -65,6 +66,64 @@ auto has_component(database& db, database::ent_id eid) -> bool {
     return db.has_component<T>(eid);
 }
 
+template <typename T, typename Target>
+void queue_add_component(database& db, Target target, T com) {
+    db.queue_add_component(target, std::move(com));
+}
+
+template <typename T, typename Target>
+void queue_remove_component(database& db, Target target) {
+    db.queue_remove_component<T>(target);
+}
+
+template <typename T>
+auto count_components(database& db) -> int {
+    return db.count_components<T>();
+}
+
+template <typename T>
+void mark_modified(database& db, ent_id eid) {
+    db.mark_modified<T>(eid);
+}
+
+template <typename T>
+auto get_added(database& db) -> sol::as_table_t<std::vector<ent_id>> {
+    return sol::as_table(db.get_added<T>());
+}
+
+template <typename T>
+auto get_removed(database& db) -> sol::as_table_t<std::vector<ent_id>> {
+    return sol::as_table(db.get_removed<T>());
+}
+
+template <typename T>
+auto get_modified(database& db) -> sol::as_table_t<std::vector<ent_id>> {
+    return sol::as_table(db.get_modified<T>());
+}
+
+template <typename T>
+void prefab_set(prefab& pre, T com) {
+    pre.set(std::move(com));
+}
+
+template <typename T>
+auto query_ops() -> sol::lightuserdata_value {
+    static auto ops = component_ops{
+        [](database& db) { return db.count_components<T>(); },
+        [](database& db, ent_id eid) { return db.has_component<T>(eid); },
+        [](database& db, std::vector<ent_id>& out) {
+            db.visit([&](ent_id eid, const T&) { out.push_back(eid); });
+        },
+        [](lua_State* L, database& db, ent_id eid) {
+            if constexpr (is_tag<T>::value) {
+                sol::stack::push(L, true);
+            } else {
+                sol::stack::push(L, &db.get_component<T>(eid));
+            }
+        }};
+    return sol::lightuserdata_value(&ops);
+}
+
 } //namespace _detail
 
 template <typename T>
@@ -81,6 +140,19 @@ void register_usertype(scripting::token<T>, sol::usertype<T>& usertype) {
     usertype["_add_component"] = &_detail::add_component<T>;
     usertype["_remove_component"] = &_detail::remove_component<T>;
     usertype["_has_component"] = &_detail::has_component<T>;
+    usertype["_queue_add_component"] = sol::overload(
+        &_detail::queue_add_component<T, ent_id>,
+        &_detail::queue_add_component<T, net_id::id_type>);
+    usertype["_queue_remove_component"] = sol::overload(
+        &_detail::queue_remove_component<T, ent_id>,
+        &_detail::queue_remove_component<T, net_id::id_type>);
+    usertype["_count_components"] = &_detail::count_components<T>;
+    usertype["_mark_modified"] = &_detail::mark_modified<T>;
+    usertype["_get_added"] = &_detail::get_added<T>;
+    usertype["_get_removed"] = &_detail::get_removed<T>;
+    usertype["_get_modified"] = &_detail::get_modified<T>;
+    usertype["_query_ops"] = &_detail::query_ops<T>;
+    usertype["_prefab_set"] = &_detail::prefab_set<T>;
 }
 
 } // namespace ember::component
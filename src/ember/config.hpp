@@ -18,10 +18,17 @@ struct display_t {
 };
 REFLECT(display_t, (width)(height))
 
+struct render_check_t {
+    bool enabled;
+    std::string expected_hash; /** Hex, empty to only check that the frame renders consistently */
+};
+REFLECT(render_check_t, (enabled)(expected_hash))
+
 struct config {
     display_t display;
+    render_check_t render_check;
 };
-REFLECT(config, (display))
+REFLECT(config, (display)(render_check))
 
 } // namespace ember::config
 
@@ -4,6 +4,15 @@
 
 namespace ember {
 
+auto engine::get_mesh_bounds(const sushi::mesh_group* mesh) const -> const mesh_bounds* {
+    auto iter = mesh_bounds_table.find(mesh);
+    if (iter == mesh_bounds_table.end() || iter->second.mesh.expired()) {
+        return nullptr;
+    }
+
+    return &iter->second.bounds;
+}
+
 void engine::tick() try {
     using namespace std::literals;
 
@@ -40,23 +49,12 @@ void engine::tick() try {
         current_scene->tick(std::chrono::duration<float>(delta).count());
     }
 
-    // Render scene
+    // Render
 
     glClearColor(0,0,0,1);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    if (current_scene) {
-        current_scene->render();
-        update_gui_state(current_scene->render_gui());
-    }
-
-    // Render GUI
-
-    gui::calculate_all_layouts(*root_widget);
-
-    renderer.begin();
-    gui::draw_all(*root_widget);
-    renderer.end();
+    render();
 
     // End of frame
 
@@ -75,6 +73,24 @@ void engine::tick() try {
     std::throw_with_nested(std::runtime_error("tick: "));
 }
 
+void engine::render() {
+    // Render scene
+
+    if (current_scene) {
+        current_scene->render();
+        update_gui_state(current_scene->render_gui());
+    }
+
+    // Render GUI
+
+    glyph_jobs.begin_frame();
+    gui::calculate_all_layouts(*root_widget);
+
+    renderer.begin();
+    gui::draw_all(*root_widget);
+    renderer.end();
+}
+
 auto engine::handle_game_input(const SDL_Event& event) -> bool try {
     switch (event.type) {
     case SDL_QUIT:
@@ -1,13 +1,20 @@
 #pragma once
 
+#include "atom.hpp"
+#include "bounds.hpp"
 #include "config.hpp"
 #include "display.hpp"
 #include "font.hpp"
+#include "glyph_atlas.hpp"
+#include "glyph_generator.hpp"
+#include "instancing.hpp"
 #include "resource_cache.hpp"
 #include "sdl.hpp"
 #include "sushi_renderer.hpp"
 #include "scene.hpp"
 #include "shaders.hpp"
+#include "texture_atlas.hpp"
+#include "thread_pool.hpp"
 
 #include <sol.hpp>
 #include <sushi/sushi.hpp>
@@ -18,6 +25,7 @@
 #include <chrono>
 #include <sstream>
 #include <iostream>
+#include <unordered_map>
 
 namespace ember {
 
@@ -39,6 +47,12 @@ public:
 
     void tick();
 
+    /** Object space bounds of a mesh loaded by mesh_cache, null for meshes built elsewhere */
+    auto get_mesh_bounds(const sushi::mesh_group* mesh) const -> const mesh_bounds*;
+
+    /** Renders the current scene and the GUI through the current render backend, without clearing or presenting */
+    void render();
+
     template <typename... Ts>
     auto call_script(const std::string& module_name, const std::string& function_name, Ts&&... args)
         -> sol::function_result;
@@ -49,14 +63,20 @@ public:
     sol::state lua;
     display_info display;
     SoLoud::Soloud soloud;
-    resource_cache<sushi::mesh_group, std::string> mesh_cache;
-    resource_cache<sushi::skeleton, std::string> skeleton_cache;
-    resource_cache<sushi::texture_2d, std::string> texture_cache;
-    resource_cache<msdf_font, std::string> font_cache;
-    resource_cache<SoLoud::Wav, std::string> sound_cache;
-    resource_cache<SoLoud::WavStream, std::string> music_cache;
+    resource_cache<sushi::mesh_group, atom> mesh_cache;
+    resource_cache<sushi::skeleton, atom> skeleton_cache;
+    resource_cache<instanced_mesh, atom> instanced_mesh_cache;
+    resource_cache<sushi::texture_2d, atom> texture_cache;
+    texture_atlas atlas;
+    glyph_atlas glyphs;
+    resource_cache<msdf_font, atom> font_cache;
+    resource_cache<SoLoud::Wav, atom> sound_cache;
+    resource_cache<SoLoud::WavStream, atom> music_cache;
     shaders::basic_shader_program basic_shader;
-    shaders::msdf_shader_program msdf_shader;
+    shaders::instanced_shader_program instanced_shader;
+    shaders::gui_shader_program gui_shader;
+    thread_pool workers;
+    glyph_generator glyph_jobs; /** After workers, so glyph tasks finish before the pool stops */
 
 private:
     void register_engine_module();
@@ -81,6 +101,13 @@ private:
     };
 
     std::optional<transition> queued_transition;
+
+    struct loaded_bounds {
+        std::weak_ptr<sushi::mesh_group> mesh; /** Expired once the mesh is unloaded and its address can be reused */
+        mesh_bounds bounds;
+    };
+
+    std::unordered_map<const sushi::mesh_group*, loaded_bounds> mesh_bounds_table; /** Filled in by mesh_cache */
 };
 
 template <typename... Ts>
@@ -1,10 +1,15 @@
 #include "engine.hpp"
 
+#include "gl_state.hpp"
+#include "iqm.hpp"
 #include "math.hpp"
 #include "lua_gui.hpp"
 #include "component_common.hpp"
 #include "scripting.hpp"
 #include "entities.hpp"
+#include "prefab.hpp"
+#include "spatial_grid.hpp"
+#include "utility.hpp"
 
 #include <sol.hpp>
 
@@ -30,6 +35,8 @@ engine::engine(const config::config& config) {
     math::register_types(globals);
     lua_gui::register_types(globals);
     scripting::register_type<database>(globals);
+    scripting::register_type<spatial_grid>(globals);
+    scripting::register_type<prefab>(globals);
     register_engine_module();
 
     {
@@ -71,7 +78,15 @@ engine::engine(const config::config& config) {
     // Compile Shaders
 
     basic_shader = shaders::basic_shader_program("data/shaders/basic.vert", "data/shaders/basic.frag");
-    msdf_shader = shaders::msdf_shader_program("data/shaders/msdf.vert", "data/shaders/msdf.frag");
+    gui_shader = shaders::gui_shader_program("data/shaders/gui.vert", "data/shaders/gui.frag");
+    instanced_shader =
+        shaders::instanced_shader_program("data/shaders/instanced.vert", "data/shaders/instanced.frag");
+
+    instanced_shader.bind();
+    instanced_shader.set_s_texture(0);
+
+    gui_shader.bind();
+    gui_shader.set_s_texture(0);
 
     basic_shader.bind();
     basic_shader.set_s_texture(0);
@@ -81,38 +96,65 @@ engine::engine(const config::config& config) {
 
     // Resource caches
 
-    mesh_cache = [](const std::string& name) -> sushi::mesh_group {
-        auto load_default = []() -> sushi::mesh_group {
-            auto iqm = sushi::iqm::load_iqm("data/models/default.iqm");
+    mesh_cache = [this](const atom& name) -> std::shared_ptr<sushi::mesh_group> {
+        // Bounds are read while the file is loaded and keyed by the mesh, so every model drawing it can be culled
+        auto load = [this](const std::string& filename) -> std::shared_ptr<sushi::mesh_group> {
+            auto iqm = sushi::iqm::load_iqm(filename);
             if (!iqm) {
+                return nullptr;
+            }
+
+            auto mesh = std::make_shared<sushi::mesh_group>(sushi::load_meshes(*iqm));
+
+            if (auto geo = ember::iqm::load_geometry(filename); geo && !geo->positions.empty()) {
+                mesh_bounds_table.insert_or_assign(
+                    mesh.get(), loaded_bounds{mesh, mesh_bounds::from_points(geo->positions)});
+            } else {
+                std::cerr << "Warning: Failed to load bounds of mesh \"" << filename << "\"\n";
+            }
+
+            return mesh;
+        };
+
+        auto load_default = [&]() -> std::shared_ptr<sushi::mesh_group> {
+            auto mesh = load("data/models/default.iqm");
+            if (!mesh) {
                 std::cerr << "ERROR: Failed to load default IQM mesh!\n";
-                return {};
+                return std::make_shared<sushi::mesh_group>();
             }
 
-            auto mesh = sushi::load_meshes(*iqm);
-            if (mesh.meshes.empty()) {
+            if (mesh->meshes.empty()) {
                 std::cerr << "ERROR: Default IQM file does not contain any meshes\n";
             }
 
             return mesh;
         };
 
-        auto iqm = sushi::iqm::load_iqm("data/models/" + name + ".iqm");
-        if (!iqm) {
+        auto mesh = load("data/models/" + name.str() + ".iqm");
+        if (!mesh) {
             std::cerr << "ERROR: Failed to load IQM mesh \"" << name << "\", loading default\n";
             return load_default();
         }
 
-        auto mesh = sushi::load_meshes(*iqm);
-        if (mesh.meshes.empty()) {
+        if (mesh->meshes.empty()) {
             std::cerr << "ERROR: IQM file \"" << name << "\" does not contain any meshes\n";
         }
 
         return mesh;
     };
 
-    skeleton_cache = [](const std::string& name) -> std::shared_ptr<sushi::skeleton> {
-        auto iqm = sushi::iqm::load_iqm("data/models/" + name + ".iqm");
+    instanced_mesh_cache = [](const atom& name) -> std::shared_ptr<instanced_mesh> {
+        auto mesh = instanced_mesh::load_iqm("data/models/" + name.str() + ".iqm");
+        if (!mesh) {
+            std::cerr << "Warning: Failed to load instanced mesh \"" << name << "\"\n";
+            return nullptr;
+        }
+
+        return std::make_shared<instanced_mesh>(std::move(*mesh));
+    };
+
+    skeleton_cache = [](const atom& name) -> std::shared_ptr<sushi::skeleton> {
+        auto iqm = sushi::iqm::load_iqm("data/models/" + name.str() + ".iqm");
         if (!iqm) {
             std::cerr << "Warning: Failed to load IQM skeleton \"" << name << "\"\n";
             return nullptr;
@@ -131,14 +173,17 @@ engine::engine(const config::config& config) {
         return std::make_shared<sushi::skeleton>(std::move(skele));
     };
 
-    texture_cache = [](const std::string& name) {
-        if (name == ":white") {
+    texture_cache = [](const atom& name) {
+        // Loading binds the new texture, so the shadowed bindings are stale afterwards
+        EMBER_DEFER { gl_state::invalidate_textures(); };
+
+        if (name.str() == ":white") {
             unsigned char white[4] = { 0xff, 0xff, 0xff, 0xff };
             auto tex = sushi::create_uninitialized_texture_2d(1, 1, sushi::TexType::COLORA);
             glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, white);
             return tex;
         } else {
-            auto tex = sushi::load_texture_2d("data/textures/" + name + ".png", false, false, false, false);
+            auto tex = sushi::load_texture_2d("data/textures/" + name.str() + ".png", false, false, false, false);
             if (tex.handle) {
                 return tex;
             } else {
@@ -147,19 +192,27 @@ engine::engine(const config::config& config) {
         }
     };
 
-    font_cache = [](const std::string& fontname) {
-        return msdf_font("data/fonts/"+fontname+".ttf");
+    atlas = texture_atlas("data/textures/atlas.json");
+
+    glyph_jobs = glyph_generator(&workers);
+
+    font_cache = [this](const atom& fontname) {
+        auto path = "data/fonts/" + fontname.str();
+        if (auto cooked = msdf_font::load_cooked(path + ".font", path + ".ttf", glyphs, &glyph_jobs)) {
+            return std::move(*cooked);
+        }
+        return msdf_font(path + ".ttf", glyphs, &glyph_jobs);
     };
 
-    sound_cache = [](const std::string& name) {
+    sound_cache = [](const atom& name) {
         auto wav = std::make_shared<SoLoud::Wav>();;
-        wav->load(("data/sfx/" + name + ".wav").c_str());
+        wav->load(("data/sfx/" + name.str() + ".wav").c_str());
         return wav;
     };
 
-    music_cache = [](const std::string& name) {
+    music_cache = [](const atom& name) {
         auto wav = std::make_shared<SoLoud::WavStream>();;
-        wav->load(("data/bgm/" + name + ".ogg").c_str());
+        wav->load(("data/bgm/" + name.str() + ".ogg").c_str());
         wav->setLooping(1);
         return wav;
     };
@@ -169,10 +222,12 @@ engine::engine(const config::config& config) {
     renderer = sushi_renderer(
         {display.width, display.height},
         basic_shader,
-        msdf_shader,
+        gui_shader,
         font_cache,
+        glyphs,
         mesh_cache,
-        texture_cache);
+        texture_cache,
+        &atlas);
 
     root_widget = std::make_shared<gui::widget>(renderer);
     root_widget->set_attribute("width", std::to_string(display.width));
@@ -192,6 +247,9 @@ engine::engine(const config::config& config) {
 
     update_gui_state = lua["update_gui_state"];
 
+    // Construction bound programs and textures directly, start the frame loop with a clean shadow
+    gl_state::invalidate();
+
     // Timer setup
 
     prev_time = clock::now();
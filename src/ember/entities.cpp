@@ -1,7 +1,9 @@
 #include "entities.hpp"
 
 #include "net_id.hpp"
+#include "prefab.hpp"
 
+#include <algorithm>
 #include <iostream>
 
 namespace ember {
@@ -11,37 +13,77 @@ auto database::create_entity() -> ent_id {
 }
 
 auto database::create_entity(net_id::id_type id) -> ent_id {
-    auto iter = netid_to_entid.find(id);
-
-    if (iter != netid_to_entid.end()) {
+    if (auto entry = find_entity(id)) {
         std::clog << "Warning: Entity " << id << " created twice!" << std::endl;
-        return iter->second;
+        return entry->value;
     }
 
+    check_structural_change();
+
     auto ent = ginseng::database::create_entity();
     ginseng::database::add_component(ent, net_id{id});
-    netid_to_entid.insert_or_assign(id, ent);
+    netid_to_entid.insert_or_assign(id, ent, current_generation(ent));
 
     return ent;
 }
 
+auto database::create_entities(utility::span<const net_id::id_type> ids) -> std::vector<ent_id> {
+    auto result = std::vector<ent_id>{};
+    result.reserve(ids.size());
+
+    netid_to_entid.reserve(netid_to_entid.size() + ids.size());
+
+    for (auto id : ids) {
+        result.push_back(create_entity(id));
+    }
+
+    return result;
+}
+
+auto database::instantiate(const prefab& pre, int count) -> std::vector<ent_id> {
+    check_structural_change();
+
+    auto ids = std::vector<net_id::id_type>{};
+    ids.reserve(count);
+
+    for (int i = 0; i < count; ++i) {
+        ids.push_back(next_id++);
+    }
+
+    auto eids = create_entities({ids.data(), ids.size()});
+
+    for (const auto& com : pre.components) {
+        com->instantiate(*this, {eids.data(), eids.size()});
+    }
+
+    return eids;
+}
+
 void database::destroy_entity(net_id::id_type id) {
-    auto iter = netid_to_entid.find(id);
+    check_structural_change();
 
-    if (iter == netid_to_entid.end()) {
+    auto entry = find_entity(id);
+
+    if (!entry) {
         std::clog << "Warning: Attempted to erase unknown entity " << id << "!" << std::endl;
         return;
     }
 
+    auto eid = entry->value;
+
     if (destroy_entity_callback) {
         destroy_entity_callback(id);
     }
 
-    ginseng::database::destroy_entity(iter->second);
-    netid_to_entid.erase(iter);
+    note_destroyed(eid);
+    ginseng::database::destroy_entity(eid);
+    netid_to_entid.erase(id);
+    bump_generation(eid);
 }
 
 void database::destroy_entity(ent_id eid) {
+    check_structural_change();
+
     if (has_component<net_id>(eid)) {
         auto id = get_component<net_id>(eid).id;
 
@@ -49,30 +91,41 @@ void database::destroy_entity(ent_id eid) {
             destroy_entity_callback(id);
         }
 
-        auto iter = netid_to_entid.find(id);
-        netid_to_entid.erase(iter);
+        netid_to_entid.erase(id);
     } else {
         std::clog << "Warning: deleting entity that has no net_id!" << std::endl;
     }
 
+    note_destroyed(eid);
     ginseng::database::destroy_entity(eid);
+    bump_generation(eid);
+}
+
+void database::destroy_entities(utility::span<const net_id::id_type> ids) {
+    for (auto id : ids) {
+        destroy_entity(id);
+    }
+}
+
+void database::destroy_entities(utility::span<const ent_id> eids) {
+    for (auto eid : eids) {
+        destroy_entity(eid);
+    }
 }
 
 auto database::get_entity(net_id::id_type id) -> std::optional<ent_id> {
-    auto iter = netid_to_entid.find(id);
-    if (iter == netid_to_entid.end()) {
-        return std::nullopt;
+    if (auto entry = find_entity(id)) {
+        return entry->value;
     } else {
-        return iter->second;
+        return std::nullopt;
     }
 }
 
 auto database::get_or_create_entity(net_id::id_type id) -> ent_id {
-    auto iter = netid_to_entid.find(id);
-    if (iter == netid_to_entid.end()) {
-        return create_entity(id);
+    if (auto entry = find_entity(id)) {
+        return entry->value;
     } else {
-        return iter->second;
+        return create_entity(id);
     }
 }
 
@@ -80,6 +133,179 @@ void database::on_destroy_entity(std::function<void(net_id::id_type id)> func) {
     destroy_entity_callback = std::move(func);
 }
 
+auto database::get_next_net_id() const -> net_id::id_type {
+    return next_id;
+}
+
+void database::set_next_net_id(net_id::id_type id) {
+    next_id = id;
+}
+
+void database::set_thread_pool(thread_pool* pool) {
+    workers = pool;
+}
+
+void database::clear_changes() {
+    for (auto& [guid, entry] : census) {
+        entry.added.clear();
+        entry.removed.clear();
+        entry.modified.clear();
+    }
+}
+
+void database::note_destroyed(ent_id eid) {
+    for (auto& [guid, entry] : census) {
+        if (entry.has_component(*this, eid)) {
+            --entry.count;
+            entry.removed.push_back(eid);
+        }
+    }
+}
+
+auto database::queue_create_entity() -> net_id::id_type {
+    auto lock = std::lock_guard(command_mutex);
+    auto id = next_id++;
+    queued_creates.push_back(id);
+    return id;
+}
+
+void database::queue_destroy_entity(net_id::id_type id) {
+    auto lock = std::lock_guard(command_mutex);
+    queued_destroys.push_back(command_target{id});
+}
+
+void database::queue_destroy_entity(ent_id eid) {
+    auto lock = std::lock_guard(command_mutex);
+    queued_destroys.push_back(command_target{eid});
+}
+
+void database::flush_commands() {
+    auto creates = std::vector<net_id::id_type>{};
+    auto destroys = std::vector<command_target>{};
+
+    {
+        auto lock = std::lock_guard(command_mutex);
+        creates = std::exchange(queued_creates, {});
+        destroys = std::exchange(queued_destroys, {});
+    }
+
+    create_entities({creates.data(), creates.size()});
+
+    for (auto& [guid, queue] : command_queues) {
+        queue->apply_adds(*this);
+    }
+
+    for (auto& [guid, queue] : command_queues) {
+        queue->apply_removes(*this);
+    }
+
+    auto eids = std::vector<ent_id>{};
+    eids.reserve(destroys.size());
+
+    for (const auto& target : destroys) {
+        if (auto eid = resolve(target)) {
+            eids.push_back(*eid);
+        }
+    }
+
+    std::sort(begin(eids), end(eids), [](auto& a, auto& b) {
+        return a.get_index() < b.get_index();
+    });
+    eids.erase(std::unique(begin(eids), end(eids)), end(eids));
+
+    destroy_entities({eids.data(), eids.size()});
+}
+
+auto database::resolve(const command_target& target) -> std::optional<ent_id> {
+    if (auto eid = std::get_if<ent_id>(&target)) {
+        if (exists(*eid)) {
+            return *eid;
+        } else {
+            return std::nullopt;
+        }
+    } else {
+        return get_entity(std::get<net_id::id_type>(target));
+    }
+}
+
+auto database::current_generation(ent_id eid) -> generational_index<ent_id>::generation_type& {
+    auto index = eid.get_index();
+
+    if (index >= generations.size()) {
+        generations.resize(index + 1, 1);
+    }
+
+    return generations[index];
+}
+
+void database::bump_generation(ent_id eid) {
+    auto& gen = current_generation(eid);
+
+    // Generation 0 marks empty index slots, so it is skipped on wraparound
+    if (++gen == 0) {
+        gen = 1;
+    }
+}
+
+auto database::find_entity(net_id::id_type id) const -> const generational_index<ent_id>::entry* {
+    auto entry = netid_to_entid.find(id);
+
+    if (entry && entry->generation == generations[entry->value.get_index()]) {
+        return entry;
+    } else {
+        return nullptr;
+    }
+}
+
+database_query::database_query(database& db, std::vector<const component_ops*> ops) :
+    db(&db), ops(std::move(ops)) {
+    if (this->ops.empty()) {
+        throw std::runtime_error("database.query(): No component types given");
+    }
+}
+
+void database_query::each(sol::protected_function func) {
+    // Drive the visit from the rarest component, the rest are checked per entity
+    auto driver = *std::min_element(begin(ops), end(ops), [&](auto a, auto b) {
+        return a->count(*db) < b->count(*db);
+    });
+
+    // Taken out of the member so a callback running the same query does not clobber it
+    auto current = std::exchange(matches, {});
+    EMBER_DEFER { matches = std::move(current); };
+
+    current.clear();
+    driver->collect(*db, current);
+
+    auto L = func.lua_state();
+    auto coms = std::vector<sol::object>{};
+    coms.reserve(ops.size());
+
+    for (auto eid : current) {
+        // The callback may have destroyed this entity or removed its components
+        auto matched = db->exists(eid) && std::all_of(begin(ops), end(ops), [&](auto op) {
+            return op->has(*db, eid);
+        });
+
+        if (!matched) {
+            continue;
+        }
+
+        coms.clear();
+        for (auto op : ops) {
+            op->push(L, *db, eid);
+            coms.emplace_back(L, -1);
+            lua_pop(L, 1);
+        }
+
+        auto result = func(eid, sol::as_args(coms));
+        if (!result.valid()) {
+            sol::error error = result;
+            throw std::runtime_error(std::string("database.query(): ") + error.what());
+        }
+    }
+}
+
 namespace scripting {
 
 template <>
@@ -88,6 +314,9 @@ void register_type<database>(sol::table& lua) {
         "get_index", &database::ent_id::get_index,
         sol::meta_function::equal_to, &database::ent_id::operator==);
 
+    lua.new_usertype<database_query>("database_query", sol::no_constructor,
+        "each", &database_query::each);
+
     lua.new_usertype<database>("database",
         "create_entity", sol::overload(
             sol::resolve<database::ent_id()>(&database::create_entity),
@@ -138,6 +367,60 @@ void register_type<database>(sol::table& lua) {
             }
             return has_component(db, eid);
         },
+        "queue_create_entity", &database::queue_create_entity,
+        "queue_destroy_entity", sol::overload(
+            sol::resolve<void(database::ent_id)>(&database::queue_destroy_entity),
+            sol::resolve<void(net_id::id_type)>(&database::queue_destroy_entity)),
+        "queue_add_component", [](database& db, sol::object target, sol::userdata com){
+            auto queue_add_component = com["_queue_add_component"];
+            if (!queue_add_component.valid()) {
+                throw std::runtime_error("queue_add_component: Component type missing _queue_add_component");
+            }
+            return queue_add_component(db, target, com);
+        },
+        "queue_remove_component", [](database& db, sol::object target, sol::table com_type){
+            auto queue_remove_component = com_type["_queue_remove_component"];
+            if (!queue_remove_component.valid()) {
+                throw std::runtime_error("queue_remove_component: Component type missing _queue_remove_component");
+            }
+            return queue_remove_component(db, target);
+        },
+        "flush_commands", &database::flush_commands,
+        "count_components", [](database& db, sol::table com_type){
+            auto count_components = com_type["_count_components"];
+            if (!count_components.valid()) {
+                throw std::runtime_error("count_components: Component type missing _count_components");
+            }
+            return count_components(db);
+        },
+        "mark_modified", [](database& db, database::ent_id eid, sol::table com_type){
+            auto mark_modified = com_type["_mark_modified"];
+            if (!mark_modified.valid()) {
+                throw std::runtime_error("mark_modified: Component type missing _mark_modified");
+            }
+            return mark_modified(db, eid);
+        },
+        "get_added", [](database& db, sol::table com_type){
+            auto get_added = com_type["_get_added"];
+            if (!get_added.valid()) {
+                throw std::runtime_error("get_added: Component type missing _get_added");
+            }
+            return get_added(db);
+        },
+        "get_removed", [](database& db, sol::table com_type){
+            auto get_removed = com_type["_get_removed"];
+            if (!get_removed.valid()) {
+                throw std::runtime_error("get_removed: Component type missing _get_removed");
+            }
+            return get_removed(db);
+        },
+        "get_modified", [](database& db, sol::table com_type){
+            auto get_modified = com_type["_get_modified"];
+            if (!get_modified.valid()) {
+                throw std::runtime_error("get_modified: Component type missing _get_modified");
+            }
+            return get_modified(db);
+        },
         "visit", [](database& db, sol::protected_function func){
             db.visit([&func](database::ent_id eid) {
                 auto result = func(eid);
@@ -147,6 +430,23 @@ void register_type<database>(sol::table& lua) {
                 }
             });
         },
+        "query", [](database& db, sol::table com_types){
+            auto ops = std::vector<const component_ops*>{};
+            ops.reserve(com_types.size());
+            for (std::size_t i = 1; i <= com_types.size(); ++i) {
+                sol::table com_type = com_types[i];
+                auto query_ops = com_type["_query_ops"];
+                if (!query_ops.valid()) {
+                    throw std::runtime_error("query: Component type missing _query_ops");
+                }
+                sol::lightuserdata_value light = query_ops();
+                ops.push_back(static_cast<const component_ops*>(light.value));
+            }
+            return database_query(db, std::move(ops));
+        },
+        "instantiate", [](database& db, const prefab& pre, std::optional<int> count){
+            return sol::as_table(db.instantiate(pre, count.value_or(1)));
+        },
         "to_ptr", &database::to_ptr,
         "from_ptr", &database::from_ptr);
 }
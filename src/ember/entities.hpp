@@ -4,16 +4,26 @@
 #include "utility.hpp"
 #include "reflection.hpp"
 #include "net_id.hpp"
+#include "generational_index.hpp"
+#include "thread_pool.hpp"
 
 #include <ginseng/ginseng.hpp>
 
+#include <atomic>
 #include <cstdint>
+#include <memory>
+#include <mutex>
 #include <unordered_map>
 #include <optional>
+#include <stdexcept>
 #include <tuple>
+#include <variant>
+#include <vector>
 
 namespace ember {
 
+class prefab;
+
 class database : public ginseng::database {
     template <typename... Coms>
     struct entity_serializer {
@@ -39,16 +49,28 @@ public:
 
     auto create_entity(net_id::id_type id) -> ent_id;
 
+    /** Creates one entity per id, growing the net_id index only once */
+    auto create_entities(utility::span<const net_id::id_type> ids) -> std::vector<ent_id>;
+
     void destroy_entity(net_id::id_type id);
 
     void destroy_entity(ent_id eid);
 
+    void destroy_entities(utility::span<const net_id::id_type> ids);
+
+    void destroy_entities(utility::span<const ent_id> eids);
+
     auto get_entity(net_id::id_type id) -> std::optional<ent_id>;
 
     auto get_or_create_entity(net_id::id_type id) -> ent_id;
 
     void on_destroy_entity(std::function<void(net_id::id_type id)> func);
 
+    /** The net_id the next create_entity() will use */
+    auto get_next_net_id() const -> net_id::id_type;
+
+    void set_next_net_id(net_id::id_type id);
+
     template <typename... Coms>
     auto serialize_entity(ent_id eid) -> std::tuple<std::optional<Coms>...> {
         return entity_serializer<Coms...>::serialize(*this, eid);
@@ -57,43 +79,334 @@ public:
     template <typename T>
     com_id add_component(ent_id eid, T&& com) {
         using com_type = std::decay_t<T>;
-        auto guid = ginseng::_detail::get_type_guid<com_type>();
 
-        ++com_counts[guid];
+        check_structural_change();
+        note_added<com_type>(eid);
 
         return ginseng::database::add_component(eid, std::forward<T>(com));
     }
 
     template <typename T>
     void add_component(ent_id eid, ginseng::tag<T> com) {
-        auto guid = ginseng::_detail::get_type_guid<ginseng::tag<T>>();
-
-        ++com_counts[guid];
+        check_structural_change();
+        note_added<ginseng::tag<T>>(eid);
 
         return ginseng::database::add_component(eid, com);
     }
 
+    /** Adds a copy of com to every entity, looking up the census only once */
+    template <typename Com>
+    void add_components(utility::span<const ent_id> eids, const Com& com) {
+        check_structural_change();
+
+        auto& entry = get_census<Com>();
+        entry.added.reserve(entry.added.size() + eids.size());
+
+        for (auto eid : eids) {
+            if (has_component<Com>(eid)) {
+                entry.modified.push_back(eid);
+            } else {
+                ++entry.count;
+                entry.added.push_back(eid);
+            }
+
+            ginseng::database::add_component(eid, Com(com));
+        }
+    }
+
+    /** Creates count entities with copies of the prefab's components, batched per component type */
+    auto instantiate(const prefab& pre, int count = 1) -> std::vector<ent_id>;
+
     template <typename Com>
     void remove_component(ent_id eid) {
-        auto guid = ginseng::_detail::get_type_guid<Com>();
+        check_structural_change();
 
-        --com_counts[guid];
+        if (has_component<Com>(eid)) {
+            auto& entry = get_census<Com>();
+            --entry.count;
+            entry.removed.push_back(eid);
+        }
 
         ginseng::database::remove_component<Com>(eid);
     }
 
+    /** Pool used by parallel_visit(), without one it runs serially */
+    void set_thread_pool(thread_pool* pool);
+
+    /**
+     * Visits entities having all of Coms, calling func(eid, coms...) from multiple threads in chunks of grain.
+     * Structural changes throw until it returns, use the command buffer instead.
+     */
+    template <typename... Coms, typename F>
+    void parallel_visit(const F& func, std::size_t grain = 256) {
+        using match_list = std::vector<std::tuple<ent_id, Coms*...>>;
+
+        // Falls back to a temporary list when the kept one is in use, by a nested call or a concurrent system
+        auto buffer = acquire_match_buffer<match_list>();
+        EMBER_DEFER {
+            if (buffer) {
+                buffer->in_use.store(false, std::memory_order_release);
+            }
+        };
+
+        auto temporary = match_list{};
+        auto& matches = buffer ? buffer->matches : temporary;
+        matches.clear();
+
+        visit([&](ent_id eid, Coms&... coms) {
+            matches.emplace_back(eid, &coms...);
+        });
+
+        ++structural_locks;
+        EMBER_DEFER { --structural_locks; };
+
+        auto run = [&](std::size_t begin, std::size_t end) {
+            for (auto i = begin; i < end; ++i) {
+                std::apply([&](ent_id eid, Coms*... coms) { func(eid, *coms...); }, matches[i]);
+            }
+        };
+
+        if (workers) {
+            workers->parallel_for(matches.size(), grain, run);
+        } else {
+            run(0, matches.size());
+        }
+    }
+
+    /** Number of live components of type Com, O(1) */
     template <typename Com>
     int count_components() {
-        int r = 0;
-        visit([&](const Com&){ ++r; });
-        return r;
+        auto iter = census.find(ginseng::_detail::get_type_guid<Com>());
+        return iter != census.end() ? iter->second.count : 0;
     }
 
+    /** Flags a component as modified for the current frame, safe to call from parallel systems */
+    template <typename Com>
+    void mark_modified(ent_id eid) {
+        auto lock = std::lock_guard(command_mutex);
+        get_census<Com>().modified.push_back(eid);
+    }
+
+    /** Entities that gained a Com since the last clear_changes() */
+    template <typename Com>
+    auto get_added() -> const std::vector<ent_id>& {
+        return get_census<Com>().added;
+    }
+
+    /** Entities that lost a Com since the last clear_changes(), they might no longer exist */
+    template <typename Com>
+    auto get_removed() -> const std::vector<ent_id>& {
+        return get_census<Com>().removed;
+    }
+
+    /** Entities that had a Com flagged with mark_modified() since the last clear_changes() */
+    template <typename Com>
+    auto get_modified() -> const std::vector<ent_id>& {
+        return get_census<Com>().modified;
+    }
+
+    /** Clears the added/removed/modified sets of every component type, call once per frame */
+    void clear_changes();
+
+    // Command buffer, safe to use while visiting and from parallel systems
+
+    /** Queues an entity for creation, returns the net_id it will have after flush_commands() */
+    auto queue_create_entity() -> net_id::id_type;
+
+    void queue_destroy_entity(net_id::id_type id);
+
+    void queue_destroy_entity(ent_id eid);
+
+    template <typename T>
+    void queue_add_component(net_id::id_type id, T&& com) {
+        auto lock = std::lock_guard(command_mutex);
+        get_command_queue<std::decay_t<T>>().adds.emplace_back(command_target{id}, std::forward<T>(com));
+    }
+
+    template <typename T>
+    void queue_add_component(ent_id eid, T&& com) {
+        auto lock = std::lock_guard(command_mutex);
+        get_command_queue<std::decay_t<T>>().adds.emplace_back(command_target{eid}, std::forward<T>(com));
+    }
+
+    template <typename Com>
+    void queue_remove_component(net_id::id_type id) {
+        auto lock = std::lock_guard(command_mutex);
+        get_command_queue<Com>().removes.push_back(command_target{id});
+    }
+
+    template <typename Com>
+    void queue_remove_component(ent_id eid) {
+        auto lock = std::lock_guard(command_mutex);
+        get_command_queue<Com>().removes.push_back(command_target{eid});
+    }
+
+    /**
+     * Applies all queued commands in batches: creates, then adds, then removes, then destroys.
+     * Commands queued while flushing are kept for the next flush.
+     * Must not run concurrently with systems that use the database.
+     */
+    void flush_commands();
+
 private:
+    /** Census of a single component type */
+    struct census_entry {
+        int count = 0;
+        std::vector<ent_id> added;
+        std::vector<ent_id> removed;
+        std::vector<ent_id> modified;
+        bool (*has_component)(database& db, ent_id eid) = nullptr;
+    };
+
+    template <typename Com>
+    auto get_census() -> census_entry& {
+        auto& entry = census[ginseng::_detail::get_type_guid<Com>()];
+        if (!entry.has_component) {
+            entry.has_component = [](database& db, ent_id eid) { return db.has_component<Com>(eid); };
+        }
+        return entry;
+    }
+
+    template <typename Com>
+    void note_added(ent_id eid) {
+        auto& entry = get_census<Com>();
+        if (has_component<Com>(eid)) {
+            entry.modified.push_back(eid);
+        } else {
+            ++entry.count;
+            entry.added.push_back(eid);
+        }
+    }
+
+    void note_destroyed(ent_id eid);
+
+    void check_structural_change() const {
+        if (structural_locks > 0) {
+            throw std::logic_error("database: structural change during parallel_visit(), use the command buffer");
+        }
+    }
+
+    using command_target = std::variant<ent_id, net_id::id_type>;
+
+    /** Resolves a command target, nullopt if the entity no longer exists */
+    auto resolve(const command_target& target) -> std::optional<ent_id>;
+
+    /** Queued adds and removes of a single component type */
+    struct command_queue_base {
+        virtual ~command_queue_base() = default;
+        virtual void apply_adds(database& db) = 0;
+        virtual void apply_removes(database& db) = 0;
+    };
+
+    template <typename Com>
+    struct command_queue final : command_queue_base {
+        std::vector<std::pair<command_target, Com>> adds;
+        std::vector<command_target> removes;
+
+        virtual void apply_adds(database& db) override {
+            auto pending = decltype(adds){};
+            {
+                auto lock = std::lock_guard(db.command_mutex);
+                pending = std::exchange(adds, {});
+            }
+            for (auto& [target, com] : pending) {
+                if (auto eid = db.resolve(target)) {
+                    db.add_component(*eid, std::move(com));
+                }
+            }
+        }
+
+        virtual void apply_removes(database& db) override {
+            auto pending = decltype(removes){};
+            {
+                auto lock = std::lock_guard(db.command_mutex);
+                pending = std::exchange(removes, {});
+            }
+            for (auto& target : pending) {
+                auto eid = db.resolve(target);
+                if (eid && db.has_component<Com>(*eid)) {
+                    db.remove_component<Com>(*eid);
+                }
+            }
+        }
+    };
+
+    template <typename Com>
+    auto get_command_queue() -> command_queue<Com>& {
+        auto& queue = command_queues[ginseng::_detail::get_type_guid<Com>()];
+        if (!queue) {
+            queue = std::make_unique<command_queue<Com>>();
+        }
+        return static_cast<command_queue<Com>&>(*queue);
+    }
+
+    struct match_buffer_base {
+        virtual ~match_buffer_base() = default;
+    };
+
+    template <typename List>
+    struct match_buffer final : match_buffer_base {
+        std::atomic<bool> in_use = false;
+        List matches;
+    };
+
+    /** Claims the match list kept between parallel_visit() calls over the same components, nullptr if it is taken */
+    template <typename List>
+    auto acquire_match_buffer() -> match_buffer<List>* {
+        auto lock = std::lock_guard(match_mutex);
+        auto& buffer = match_buffers[ginseng::_detail::get_type_guid<List>()];
+        if (!buffer) {
+            buffer = std::make_unique<match_buffer<List>>();
+        }
+        auto& typed = static_cast<match_buffer<List>&>(*buffer);
+        return typed.in_use.exchange(true, std::memory_order_acquire) ? nullptr : &typed;
+    }
+
+    auto current_generation(ent_id eid) -> generational_index<ent_id>::generation_type&;
+
+    void bump_generation(ent_id eid);
+
+    /** Looks up a net_id, rejecting entries whose entity slot has since been recycled */
+    auto find_entity(net_id::id_type id) const -> const generational_index<ent_id>::entry*;
+
     net_id::id_type next_id = 1;
-    std::unordered_map<net_id::id_type, ent_id> netid_to_entid;
+    generational_index<ent_id> netid_to_entid;
+    std::vector<generational_index<ent_id>::generation_type> generations;
     std::function<void(net_id::id_type id)> destroy_entity_callback;
-    std::unordered_map<ginseng::_detail::type_guid, int> com_counts;
+    std::unordered_map<ginseng::_detail::type_guid, census_entry> census;
+    thread_pool* workers = nullptr;
+    std::atomic<int> structural_locks = 0;
+    std::mutex command_mutex;
+    std::vector<net_id::id_type> queued_creates;
+    std::vector<command_target> queued_destroys;
+    std::unordered_map<ginseng::_detail::type_guid, std::unique_ptr<command_queue_base>> command_queues;
+    std::mutex match_mutex;
+    std::unordered_map<ginseng::_detail::type_guid, std::unique_ptr<match_buffer_base>> match_buffers;
+};
+
+/** Type-erased access to one component type, used by queries built at runtime */
+struct component_ops {
+    int (*count)(database& db);
+    bool (*has)(database& db, database::ent_id eid);
+    void (*collect)(database& db, std::vector<database::ent_id>& out); /** Appends every entity having the component */
+    void (*push)(lua_State* L, database& db, database::ent_id eid);    /** Pushes a reference to the component */
+};
+
+/**
+ * Lua query over a fixed set of component types, meant to be built once and run every frame.
+ * Matching happens in C++, and callbacks receive the components directly.
+ */
+class database_query {
+public:
+    database_query(database& db, std::vector<const component_ops*> ops);
+
+    /** Calls func(eid, coms...) for every entity having all of the components */
+    void each(sol::protected_function func);
+
+private:
+    database* db;
+    std::vector<const component_ops*> ops;
+    std::vector<database::ent_id> matches; /** Kept between runs to avoid reallocating */
 };
 
 namespace scripting {
@@ -1,15 +1,37 @@
 #include "ez3d.hpp"
 
+#include "gl_state.hpp"
+
 namespace ember::ez3d {
 
+auto get_bounds(const engine& eng, const model& model, const sushi::transform& transform) -> aabb {
+    auto bounds = eng.get_mesh_bounds(model.mesh.get());
+    if (!bounds) {
+        return {transform.pos - glm::vec3(2), transform.pos + glm::vec3(2)};
+    }
+
+    return ember::transform(bounds->box, to_mat4(transform));
+}
+
 void renderer::begin(engine* eng, const camera::perspective& cam) {
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LEQUAL);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glEnable(GL_BLEND);
+    gl_state::set_enabled(GL_DEPTH_TEST, true);
+    gl_state::depth_func(GL_LEQUAL);
+    gl_state::blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    gl_state::set_enabled(GL_BLEND, true);
     //glEnable(GL_SAMPLE_COVERAGE);
     //glEnable(GL_SAMPLE_ALPHA_TO_COVERAGE);
 
+    this->eng = eng;
+    workers = &eng->workers;
+    poses.clear();
+
+    instances.begin(eng->instanced_shader, get_proj(cam), get_view(cam));
+    eng->instanced_shader.set_cam_forward(get_forward(cam));
+    eng->instanced_shader.set_hue(0);
+    eng->instanced_shader.set_saturation(1);
+
+    frustum = frustum_planes(get_proj(cam) * get_view(cam));
+
     eng->basic_shader.bind();
     eng->basic_shader.set_cam_forward(get_forward(cam));
     eng->basic_shader.set_tint({1, 1, 1, 1});
@@ -20,13 +42,28 @@ void renderer::begin(engine* eng, const camera::perspective& cam) {
 }
 
 void renderer::add(const model& model, const sushi::transform& transform) {
+    // Culled before requesting a pose, so hidden models cost nothing
+    if (!frustum.intersects(get_bounds(*eng, model, transform))) {
+        return;
+    }
+
+    submit(model, transform);
+}
+
+void renderer::submit(const model& model, const sushi::transform& transform) {
+    // Static opaque models sharing a mesh and texture are drawn with one instanced draw call
+    if (model.instanced && model.texture && !model.skeleton && model.layer == render_queue::bucket::OPAQUE) {
+        instances.add(model.instanced, model.texture, to_mat4(transform));
+        return;
+    }
+
     if (model.mesh && model.texture) {
-        // Pose
+        // Pose, shared with other models playing the same clip and evaluated in finish()
 
-        std::optional<sushi::pose> pose;
+        const sushi::pose* pose = nullptr;
 
         if (model.skeleton) {
-            pose = sushi::get_pose(*model.skeleton, model.anim_index, model.anim_time, true);
+            pose = poses.request(model.skeleton, model.anim_index, model.anim_time);
         }
 
         // Render
@@ -36,12 +73,17 @@ void renderer::add(const model& model, const sushi::transform& transform) {
         item.mesh = model.mesh;
         item.texture = model.texture;
         item.pose = pose;
+        item.layer = model.layer;
 
-        renderq.add(item);
+        renderq.add(std::move(item));
     }
 }
 
 void renderer::finish() {
+    poses.evaluate(workers);
+
+    // Instances first, so they occlude queued items in the queue's depth pre-pass
+    instances.finish();
     renderq.render_items();
 }
 
@@ -1,13 +1,19 @@
 #pragma once
 
+#include "bounds.hpp"
+#include "bvh.hpp"
 #include "camera.hpp"
 #include "engine.hpp"
+#include "entities.hpp"
+#include "instancing.hpp"
+#include "pose_cache.hpp"
 #include "render_queue.hpp"
 
 #include <sushi/sushi.hpp>
 
 #include <memory>
 #include <optional>
+#include <vector>
 
 namespace ember::ez3d {
 
@@ -18,18 +24,79 @@ struct model {
     std::shared_ptr<sushi::skeleton> skeleton;
     std::optional<int> anim_index;
     float anim_time;
+    render_queue::bucket layer = render_queue::bucket::OPAQUE;
+    std::shared_ptr<instanced_mesh> instanced; /** Same geometry as mesh, drawn instanced when the model is static */
 };
 
+/**
+ * World space box of a model, from the bounds mesh_cache recorded for its mesh.
+ * Skinned models use their bind pose bounds. Meshes not loaded by mesh_cache get a 4 unit cube around the origin.
+ */
+auto get_bounds(const engine& eng, const model& model, const sushi::transform& transform) -> aabb;
+
+/**
+ * Updates a bvh of the entities having a model and a Transform from this frame's change sets.
+ * Call before database::clear_changes(), moved entities must be flagged with mark_modified<Transform>().
+ */
+template <typename Transform>
+void sync_bvh(bvh& tree, engine& eng, database& db) {
+    auto refresh = [&](database::ent_id eid) {
+        if (!db.exists(eid) || !db.has_component<model>(eid) || !db.has_component<Transform>(eid)) {
+            tree.remove(eid);
+        } else {
+            tree.update(eid, get_bounds(eng, db.get_component<model>(eid), db.get_component<Transform>(eid)));
+        }
+    };
+
+    for (const auto* changes : {&db.get_removed<model>(), &db.get_added<model>(), &db.get_modified<model>(),
+             &db.get_removed<Transform>(), &db.get_added<Transform>(), &db.get_modified<Transform>()}) {
+        for (auto eid : *changes) {
+            refresh(eid);
+        }
+    }
+}
+
 class renderer {
 public:
     void begin(engine* eng, const camera::perspective& cam);
 
+    /** Adds a model if its bounds intersect the view frustum */
     void add(const model& model, const sushi::transform& transform);
 
+    /** Adds the entities of a tree kept by sync_bvh() that are in view, testing only the tree nodes */
+    template <typename Transform>
+    void add_visible(const bvh& tree, database& db) {
+        visible.clear();
+        tree.query_frustum(frustum, visible);
+
+        for (auto eid : visible) {
+            submit(db.get_component<model>(eid), db.get_component<Transform>(eid));
+        }
+    }
+
+    /** Frustum of the current camera */
+    auto get_frustum() const -> const frustum_planes& { return frustum; }
+
     void finish();
 
+    /** Draw call counts of the last finish() */
+    auto get_stats() const -> const render_queue::stats& { return renderq.get_stats(); }
+
+    auto get_instance_stats() const -> const instance_renderer::stats& { return instances.get_stats(); }
+
+    auto get_pose_stats() const -> const pose_cache::stats& { return poses.get_stats(); }
+
 private:
+    /** Queues a model that passed culling */
+    void submit(const model& model, const sushi::transform& transform);
+
+    engine* eng = nullptr;
     render_queue renderq;
+    instance_renderer instances;
+    pose_cache poses;
+    thread_pool* workers = nullptr;
+    frustum_planes frustum;
+    std::vector<database::ent_id> visible; /** Kept between add_visible() calls to avoid reallocating */
 };
 
 } // namespace ember::ez3d
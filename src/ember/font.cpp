@@ -1,5 +1,10 @@
 #include "font.hpp"
 
+#include "font_format.hpp"
+
+#include <lodepng.h>
+
+#include <cstring>
 #include <iostream>
 #include <fstream>
 #include <stdexcept>
@@ -13,11 +18,16 @@ msdfgen::FreetypeHandle* font_init() {
     return ft;
 }
 
+std::uint64_t kerning_key(int left, int right) {
+    return (std::uint64_t(std::uint32_t(left)) << 32) | std::uint32_t(right);
+}
+
 } //static
 
 namespace ember {
 
-msdf_font::msdf_font(const std::string& fontname) {
+msdf_font::msdf_font(const std::string& fontname, glyph_atlas& atlas, glyph_generator* generator)
+    : ttf_filename(fontname), atlas(&atlas), generator(generator) {
     auto ft = font_init();
 
     if (!ft) {
@@ -31,109 +41,245 @@ msdf_font::msdf_font(const std::string& fontname) {
     }
 }
 
+auto msdf_font::load_cooked(
+    const std::string& filename,
+    const std::string& ttf_filename,
+    glyph_atlas& atlas,
+    glyph_generator* generator) -> std::optional<msdf_font> {
+    namespace ff = font_format;
+
+    auto file = std::ifstream(filename, std::ios::binary | std::ios::ate);
+
+    if (!file) {
+        return std::nullopt;
+    }
+
+    // Read in one go, the tables are small and parsed in place
+    auto data = std::vector<char>(std::size_t(file.tellg()));
+    file.seekg(0);
+    file.read(data.data(), data.size());
+
+    auto header = ff::header{};
+
+    if (!file || data.size() < sizeof(header)) {
+        std::cerr << "ERROR: Failed to read cooked font " << filename << "." << std::endl;
+        return std::nullopt;
+    }
+
+    std::memcpy(&header, data.data(), sizeof(header));
+
+    auto glyphs_offset = sizeof(header);
+    auto kerning_offset = glyphs_offset + std::size_t(header.glyph_count) * sizeof(ff::glyph);
+    auto expected_size = kerning_offset + std::size_t(header.kerning_count) * sizeof(ff::kerning);
+
+    if (std::memcmp(header.magic, ff::magic, sizeof(header.magic)) != 0 || header.version != ff::version) {
+        std::cerr << "ERROR: " << filename << " is not a version " << ff::version << " cooked font." << std::endl;
+        return std::nullopt;
+    }
+
+    if (data.size() != expected_size) {
+        std::cerr << "ERROR: Cooked font " << filename << " is truncated." << std::endl;
+        return std::nullopt;
+    }
+
+    auto image_filename = filename.substr(0, filename.find_last_of('.')) + ".png";
+    auto pixels = std::vector<unsigned char>{};
+    auto width = 0u;
+    auto height = 0u;
+
+    if (auto error = lodepng::decode(pixels, width, height, image_filename)) {
+        std::cerr << "ERROR: Failed to load " << image_filename << ": " << lodepng_error_text(error) << std::endl;
+        return std::nullopt;
+    }
+
+    if (width != header.atlas_width || height != header.atlas_height) {
+        std::cerr << "ERROR: " << image_filename << " does not match " << filename << "." << std::endl;
+        return std::nullopt;
+    }
+
+    auto f = msdf_font{};
+    f.ttf_filename = ttf_filename;
+    f.cooked = true;
+    f.px_range = header.px_range;
+    f.atlas = &atlas;
+    f.generator = generator;
+
+    auto page = atlas.add_page(int(width), int(height), pixels.data());
+
+    for (std::uint32_t i = 0; i < header.glyph_count; ++i) {
+        auto cg = ff::glyph{};
+        std::memcpy(&cg, data.data() + glyphs_offset + i * sizeof(ff::glyph), sizeof(cg));
+
+        auto g = glyph{};
+        g.region = atlas.get_region(page, {cg.x, cg.y}, {cg.width, cg.height});
+        g.bounds_min = {cg.left, cg.bottom};
+        g.bounds_max = {cg.right, cg.top};
+        g.advance = cg.advance;
+
+        f.glyphs.emplace(int(cg.codepoint), g);
+    }
+
+    f.kerning.reserve(header.kerning_count);
+
+    for (std::uint32_t i = 0; i < header.kerning_count; ++i) {
+        auto ck = ff::kerning{};
+        std::memcpy(&ck, data.data() + kerning_offset + i * sizeof(ff::kerning), sizeof(ck));
+        f.kerning.emplace(kerning_key(int(ck.left), int(ck.right)), ck.amount);
+    }
+
+    return f;
+}
+
 const msdf_font::glyph& msdf_font::get_glyph(int unicode) const {
+    static const auto empty = glyph{};
+
     auto iter = glyphs.find(unicode);
 
-    if (iter == end(glyphs)) {
-        msdfgen::Shape shape;
-        double advance;
+    if (iter != end(glyphs)) {
+        auto& g = iter->second;
+        auto failed = false;
+
+        if (auto p = pending.find(unicode); p != end(pending)) {
+            if (p->second->failed.load(std::memory_order_acquire)) {
+                // Already logged by the generator, loaded and queued again below
+                failed = true;
+            } else if (!upload_pending(g, *p->second)) {
+                g.region = get_fallback_region(unicode);
+                return g;
+            }
+            pending.erase(p);
+        }
 
-        if (!msdfgen::loadGlyph(shape, font.get(), unicode, &advance)) {
-            return glyphs.at(0);
+        if (!failed && (!g.region || atlas->valid(*g.region))) {
+            if (g.region) {
+                atlas->touch(*g.region);
+            }
+            return g;
         }
+    }
 
-        shape.normalize();
-        msdfgen::edgeColoringSimple(shape, 3.0);
+    // New glyphs, glyphs whose atlas page was evicted, and failed background glyphs are loaded again
+    auto g = glyph{};
 
-        double left=0, bottom=0, right=0, top=0;
-        shape.bounds(left, bottom, right, top);
+    if (!load_glyph(unicode, g)) {
+        return unicode != 0 ? get_glyph(0) : empty;
+    }
 
-        left -= 1;
-        bottom -= 1;
-        right += 1;
-        top += 1;
+    auto& stored = glyphs.insert_or_assign(unicode, std::move(g)).first->second;
 
-        auto width = int(right - left + 1);
-        auto height = int(top - bottom + 1);
+    if (pending.count(unicode)) {
+        stored.region = get_fallback_region(unicode);
+    }
 
-        msdfgen::Bitmap<msdfgen::FloatRGB> msdf(width, height);
-        msdfgen::generateMSDF(msdf, shape, 4.0, 1.0, msdfgen::Vector2(-left, -bottom));
+    return stored;
+}
 
-        std::vector<unsigned char> pixels;
-        pixels.reserve(4*msdf.width()*msdf.height());
-        for (int y = 0; y < msdf.height(); ++y) {
-            for (int x = 0; x < msdf.width(); ++x) {
-                pixels.push_back(msdfgen::clamp(msdf(x, y).r * 256.f, 255.f));
-                pixels.push_back(msdfgen::clamp(msdf(x, y).g * 256.f, 255.f));
-                pixels.push_back(msdfgen::clamp(msdf(x, y).b * 256.f, 255.f));
-                pixels.push_back(255);
-            }
+float msdf_font::get_kerning(int left, int right) const {
+    auto key = kerning_key(left, right);
+
+    if (auto iter = kerning.find(key); iter != end(kerning)) {
+        return iter->second;
+    }
+
+    if (cooked) {
+        return 0;
+    }
+
+    auto amount = 0.0;
+    auto em = 1.0;
+
+    if (auto handle = get_font()) {
+        msdfgen::getKerning(amount, handle, left, right);
+        msdfgen::getFontScale(em, handle);
+    }
+
+    return kerning.emplace(key, float(amount / em)).first->second;
+}
+
+auto msdf_font::get_font() const -> msdfgen::FontHandle* {
+    // Cooked fonts only open the TTF once a character outside the cooked ranges is needed
+    if (!font && !font_failed) {
+        if (auto ft = font_init()) {
+            font = decltype(font)(msdfgen::loadFont(ft, ttf_filename.c_str()));
         }
 
-        double em;
-        msdfgen::getFontScale(em, font.get());
+        if (!font) {
+            std::cerr << "Warning: Failed to load font " << ttf_filename << "." << std::endl;
+            font_failed = true;
+        }
+    }
 
-        left /= em;
-        right /= em;
-        bottom /= em;
-        top /= em;
-        advance /= em;
+    return font.get();
+}
 
-        auto g = glyph{};
+bool msdf_font::load_glyph(int unicode, glyph& g) const {
+    auto handle = get_font();
 
-        auto mb = sushi::mesh_group_builder{};
-        mb.enable(sushi::attrib_location::POSITION);
-        mb.enable(sushi::attrib_location::TEXCOORD);
-        mb.enable(sushi::attrib_location::NORMAL);
+    if (!handle) {
+        return false;
+    }
 
-        mb.mesh("");
+    msdfgen::Shape shape;
+    double advance;
 
-        auto bottomleft = mb.vertex()
-            .position({left, bottom, 0})
-            .texcoord({0, 0})
-            .normal({0, 0, 1})
-            .get();
+    if (!msdfgen::loadGlyph(shape, handle, unicode, &advance)) {
+        return false;
+    }
 
-        auto topleft = mb.vertex()
-            .position({left, top, 0})
-            .texcoord({0, 1})
-            .normal({0, 0, 1})
-            .get();
+    double left=0, bottom=0, right=0, top=0;
+    shape.bounds(left, bottom, right, top);
 
-        auto bottomright = mb.vertex()
-            .position({right, bottom, 0})
-            .texcoord({1, 0})
-            .normal({0, 0, 1})
-            .get();
+    left -= 1;
+    bottom -= 1;
+    right += 1;
+    top += 1;
 
-        auto topright = mb.vertex()
-            .position({right, top, 0})
-            .texcoord({1, 1})
-            .normal({0, 0, 1})
-            .get();
-        
-        mb.tri(bottomleft, topleft, topright);
-        mb.tri(topright, bottomright, bottomleft);
+    auto width = int(right - left + 1);
+    auto height = int(top - bottom + 1);
 
-        g.mesh = mb.get();
+    // Metrics are known right away, so layout does not change when the bitmap arrives
+    if (generator) {
+        pending.insert_or_assign(unicode, generator->submit(shape, width, height, left, bottom, px_range));
+        g.region = std::nullopt;
+    } else {
+        auto pixels = glyph_generator::rasterize(shape, width, height, left, bottom, px_range);
+        g.region = atlas->insert(width, height, pixels.data());
+    }
 
-        g.texture.handle = sushi::make_unique_texture();
-        g.texture.width = width;
-        g.texture.height = height;
+    double em;
+    msdfgen::getFontScale(em, handle);
 
-        glBindTexture(GL_TEXTURE_2D, g.texture.handle.get());
-        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, msdf.width(), msdf.height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+    left /= em;
+    right /= em;
+    bottom /= em;
+    top /= em;
+    advance /= em;
 
-        g.advance = advance;
+    g.bounds_min = glm::vec2(left, bottom);
+    g.bounds_max = glm::vec2(right, top);
+    g.advance = advance;
 
-        iter = glyphs.insert({unicode, std::move(g)}).first;
+    return true;
+}
+
+bool msdf_font::upload_pending(glyph& g, glyph_generator::job& j) const {
+    if (!j.done.load(std::memory_order_acquire) || !generator->try_acquire_upload()) {
+        return false;
+    }
+
+    g.region = atlas->insert(j.width, j.height, j.pixels.data());
+
+    return true;
+}
+
+auto msdf_font::get_fallback_region(int unicode) const -> std::optional<glyph_atlas::region> {
+    if (unicode == 0) {
+        return std::nullopt;
     }
 
-    return iter->second;
+    const auto& missing = get_glyph(0);
+
+    return pending.count(0) ? std::nullopt : missing.region;
 }
 
 } // namespace ember
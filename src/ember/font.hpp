@@ -1,13 +1,19 @@
 #pragma once
 
+#include "glyph_atlas.hpp"
+#include "glyph_generator.hpp"
+
 #include <sushi/sushi.hpp>
+#include <glm/glm.hpp>
 
 #include <msdfgen.h>
 #include <msdfgen-ext.h>
 
+#include <cstdint>
 #include <string>
 #include <unordered_map>
 #include <memory>
+#include <optional>
 
 namespace ember {
 
@@ -17,22 +23,67 @@ struct FontDeleter {
     }
 };
 
+/**
+ * Multi-channel signed distance field font, glyphs are drawn from the shared glyph atlas.
+ * Cooked fonts (see font_format.hpp) come with their glyphs prerendered, the TTF is only opened for characters
+ * outside the cooked ranges. Other fonts rasterize each glyph on first use, in the background when given a
+ * glyph_generator, drawing the missing glyph in its place until it is uploaded.
+ */
 class msdf_font {
 public:
     struct glyph {
-        sushi::mesh_group mesh;
-        sushi::texture_2d texture;
+        std::optional<glyph_atlas::region> region; /** Where the MSDF is packed, nullopt if it could not be */
+        glm::vec2 bounds_min; /** Bottom left corner of the texture quad relative to the pen, in ems */
+        glm::vec2 bounds_max; /** Top right corner */
         float advance;
     };
 
     msdf_font() = default;
-    msdf_font(const std::string& filename);
+    msdf_font(const std::string& filename, glyph_atlas& atlas, glyph_generator* generator = nullptr);
+
+    /**
+     * Loads a cooked font and uploads its atlas as a prebuilt page, ttf_filename is opened lazily for other characters.
+     * Returns nullopt if the file does not exist, so uncooked builds fall back to the TTF.
+     */
+    static auto load_cooked(
+        const std::string& filename,
+        const std::string& ttf_filename,
+        glyph_atlas& atlas,
+        glyph_generator* generator = nullptr) -> std::optional<msdf_font>;
 
+    /**
+     * Rasterizes the glyph into the atlas if it is not there, the region stays valid for the current frame.
+     * While a glyph is generated in the background, its region is the missing glyph's.
+     */
     const glyph& get_glyph(int unicode) const;
 
+    /** Pen adjustment between two characters, in ems */
+    float get_kerning(int left, int right) const;
+
+    /** Distance field range in atlas pixels */
+    auto get_px_range() const -> float { return px_range; }
+
 private:
-    std::unique_ptr<msdfgen::FontHandle, FontDeleter> font;
+    /** Loads metrics and rasterizes the glyph, or queues it when there is a generator */
+    bool load_glyph(int unicode, glyph& g) const;
+
+    /** Uploads a finished background glyph if the frame's budget allows */
+    bool upload_pending(glyph& g, glyph_generator::job& j) const;
+
+    auto get_fallback_region(int unicode) const -> std::optional<glyph_atlas::region>;
+
+    auto get_font() const -> msdfgen::FontHandle*;
+
+    std::string ttf_filename;
+    mutable std::unique_ptr<msdfgen::FontHandle, FontDeleter> font;
+    mutable bool font_failed = false;
+    bool cooked = false; /** Kerning of cooked fonts comes only from the cooked table */
+    float px_range = 4.f;
+    glyph_atlas* atlas = nullptr;
+    glyph_generator* generator = nullptr;
     mutable std::unordered_map<int, glyph> glyphs;
+    mutable std::unordered_map<int, std::shared_ptr<glyph_generator::job>> pending;
+    mutable std::unordered_map<std::uint64_t, float> kerning;
 };
 
 } // namespace ember
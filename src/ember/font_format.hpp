@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Layout of cooked fonts (.font), written by tools/font_cooker and read by msdf_font.
+ * A header, then glyph_count glyphs sorted by codepoint, then kerning_count kerning pairs, all little endian.
+ * The MSDF atlas is a PNG with the same base name, its first row is the bottom of the glyphs like texture uploads.
+ * Metrics are in ems, atlas rectangles in pixels.
+ */
+namespace ember::font_format {
+
+constexpr char magic[4] = {'E', 'M', 'F', 'N'};
+constexpr std::uint32_t version = 1;
+
+struct header {
+    char magic[4];
+    std::uint32_t version;
+    float px_range; /** Distance field range in atlas pixels */
+    std::uint32_t atlas_width;
+    std::uint32_t atlas_height;
+    std::uint32_t glyph_count;
+    std::uint32_t kerning_count;
+};
+
+struct glyph {
+    std::uint32_t codepoint;
+    float advance;
+    float left;
+    float bottom;
+    float right;
+    float top;
+    std::uint16_t x;
+    std::uint16_t y;
+    std::uint16_t width;
+    std::uint16_t height;
+};
+
+struct kerning {
+    std::uint32_t left;
+    std::uint32_t right;
+    float amount;
+};
+
+static_assert(sizeof(header) == 28);
+static_assert(sizeof(glyph) == 32);
+static_assert(sizeof(kerning) == 12);
+
+} // namespace ember::font_format
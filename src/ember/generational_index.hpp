@@ -0,0 +1,143 @@
+#pragma once
+
+#include "net_id.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace ember {
+
+/** Open-addressing map from net_id to a value, with a generation stored alongside each entry */
+template <typename Value>
+class generational_index {
+public:
+    using key_type = net_id::id_type;
+    using generation_type = std::uint32_t;
+
+    struct entry {
+        key_type key = 0;
+        Value value = {};
+        generation_type generation = 0; /** Generation the value was inserted with, 0 means empty */
+    };
+
+    /** Finds the entry for a key, or nullptr if there is none */
+    auto find(key_type key) const -> const entry* {
+        if (slots.empty()) {
+            return nullptr;
+        }
+
+        for (auto i = home(key);; i = next(i)) {
+            const auto& slot = slots[i];
+            if (slot.generation == 0) {
+                return nullptr;
+            }
+            if (slot.key == key) {
+                return &slot;
+            }
+        }
+    }
+
+    /** Inserts or overwrites the entry for a key */
+    void insert_or_assign(key_type key, Value value, generation_type generation) {
+        if ((count + 1) * 4 > slots.size() * 3) {
+            rehash(slots.empty() ? 16 : slots.size() * 2);
+        }
+
+        auto i = home(key);
+        while (slots[i].generation != 0 && slots[i].key != key) {
+            i = next(i);
+        }
+
+        if (slots[i].generation == 0) {
+            ++count;
+        }
+
+        slots[i] = {key, std::move(value), generation};
+    }
+
+    /** Removes the entry for a key, returns false if there was none */
+    bool erase(key_type key) {
+        if (slots.empty()) {
+            return false;
+        }
+
+        auto i = home(key);
+        while (slots[i].key != key) {
+            if (slots[i].generation == 0) {
+                return false;
+            }
+            i = next(i);
+        }
+        if (slots[i].generation == 0) {
+            return false;
+        }
+
+        // Backward-shift deletion, keeps probe sequences short without tombstones
+        for (auto j = next(i); slots[j].generation != 0; j = next(j)) {
+            auto h = home(slots[j].key);
+            auto dist_i = (i - h) & mask();
+            auto dist_j = (j - h) & mask();
+            if (dist_i < dist_j) {
+                slots[i] = std::move(slots[j]);
+                i = j;
+            }
+        }
+
+        slots[i] = {};
+        --count;
+
+        return true;
+    }
+
+    /** Ensures n entries can be stored without rehashing */
+    void reserve(std::size_t n) {
+        auto cap = slots.empty() ? std::size_t{16} : slots.size();
+        while (n * 4 > cap * 3) {
+            cap *= 2;
+        }
+        if (cap != slots.size()) {
+            rehash(cap);
+        }
+    }
+
+    auto size() const -> std::size_t {
+        return count;
+    }
+
+    void clear() {
+        slots.clear();
+        count = 0;
+    }
+
+private:
+    auto mask() const -> std::size_t {
+        return slots.size() - 1;
+    }
+
+    auto home(key_type key) const -> std::size_t {
+        // Fibonacci hashing, net_ids are mostly sequential so this spreads them across the table
+        auto h = std::uint64_t(key) * 0x9E3779B97F4A7C15ull;
+        return std::size_t(h >> 32) & mask();
+    }
+
+    auto next(std::size_t i) const -> std::size_t {
+        return (i + 1) & mask();
+    }
+
+    void rehash(std::size_t new_size) {
+        auto old_slots = std::exchange(slots, std::vector<entry>(new_size));
+        count = 0;
+        for (auto& slot : old_slots) {
+            if (slot.generation != 0) {
+                insert_or_assign(slot.key, std::move(slot.value), slot.generation);
+            }
+        }
+    }
+
+    std::vector<entry> slots;
+    std::size_t count = 0;
+};
+
+} // namespace ember
@@ -0,0 +1,151 @@
+#include "gl_state.hpp"
+
+#include <array>
+#include <optional>
+
+namespace ember::gl_state {
+
+namespace {
+
+struct shadow {
+    std::optional<GLuint> program;
+    std::array<std::optional<GLuint>, 8> textures;
+    std::optional<bool> blend;
+    std::optional<bool> depth_test;
+    std::optional<bool> scissor_test;
+    std::optional<GLenum> depth_func;
+    std::optional<bool> depth_mask;
+    std::optional<bool> color_mask;
+    std::optional<std::pair<GLenum, GLenum>> blend_func;
+    std::optional<std::array<GLint, 4>> scissor;
+};
+
+shadow current;
+stats counters;
+std::uint64_t current_generation = 1;
+
+/** Updates a shadowed value, returns whether the GL call is needed */
+template <typename T>
+bool change(counter& c, std::optional<T>& shadowed, const T& value) {
+    if (shadowed && *shadowed == value) {
+        ++c.saved;
+        return false;
+    }
+
+    shadowed = value;
+    ++c.issued;
+    return true;
+}
+
+} // namespace
+
+void use_program(GLuint handle) {
+    if (change(counters.programs, current.program, handle)) {
+        get_render_backend().use_program(handle);
+    }
+}
+
+void bind_texture(GLuint unit, const sushi::texture_2d& texture) {
+    auto handle = GLuint(texture.handle.get());
+
+    if (unit >= current.textures.size()) {
+        ++counters.textures.issued;
+        get_render_backend().bind_texture(unit, handle);
+        return;
+    }
+
+    if (change(counters.textures, current.textures[unit], handle)) {
+        get_render_backend().bind_texture(unit, handle);
+    }
+}
+
+void set_enabled(GLenum capability, bool enabled) {
+    auto apply = [&] { get_render_backend().set_enabled(capability, enabled); };
+
+    switch (capability) {
+        case GL_BLEND:
+            if (change(counters.capabilities, current.blend, enabled)) {
+                apply();
+            }
+            break;
+        case GL_DEPTH_TEST:
+            if (change(counters.capabilities, current.depth_test, enabled)) {
+                apply();
+            }
+            break;
+        case GL_SCISSOR_TEST:
+            if (change(counters.capabilities, current.scissor_test, enabled)) {
+                apply();
+            }
+            break;
+        default:
+            ++counters.capabilities.issued;
+            apply();
+            break;
+    }
+}
+
+void depth_func(GLenum func) {
+    if (change(counters.capabilities, current.depth_func, func)) {
+        get_render_backend().depth_func(func);
+    }
+}
+
+void depth_mask(bool write) {
+    if (change(counters.capabilities, current.depth_mask, write)) {
+        get_render_backend().depth_mask(write);
+    }
+}
+
+void color_mask(bool write) {
+    if (change(counters.capabilities, current.color_mask, write)) {
+        get_render_backend().color_mask(write);
+    }
+}
+
+void blend_func(GLenum src, GLenum dst) {
+    if (change(counters.capabilities, current.blend_func, std::pair{src, dst})) {
+        get_render_backend().blend_func(src, dst);
+    }
+}
+
+void scissor(GLint x, GLint y, GLsizei width, GLsizei height) {
+    if (change(counters.capabilities, current.scissor, std::array<GLint, 4>{x, y, width, height})) {
+        get_render_backend().scissor(x, y, width, height);
+    }
+}
+
+void invalidate_program() {
+    current.program.reset();
+}
+
+void invalidate_textures() {
+    current.textures = {};
+}
+
+void invalidate() {
+    current = {};
+    ++current_generation;
+}
+
+auto generation() -> std::uint64_t {
+    return current_generation;
+}
+
+auto get_stats() -> const stats& {
+    return counters;
+}
+
+void reset_stats() {
+    counters = {};
+}
+
+void count_uniform(bool saved) {
+    if (saved) {
+        ++counters.uniforms.saved;
+    } else {
+        ++counters.uniforms.issued;
+    }
+}
+
+} // namespace ember::gl_state
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "render_backend.hpp"
+
+#include <sushi/sushi.hpp>
+
+#include <cstdint>
+
+namespace ember::gl_state {
+
+/**
+ * Shadow of the GL state the renderers touch: current program, bound textures, blend, depth and scissor state.
+ * Calls that would not change anything are skipped and counted, the rest go to the current render backend.
+ * Code that changes this state behind the shadow's back, like texture uploads, must call the matching invalidate
+ * function.
+ */
+
+struct counter {
+    std::uint64_t issued = 0;
+    std::uint64_t saved = 0;
+};
+
+struct stats {
+    counter programs;
+    counter uniforms;
+    counter textures;
+    counter capabilities; /** Enables, depth, blend, scissor and color mask state */
+};
+
+/** Makes a program current, handle is the GL program name */
+void use_program(GLuint handle);
+
+void bind_texture(GLuint unit, const sushi::texture_2d& texture);
+
+void set_enabled(GLenum capability, bool enabled);
+
+void depth_func(GLenum func);
+
+void depth_mask(bool write);
+
+void color_mask(bool write);
+
+void blend_func(GLenum src, GLenum dst);
+
+void scissor(GLint x, GLint y, GLsizei width, GLsizei height);
+
+/** Forgets the current program, call after binding a program directly */
+void invalidate_program();
+
+/** Forgets texture bindings, call after binding textures directly, for example to upload them */
+void invalidate_textures();
+
+/** Forgets everything, including uploaded uniform values */
+void invalidate();
+
+/** Incremented by invalidate(), uniform values cached under an older generation are uploaded again */
+auto generation() -> std::uint64_t;
+
+auto get_stats() -> const stats&;
+
+void reset_stats();
+
+/** Records a uniform upload, used by uniform */
+void count_uniform(bool saved);
+
+/** Uniform location with the last value uploaded to it, uniform values are per program so this is exact */
+template <typename T>
+class uniform {
+public:
+    GLint location = -1;
+
+    /** Program must be current */
+    void set(const T& value) {
+        if (valid_generation == generation() && value == last) {
+            count_uniform(true);
+            return;
+        }
+
+        get_render_backend().uniform(location, value);
+        last = value;
+        valid_generation = generation();
+        count_uniform(false);
+    }
+
+private:
+    T last = {};
+    std::uint64_t valid_generation = 0; /** Generations start at 1, so new uniforms are always uploaded */
+};
+
+} // namespace ember::gl_state
@@ -0,0 +1,185 @@
+#include "glyph_atlas.hpp"
+
+#include "gl_state.hpp"
+
+#include <iostream>
+
+namespace ember {
+
+namespace {
+
+// Keeps linear filtering from reading into neighbouring glyphs
+constexpr int padding = 1;
+
+} // namespace
+
+glyph_atlas::glyph_atlas(int page_size, int max_pages) : page_size(page_size), max_pages(max_pages) {}
+
+void glyph_atlas::begin_frame() {
+    ++frame;
+}
+
+auto glyph_atlas::insert(int width, int height, const unsigned char* pixels) -> std::optional<region> {
+    if (width + padding > page_size || height + padding > page_size) {
+        std::cerr << "ERROR: Glyph of " << width << "x" << height << " does not fit in a " << page_size
+                  << " glyph atlas page." << std::endl;
+        return std::nullopt;
+    }
+
+    auto place = [&](std::uint32_t index, glm::ivec2 pos) {
+        auto& p = pages[index];
+        ++p.glyphs;
+        p.last_used = frame;
+
+        glBindTexture(GL_TEXTURE_2D, p.texture.handle.get());
+        glTexSubImage2D(GL_TEXTURE_2D, 0, pos.x, pos.y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+        gl_state::invalidate_textures();
+
+        return get_region(index, pos, {width, height});
+    };
+
+    auto dynamic_pages = 0;
+
+    for (std::uint32_t i = 0; i < pages.size(); ++i) {
+        if (pages[i].prebuilt) {
+            continue;
+        }
+
+        ++dynamic_pages;
+
+        if (auto pos = allocate(pages[i], width, height)) {
+            return place(i, *pos);
+        }
+    }
+
+    auto target = std::uint32_t(pages.size());
+
+    if (dynamic_pages < max_pages) {
+        create_page(page_size, page_size, nullptr);
+    } else if (auto evicted = find_evictable()) {
+        target = *evicted;
+        auto& p = pages[target];
+        p.shelves.clear();
+        p.glyphs = 0;
+        ++p.generation;
+        ++evictions;
+    } else {
+        // Every page is in use this frame, going over the limit beats drawing stale glyphs
+        std::cerr << "Warning: Glyph atlas exceeded " << max_pages << " pages." << std::endl;
+        create_page(page_size, page_size, nullptr);
+    }
+
+    return place(target, *allocate(pages[target], width, height));
+}
+
+auto glyph_atlas::add_page(int width, int height, const unsigned char* pixels) -> std::uint32_t {
+    create_page(width, height, pixels);
+
+    auto& p = pages.back();
+    p.prebuilt = true;
+
+    return std::uint32_t(pages.size() - 1);
+}
+
+auto glyph_atlas::get_region(std::uint32_t page, glm::ivec2 position, glm::ivec2 size) const -> region {
+    const auto& p = pages[page];
+    auto extent = glm::vec2{p.texture.width, p.texture.height};
+
+    return region{
+        page,
+        p.generation,
+        glm::vec2(position) / extent,
+        glm::vec2(position + size) / extent,
+    };
+}
+
+bool glyph_atlas::valid(const region& r) const {
+    return r.page < pages.size() && pages[r.page].generation == r.generation;
+}
+
+void glyph_atlas::touch(const region& r) {
+    pages[r.page].last_used = frame;
+}
+
+auto glyph_atlas::get_stats() const -> stats {
+    auto s = stats{int(pages.size()), 0, evictions};
+
+    for (const auto& p : pages) {
+        s.glyphs += p.glyphs;
+    }
+
+    return s;
+}
+
+auto glyph_atlas::allocate(page& p, int width, int height) -> std::optional<glm::ivec2> {
+    auto padded_width = width + padding;
+    auto padded_height = height + padding;
+
+    // Best fit: the shortest shelf that is tall enough, tolerating some wasted height before opening a new one
+    auto best = static_cast<shelf*>(nullptr);
+
+    for (auto& s : p.shelves) {
+        if (s.height >= padded_height && s.height <= padded_height * 3 / 2 + 1 && s.x + padded_width <= page_size) {
+            if (!best || s.height < best->height) {
+                best = &s;
+            }
+        }
+    }
+
+    if (!best) {
+        auto top = p.shelves.empty() ? 0 : p.shelves.back().y + p.shelves.back().height;
+
+        if (top + padded_height > page_size) {
+            // The page is full, fall back to any shelf the glyph fits on
+            for (auto& s : p.shelves) {
+                if (s.height >= padded_height && s.x + padded_width <= page_size) {
+                    best = &s;
+                    break;
+                }
+            }
+
+            if (!best) {
+                return std::nullopt;
+            }
+        } else {
+            best = &p.shelves.emplace_back(shelf{top, padded_height, 0});
+        }
+    }
+
+    auto pos = glm::ivec2{best->x, best->y};
+    best->x += padded_width;
+
+    return pos;
+}
+
+void glyph_atlas::create_page(int width, int height, const unsigned char* pixels) {
+    auto& p = pages.emplace_back();
+
+    p.texture.handle = sushi::make_unique_texture();
+    p.texture.width = width;
+    p.texture.height = height;
+
+    glBindTexture(GL_TEXTURE_2D, p.texture.handle.get());
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+
+    gl_state::invalidate_textures();
+}
+
+auto glyph_atlas::find_evictable() const -> std::optional<std::uint32_t> {
+    auto oldest = std::optional<std::uint32_t>{};
+
+    for (std::uint32_t i = 0; i < pages.size(); ++i) {
+        const auto& p = pages[i];
+        if (!p.prebuilt && p.last_used < frame && (!oldest || p.last_used < pages[*oldest].last_used)) {
+            oldest = i;
+        }
+    }
+
+    return oldest;
+}
+
+} // namespace ember
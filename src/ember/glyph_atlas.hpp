@@ -0,0 +1,94 @@
+#pragma once
+
+#include <sushi/sushi.hpp>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <vector>
+
+namespace ember {
+
+/**
+ * Texture pages shared by every font's MSDF glyphs, so text in any font batches into one draw per page.
+ * Glyphs are packed into shelves. Pages are added as they fill up to a limit, after which the least recently
+ * used page is cleared and its glyphs are rasterized again when next needed.
+ * A page used this frame is never cleared, text queued earlier in the frame stays valid until it is drawn.
+ * Prebuilt pages, such as cooked font atlases, are added whole and never packed into or evicted.
+ */
+class glyph_atlas {
+public:
+    struct region {
+        std::uint32_t page;
+        std::uint32_t generation; /** Page generation the glyph was packed in, stale once the page is cleared */
+        glm::vec2 uv1;            /** Bottom left, the first uploaded row is the bottom */
+        glm::vec2 uv2;
+    };
+
+    struct stats {
+        int pages;
+        int glyphs;    /** Glyphs currently packed */
+        int evictions; /** Pages cleared since creation */
+    };
+
+    glyph_atlas() = default;
+    explicit glyph_atlas(int page_size, int max_pages = 4);
+    glyph_atlas(const glyph_atlas&) = delete;
+    glyph_atlas(glyph_atlas&&) = default;
+    glyph_atlas& operator=(const glyph_atlas&) = delete;
+    glyph_atlas& operator=(glyph_atlas&&) = default;
+
+    /** Advances the LRU clock, pages touched before this call become eligible for eviction */
+    void begin_frame();
+
+    /** Packs and uploads an RGBA image, returns nullopt if it is larger than a page */
+    auto insert(int width, int height, const unsigned char* pixels) -> std::optional<region>;
+
+    /** Uploads a prebuilt RGBA page, bottom row first, and returns its index */
+    auto add_page(int width, int height, const unsigned char* pixels) -> std::uint32_t;
+
+    /** Region of a prebuilt page, in pixels */
+    auto get_region(std::uint32_t page, glm::ivec2 position, glm::ivec2 size) const -> region;
+
+    /** Whether a region still holds the image it was packed with */
+    bool valid(const region& r) const;
+
+    /** Marks a region's page as used this frame */
+    void touch(const region& r);
+
+    auto get_page(std::uint32_t page) const -> const sushi::texture_2d& { return pages[page].texture; }
+
+    auto get_stats() const -> stats;
+
+private:
+    struct shelf {
+        int y;
+        int height;
+        int x; /** First free column */
+    };
+
+    struct page {
+        sushi::texture_2d texture;
+        std::vector<shelf> shelves;
+        std::uint32_t generation = 0;
+        std::uint64_t last_used = 0;
+        int glyphs = 0;
+        bool prebuilt = false;
+    };
+
+    auto allocate(page& p, int width, int height) -> std::optional<glm::ivec2>;
+
+    void create_page(int width, int height, const unsigned char* pixels);
+
+    /** Least recently used page not used this frame */
+    auto find_evictable() const -> std::optional<std::uint32_t>;
+
+    int page_size = 512;
+    int max_pages = 4; /** Excluding prebuilt pages */
+    std::deque<page> pages; /** Deque so page textures keep their address while batched draws refer to them */
+    std::uint64_t frame = 1;
+    int evictions = 0;
+};
+
+} // namespace ember
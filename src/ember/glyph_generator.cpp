@@ -0,0 +1,145 @@
+#include "glyph_generator.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <iostream>
+#include <utility>
+
+namespace ember {
+
+glyph_generator::glyph_generator(thread_pool* workers, int uploads_per_frame)
+    : workers(workers), uploads_per_frame(uploads_per_frame), uploads_left(uploads_per_frame) {}
+
+glyph_generator& glyph_generator::operator=(glyph_generator&& other) {
+    // Running tasks refer to the old group
+    wait_all();
+
+    workers = other.workers;
+    group = std::move(other.group);
+    inline_queue = std::move(other.inline_queue);
+    uploads_per_frame = other.uploads_per_frame;
+    uploads_left = other.uploads_left;
+
+    return *this;
+}
+
+glyph_generator::~glyph_generator() {
+    wait_all();
+}
+
+void glyph_generator::begin_frame() {
+    using clock = std::chrono::steady_clock;
+
+    // Without workers glyphs are rasterized on the main thread, at least one per frame and more while time allows
+    constexpr auto inline_budget = std::chrono::microseconds{1000};
+
+    uploads_left = uploads_per_frame;
+
+    auto start = clock::now();
+
+    while (!inline_queue.empty()) {
+        auto task = std::move(inline_queue.front());
+        inline_queue.pop_front();
+        task();
+
+        if (clock::now() - start >= inline_budget) {
+            break;
+        }
+    }
+}
+
+auto glyph_generator::submit(
+    const msdfgen::Shape& shape, int width, int height, double left, double bottom, double px_range)
+    -> std::shared_ptr<job> {
+    auto j = std::make_shared<job>();
+
+    // Errors are reported right away instead of when the pool shuts down, and the font retries the glyph
+    auto task = [j, shape, width, height, left, bottom, px_range, pool = workers] {
+        try {
+            j->pixels = rasterize(shape, width, height, left, bottom, px_range, pool);
+            j->width = width;
+            j->height = height;
+        } catch (const std::exception& e) {
+            std::cerr << "ERROR: Glyph generation failed: " << e.what() << std::endl;
+            j->failed.store(true, std::memory_order_release);
+        }
+        j->done.store(true, std::memory_order_release);
+    };
+
+    if (workers && workers->size() > 0) {
+        workers->submit(*group, std::move(task));
+    } else {
+        inline_queue.push_back(std::move(task));
+    }
+
+    return j;
+}
+
+bool glyph_generator::try_acquire_upload() {
+    if (uploads_left <= 0) {
+        return false;
+    }
+
+    --uploads_left;
+    return true;
+}
+
+auto glyph_generator::rasterize(
+    msdfgen::Shape shape,
+    int width,
+    int height,
+    double left,
+    double bottom,
+    double px_range,
+    thread_pool* workers) -> std::vector<unsigned char> {
+    // Rows per task, small glyphs are generated in one piece
+    constexpr auto rows_per_task = std::size_t{8};
+
+    shape.normalize();
+    msdfgen::edgeColoringSimple(shape, 3.0);
+
+    msdfgen::Bitmap<msdfgen::FloatRGB> msdf(width, height);
+    auto translate = msdfgen::Vector2(-left, -bottom);
+
+    // Same result as msdfgen::generateMSDF, error correction needs every row so it runs after the split
+    auto generate_rows = [&](std::size_t begin, std::size_t end) {
+        msdfgen::generateMSDFRows(msdf, shape, px_range, 1.0, translate, int(begin), int(end));
+    };
+
+    if (workers) {
+        workers->parallel_for(std::size_t(height), rows_per_task, generate_rows);
+    } else {
+        generate_rows(0, std::size_t(height));
+    }
+
+    msdfgen::msdfErrorCorrection(msdf, 1.00000001 / (msdfgen::Vector2(1.0) * px_range));
+
+    std::vector<unsigned char> pixels;
+    pixels.reserve(4*msdf.width()*msdf.height());
+    for (int y = 0; y < msdf.height(); ++y) {
+        for (int x = 0; x < msdf.width(); ++x) {
+            pixels.push_back(msdfgen::clamp(msdf(x, y).r * 256.f, 255.f));
+            pixels.push_back(msdfgen::clamp(msdf(x, y).g * 256.f, 255.f));
+            pixels.push_back(msdfgen::clamp(msdf(x, y).b * 256.f, 255.f));
+            pixels.push_back(255);
+        }
+    }
+
+    return pixels;
+}
+
+void glyph_generator::wait_all() {
+    // Moved-from generators have no group
+    if (!group || !workers) {
+        return;
+    }
+
+    try {
+        workers->wait(*group);
+    } catch (const std::exception& e) {
+        std::cerr << "ERROR: Glyph generation failed: " << e.what() << std::endl;
+    }
+}
+
+} // namespace ember
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "thread_pool.hpp"
+
+#include <msdfgen.h>
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace ember {
+
+/**
+ * Rasterizes MSDF glyphs off the render thread.
+ * Glyph outlines are loaded by the font on the main thread, since FreeType faces cannot be shared between threads,
+ * then edge coloring and distance field generation run on the thread pool. Without worker threads, queued glyphs
+ * are rasterized at the start of each frame instead, within a small time budget.
+ * Fonts poll their jobs and upload finished bitmaps, limited to a number of uploads per frame. A job that throws is
+ * logged right away and marked failed, and the font submits the glyph again on a later request.
+ */
+class glyph_generator {
+public:
+    /** Shared by the requesting font and the task, so either may go away first */
+    struct job {
+        std::atomic<bool> done = false;
+        std::atomic<bool> failed = false; /** Generation threw and was logged, the glyph should be submitted again */
+        int width = 0;
+        int height = 0;
+        std::vector<unsigned char> pixels; /** RGBA, bottom row first, only valid once done */
+    };
+
+    glyph_generator() = default;
+    explicit glyph_generator(thread_pool* workers, int uploads_per_frame = 8);
+    glyph_generator(const glyph_generator&) = delete;
+    glyph_generator(glyph_generator&&) = default;
+    glyph_generator& operator=(const glyph_generator&) = delete;
+    glyph_generator& operator=(glyph_generator&& other);
+    ~glyph_generator();
+
+    /** Resets the upload budget, and without worker threads rasterizes queued glyphs for about a millisecond */
+    void begin_frame();
+
+    /** Queues a glyph, the shape is copied to the task */
+    auto submit(const msdfgen::Shape& shape, int width, int height, double left, double bottom, double px_range)
+        -> std::shared_ptr<job>;
+
+    /** Takes one upload from this frame's budget, returns false once it is spent */
+    bool try_acquire_upload();
+
+    /**
+     * Colors edges and generates the distance field, returns RGBA pixels bottom row first.
+     * With workers, blocks of rows are generated in parallel, which helps most when few large glyphs are requested.
+     */
+    static auto rasterize(
+        msdfgen::Shape shape,
+        int width,
+        int height,
+        double left,
+        double bottom,
+        double px_range,
+        thread_pool* workers = nullptr) -> std::vector<unsigned char>;
+
+private:
+    void wait_all();
+
+    thread_pool* workers = nullptr;
+    std::unique_ptr<thread_pool::task_group> group = std::make_unique<thread_pool::task_group>();
+    std::deque<std::function<void()>> inline_queue; /** Used when there are no worker threads */
+    int uploads_per_frame = 8;
+    int uploads_left = 8;
+};
+
+} // namespace ember
@@ -32,10 +32,38 @@ void visit_in_order(ember::gui::widget& root, const F& func) {
     return visit_in_order(root, func, [](auto&){});
 }
 
+// Attribute value without a copy, nullptr if it is not set
+const std::string* find_attribute(const ember::gui::widget& w, const ember::atom& name) {
+    const auto& attributes = w.get_all_attributes();
+    auto iter = attributes.find(name);
+    return iter != attributes.end() ? &iter->second : nullptr;
+}
+
 } // static
 
 namespace ember::gui {
 
+// Attribute names, interned once
+namespace attrs {
+const auto bottom = atom("bottom");
+const auto clip = atom("clip");
+const auto color = atom("color");
+const auto euler = atom("euler");
+const auto font = atom("font");
+const auto halign = atom("halign");
+const auto height = atom("height");
+const auto left = atom("left");
+const auto right = atom("right");
+const auto scale = atom("scale");
+const auto text = atom("text");
+const auto texture = atom("texture");
+const auto top = atom("top");
+const auto translate = atom("translate");
+const auto valign = atom("valign");
+const auto visible = atom("visible");
+const auto width = atom("width");
+} // namespace attrs
+
 widget::widget(render_context& renderer) : renderer(&renderer) {}
 
 widget* widget::get_parent() const { return parent; }
@@ -151,7 +179,7 @@ void widget::clear_children() {
     children.clear();
 }
 
-void widget::set_attribute(const std::string& name, sol::optional<std::string> value) {
+void widget::set_attribute(const atom& name, sol::optional<std::string> value) {
     if (value) {
         attributes.insert_or_assign(name, *value);
     } else {
@@ -159,7 +187,7 @@ void widget::set_attribute(const std::string& name, sol::optional<std::string> v
     }
 }
 
-sol::optional<std::string> widget::get_attribute(const std::string& name) const {
+sol::optional<std::string> widget::get_attribute(const atom& name) const {
     auto iter = attributes.find(name);
     if (iter != attributes.end()) {
         return iter->second;
@@ -168,11 +196,11 @@ sol::optional<std::string> widget::get_attribute(const std::string& name) const
     }
 }
 
-bool widget::has_attribute(const std::string& name) const {
+bool widget::has_attribute(const atom& name) const {
     return attributes.find(name) != attributes.end();
 }
 
-const std::unordered_map<std::string, std::string>& widget::get_all_attributes() const {
+const std::unordered_map<atom, std::string>& widget::get_all_attributes() const {
     return attributes;
 }
 
@@ -183,7 +211,7 @@ void widget::calculate_layout() {
     layout.position = {0, 0};
     layout.visible = true;
 
-    if (auto attr_width = get_attribute("width")) {
+    if (auto attr_width = get_attribute(attrs::width)) {
         std::size_t len;
 
         const auto& str_width = *attr_width;
@@ -207,7 +235,7 @@ void widget::calculate_layout() {
         }
     }
 
-    if (auto attr_height = get_attribute("height")) {
+    if (auto attr_height = get_attribute(attrs::height)) {
         std::size_t len;
 
         const auto& str_height = *attr_height;
@@ -231,23 +259,23 @@ void widget::calculate_layout() {
         }
     }
 
-    if (auto attr_left = get_attribute("left")) {
+    if (auto attr_left = get_attribute(attrs::left)) {
         layout.position.x = std::stoi(*attr_left);
     }
 
-    if (auto attr_right = get_attribute("right")) {
+    if (auto attr_right = get_attribute(attrs::right)) {
         layout.position.x = std::stoi(*attr_right) - layout.size.x;
     }
 
-    if (auto attr_bottom = get_attribute("bottom")) {
+    if (auto attr_bottom = get_attribute(attrs::bottom)) {
         layout.position.y = std::stoi(*attr_bottom);
     }
 
-    if (auto attr_top = get_attribute("top")) {
+    if (auto attr_top = get_attribute(attrs::top)) {
         layout.position.y = std::stoi(*attr_top) - layout.size.y;
     }
 
-    if (auto attr_visible = get_attribute("visible")) {
+    if (auto attr_visible = get_attribute(attrs::visible)) {
         if (*attr_visible == "false") {
             layout.visible = false;
         }
@@ -256,7 +284,7 @@ void widget::calculate_layout() {
     if (auto parent = get_parent()) {
         const auto& parent_layout = parent->get_layout();
 
-        auto align = [&](float glm::vec2::* d, std::string name, std::string normal, std::string opposite) {
+        auto align = [&](float glm::vec2::* d, const atom& name, std::string normal, std::string opposite) {
             auto attr_align = get_attribute(name).value_or(normal);
 
             if (attr_align == normal) {
@@ -275,8 +303,8 @@ void widget::calculate_layout() {
             }
         };
 
-        align(&glm::vec2::x, "halign", "left", "right");
-        align(&glm::vec2::y, "valign", "bottom", "top");
+        align(&glm::vec2::x, attrs::halign, "left", "right");
+        align(&glm::vec2::y, attrs::valign, "bottom", "top");
     }
 
     set_layout(layout);
@@ -327,7 +355,22 @@ void calculate_all_layouts(widget& root) try {
 }
 
 void draw_all(widget& root) {
-    visit_in_order(root, [](widget& w){ w.draw_self(); });
+    // Widgets with a clip attribute keep their descendants inside their own rectangle
+    auto pre = [](widget& w) {
+        w.draw_self();
+        if (w.has_attribute(attrs::clip)) {
+            const auto& layout = w.get_layout();
+            w.get_renderer()->push_clip(layout.position, layout.size);
+        }
+    };
+
+    auto post = [](widget& w) {
+        if (w.has_attribute(attrs::clip)) {
+            w.get_renderer()->pop_clip();
+        }
+    };
+
+    visit_in_order(root, pre, post);
 }
 
 // label
@@ -337,83 +380,105 @@ label::label(render_context& renderer) : widget(renderer) {}
 std::string label::get_type() const { return "label"; }
 
 void label::draw_self() const {
-    const auto& layout = get_layout();
-    get_renderer()->draw_text(text, font, color, layout.position, layout.size.y);
+    if (shaped) {
+        get_renderer()->draw_text(*shaped, color, get_layout().position);
+    }
 }
 
 void label::calculate_layout() {
     widget::calculate_layout();
 
-    text = get_attribute("text").value_or("");
+    static const auto empty = std::string{};
+    static const auto default_font = std::string{"LiberationSans-Regular"};
+    static const auto default_color = std::string{"#000"};
+
+    auto attr_text = find_attribute(*this, attrs::text);
+    const auto& new_text = attr_text ? *attr_text : empty;
 
-    auto attr_font = get_attribute("font");
+    auto attr_font = find_attribute(*this, attrs::font);
 
     if (!attr_font) {
         auto parent = get_parent();
         while (!attr_font && parent) {
-            attr_font = parent->get_attribute("font");
+            attr_font = find_attribute(*parent, attrs::font);
             parent = parent->get_parent();
         }
     }
 
-    font = attr_font.value_or("LiberationSans-Regular");
-
-    auto attr_color = get_attribute("color").value_or("#000");
-
-    color = {0, 0, 0, 1};
-
-    if (attr_color[0] == '#') {
-        switch (attr_color.size()) {
-        case 4:
-            color[0] = float(std::stoi(attr_color.substr(1, 1), nullptr, 16)) / 15.f;
-            color[1] = float(std::stoi(attr_color.substr(2, 1), nullptr, 16)) / 15.f;
-            color[2] = float(std::stoi(attr_color.substr(3, 1), nullptr, 16)) / 15.f;
-            color[3] = 1.f;
-            break;
-        case 5:
-            color[0] = float(std::stoi(attr_color.substr(1, 1), nullptr, 16)) / 15.f;
-            color[1] = float(std::stoi(attr_color.substr(2, 1), nullptr, 16)) / 15.f;
-            color[2] = float(std::stoi(attr_color.substr(3, 1), nullptr, 16)) / 15.f;
-            color[3] = float(std::stoi(attr_color.substr(4, 1), nullptr, 16)) / 15.f;
-            break;
-        case 7:
-            color[0] = float(std::stoi(attr_color.substr(1, 2), nullptr, 16)) / 255.f;
-            color[1] = float(std::stoi(attr_color.substr(3, 2), nullptr, 16)) / 255.f;
-            color[2] = float(std::stoi(attr_color.substr(5, 2), nullptr, 16)) / 255.f;
-            color[3] = 1.f;
-            break;
-        case 9:
-            color[0] = float(std::stoi(attr_color.substr(1, 2), nullptr, 16)) / 255.f;
-            color[1] = float(std::stoi(attr_color.substr(3, 2), nullptr, 16)) / 255.f;
-            color[2] = float(std::stoi(attr_color.substr(5, 2), nullptr, 16)) / 255.f;
-            color[3] = float(std::stoi(attr_color.substr(7, 2), nullptr, 16)) / 255.f;
-            break;
-        }
-    } else {
-        if (attr_color == "black") {
-            color = {0, 0, 0, 1};
-        } else if (attr_color == "white") {
-            color = {1, 1, 1, 1};
+    // Interning hashes the name, skip it while the font stays the same
+    const auto& font_name = attr_font ? *attr_font : default_font;
+    if (font_name != font.str()) {
+        font = atom(font_name);
+    }
+
+    auto found_color = find_attribute(*this, attrs::color);
+    const auto& new_color = found_color ? *found_color : default_color;
+
+    if (!shaped || new_color != color_source) {
+        color_source = new_color;
+
+        const auto& attr_color = color_source;
+
+        color = {0, 0, 0, 1};
+
+        if (attr_color[0] == '#') {
+            switch (attr_color.size()) {
+            case 4:
+                color[0] = float(std::stoi(attr_color.substr(1, 1), nullptr, 16)) / 15.f;
+                color[1] = float(std::stoi(attr_color.substr(2, 1), nullptr, 16)) / 15.f;
+                color[2] = float(std::stoi(attr_color.substr(3, 1), nullptr, 16)) / 15.f;
+                color[3] = 1.f;
+                break;
+            case 5:
+                color[0] = float(std::stoi(attr_color.substr(1, 1), nullptr, 16)) / 15.f;
+                color[1] = float(std::stoi(attr_color.substr(2, 1), nullptr, 16)) / 15.f;
+                color[2] = float(std::stoi(attr_color.substr(3, 1), nullptr, 16)) / 15.f;
+                color[3] = float(std::stoi(attr_color.substr(4, 1), nullptr, 16)) / 15.f;
+                break;
+            case 7:
+                color[0] = float(std::stoi(attr_color.substr(1, 2), nullptr, 16)) / 255.f;
+                color[1] = float(std::stoi(attr_color.substr(3, 2), nullptr, 16)) / 255.f;
+                color[2] = float(std::stoi(attr_color.substr(5, 2), nullptr, 16)) / 255.f;
+                color[3] = 1.f;
+                break;
+            case 9:
+                color[0] = float(std::stoi(attr_color.substr(1, 2), nullptr, 16)) / 255.f;
+                color[1] = float(std::stoi(attr_color.substr(3, 2), nullptr, 16)) / 255.f;
+                color[2] = float(std::stoi(attr_color.substr(5, 2), nullptr, 16)) / 255.f;
+                color[3] = float(std::stoi(attr_color.substr(7, 2), nullptr, 16)) / 255.f;
+                break;
+            }
+        } else {
+            if (attr_color == "black") {
+                color = {0, 0, 0, 1};
+            } else if (attr_color == "white") {
+                color = {1, 1, 1, 1};
+            }
         }
     }
 
     auto layout = get_layout();
 
+    if (!shaped || new_text != text || font != shaped->font || layout.size.y != shaped->size) {
+        text = new_text;
+        shaped = get_renderer()->layout_text(text, font, layout.size.y);
+    }
+
     layout.position.x = 0;
-    layout.size.x = layout.size.y * get_renderer()->get_text_width(text, font);
+    layout.size.x = shaped->width;
 
-    if (auto attr_left = get_attribute("left")) {
+    if (auto attr_left = get_attribute(attrs::left)) {
         layout.position.x = std::stoi(*attr_left);
     }
 
-    if (auto attr_right = get_attribute("right")) {
+    if (auto attr_right = get_attribute(attrs::right)) {
         layout.position.x = std::stoi(*attr_right) - layout.size.x;
     }
 
     if (auto parent = get_parent()) {
         const auto& parent_layout = get_parent()->get_layout();
 
-        auto attr_halign = get_attribute("halign").value_or("left");
+        auto attr_halign = get_attribute(attrs::halign).value_or("left");
 
         if (attr_halign == "left") {
             layout.position.x += parent_layout.position.x;
@@ -452,9 +517,9 @@ void panel::draw_self() const {
 void panel::calculate_layout() {
     widget::calculate_layout();
 
-    texture = get_attribute("texture").value_or(":white");
+    texture = get_attribute(attrs::texture).value_or(":white");
 
-    auto attr_color = get_attribute("color").value_or("white");
+    auto attr_color = get_attribute(attrs::color).value_or("white");
 
     if (attr_color[0] == '#') {
         switch (attr_color.size()) {
@@ -515,10 +580,10 @@ void model::draw_self() const {
 void model::calculate_layout() {
     widget::calculate_layout();
 
-    mesh = get_attribute("texture").value_or("default");
-    texture = get_attribute("texture").value_or("default");
+    mesh = get_attribute(attrs::texture).value_or("default");
+    texture = get_attribute(attrs::texture).value_or("default");
 
-    auto read_triple = [&](const std::string& attr_name,
+    auto read_triple = [&](const atom& attr_name,
                            const std::tuple<float, float, float>& default_) -> std::tuple<float, float, float> {
         auto attr = get_attribute(attr_name);
         if (!attr) {
@@ -531,9 +596,9 @@ void model::calculate_layout() {
         return {a, b, c};
     };
 
-    std::tie(translate.x, translate.y, translate.z) = read_triple("translate", {0, 0, 0});
-    std::tie(rotate.z, rotate.x, rotate.y) = read_triple("euler", {0, 0, 0});
-    std::tie(scale.x, scale.y, scale.z) = read_triple("scale", {1, 1, 1});
+    std::tie(translate.x, translate.y, translate.z) = read_triple(attrs::translate, {0, 0, 0});
+    std::tie(rotate.z, rotate.x, rotate.y) = read_triple(attrs::euler, {0, 0, 0});
+    std::tie(scale.x, scale.y, scale.z) = read_triple(attrs::scale, {1, 1, 1});
 }
 
 } // namespace ember::gui
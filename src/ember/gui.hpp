@@ -1,8 +1,11 @@
 #pragma once
 
+#include "atom.hpp"
+
 #include <glm/glm.hpp>
 #include <sol.hpp>
 
+#include <cstddef>
 #include <memory>
 #include <vector>
 #include <string>
@@ -12,16 +15,48 @@
 
 namespace ember::gui {
 
+/**
+ * Glyphs of a text placed for one font and size by a render_context.
+ * Positions are in pixels relative to the start of the first baseline, kerning is already applied to the pens.
+ * Lines are split at '\n', each line is one size lower than the previous one.
+ */
+struct text_layout {
+    struct glyph {
+        int codepoint;
+        glm::vec2 pen;
+        float advance;
+    };
+
+    struct line {
+        std::size_t first; /** Index of the line's first glyph */
+        std::size_t count;
+        float width;
+    };
+
+    atom font;
+    float size = 0;
+    std::vector<glyph> glyphs;
+    std::vector<line> lines;
+    float width = 0; /** Widest line */
+};
+
 class render_context {
 public:
     virtual ~render_context() = 0;
 
     virtual void begin() = 0;
     virtual void end() = 0;
-    virtual void draw_rectangle(const std::string& texture, const glm::vec4& color, glm::vec2 position, glm::vec2 size) = 0;
-    virtual void draw_model(const std::string& mesh, const std::string& texture, glm::vec2 position, glm::vec2 size, glm::mat4 model_mat) = 0;
-    virtual void draw_text(const std::string& text, const std::string& font, const glm::vec4& color, glm::vec2 position, float size) = 0;
-    virtual float get_text_width(const std::string& text, const std::string& font) = 0;
+    virtual void draw_rectangle(const atom& texture, const glm::vec4& color, glm::vec2 position, glm::vec2 size) = 0;
+    virtual void draw_model(const atom& mesh, const atom& texture, glm::vec2 position, glm::vec2 size, glm::mat4 model_mat) = 0;
+    virtual void draw_text(const text_layout& text, const glm::vec4& color, glm::vec2 position) = 0;
+
+    /** Measures and places a text, equal texts, fonts and sizes may share a cached layout */
+    virtual auto layout_text(const std::string& text, const atom& font, float size)
+        -> std::shared_ptr<const text_layout> = 0;
+
+    /** Restricts drawing to a rectangle until the matching pop_clip(), nested clips intersect */
+    virtual void push_clip(glm::vec2 position, glm::vec2 size) = 0;
+    virtual void pop_clip() = 0;
 };
 
 inline render_context::~render_context() = default;
@@ -75,13 +110,13 @@ public:
 
     // Attrs
 
-    void set_attribute(const std::string& name, sol::optional<std::string> value);
+    void set_attribute(const atom& name, sol::optional<std::string> value);
 
-    sol::optional<std::string> get_attribute(const std::string& name) const;
+    sol::optional<std::string> get_attribute(const atom& name) const;
 
-    bool has_attribute(const std::string& name) const;
+    bool has_attribute(const atom& name) const;
 
-    const std::unordered_map<std::string, std::string>& get_all_attributes() const;
+    const std::unordered_map<atom, std::string>& get_all_attributes() const;
 
     // Events
 
@@ -103,7 +138,7 @@ protected:
 
 private:
     std::vector<std::shared_ptr<widget>> children = {};
-    std::unordered_map<std::string, std::string> attributes = {};
+    std::unordered_map<atom, std::string> attributes = {};
     widget* parent = nullptr;
     widget* next_sibling = nullptr;
     render_context* renderer = nullptr;
@@ -130,8 +165,10 @@ public:
 
 private:
     std::string text;
-    std::string font;
+    atom font;
+    std::string color_source; /** Color attribute the color was parsed from */
     glm::vec4 color;
+    std::shared_ptr<const text_layout> shaped; /** Laid out again only when the text, font or size changes */
 };
 
 class panel final : public widget {
@@ -149,7 +186,7 @@ public:
     virtual void calculate_layout() override;
 
 private:
-    std::string texture;
+    atom texture;
     glm::vec4 color;
 };
 
@@ -166,8 +203,8 @@ public:
     virtual void calculate_layout() override;
 
 private:
-    std::string mesh;
-    std::string texture;
+    atom mesh;
+    atom texture;
     glm::vec3 translate;
     glm::vec3 rotate;
     glm::vec3 scale;
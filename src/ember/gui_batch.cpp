@@ -0,0 +1,155 @@
+#include "gui_batch.hpp"
+
+#include "gl_state.hpp"
+#include "utility.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+namespace ember {
+
+void gui_batch::begin(const glm::vec2& display_area) {
+    this->display_area = display_area;
+    vertices.clear();
+    runs.clear();
+    clips.assign(1, rect{{0, 0}, display_area});
+    clip_stack.clear();
+    frame_stats = {};
+}
+
+void gui_batch::push_clip(glm::vec2 position, glm::vec2 size) {
+    const auto& outer = clips[current_clip()];
+
+    auto r = rect{glm::max(position, outer.min), glm::min(position + size, outer.max)};
+    r.max = glm::max(r.min, r.max);
+
+    clip_stack.push_back(std::uint32_t(clips.size()));
+    clips.push_back(r);
+}
+
+void gui_batch::pop_clip() {
+    if (!clip_stack.empty()) {
+        clip_stack.pop_back();
+    }
+}
+
+void gui_batch::add_quad(
+    const sushi::texture_2d& texture,
+    glm::vec2 position,
+    glm::vec2 size,
+    glm::vec2 uv1,
+    glm::vec2 uv2,
+    const glm::vec4& color,
+    glm::vec2 msdf_unit) {
+    auto clip = current_clip();
+
+    // Fully clipped quads are dropped here rather than left to the scissor test
+    if (clip != 0) {
+        const auto& r = clips[clip];
+        auto max = position + size;
+        if (max.x <= r.min.x || max.y <= r.min.y || position.x >= r.max.x || position.y >= r.max.y) {
+            return;
+        }
+    }
+
+    auto first = std::uint32_t(vertices.size());
+
+    if (!runs.empty() && runs.back().texture == &texture && runs.back().clip == clip) {
+        runs.back().count += 6;
+    } else {
+        runs.push_back({&texture, clip, first, 6});
+    }
+
+    auto bottomleft = vertex{position, uv1, color, msdf_unit};
+    auto topleft = vertex{{position.x, position.y + size.y}, {uv1.x, uv2.y}, color, msdf_unit};
+    auto bottomright = vertex{{position.x + size.x, position.y}, {uv2.x, uv1.y}, color, msdf_unit};
+    auto topright = vertex{position + size, uv2, color, msdf_unit};
+
+    vertices.insert(vertices.end(), {bottomleft, topleft, topright, topright, bottomright, bottomleft});
+
+    ++frame_stats.quads;
+}
+
+void gui_batch::flush(shaders::gui_shader_program& shader) {
+    EMBER_DEFER {
+        vertices.clear();
+        runs.clear();
+    };
+
+    if (runs.empty()) {
+        return;
+    }
+
+    if (!buffer) {
+        buffer = sushi::make_unique_buffer();
+    }
+
+    auto& backend = get_render_backend();
+
+    backend.bind_buffer(buffer.get());
+
+    // Orphan the old storage so the driver does not stall on earlier draws from it
+    if (vertices.size() > buffer_capacity) {
+        buffer_capacity = std::max(vertices.size(), buffer_capacity * 2);
+    }
+    backend.buffer_data(buffer_capacity * sizeof(vertex), nullptr, GL_STREAM_DRAW);
+    backend.buffer_sub_data(0, vertices.size() * sizeof(vertex), vertices.data());
+
+    const auto& attribs = shader.get_vertex_attribs();
+
+    auto position = GLuint(sushi::attrib_location::POSITION);
+    auto texcoord = GLuint(sushi::attrib_location::TEXCOORD);
+
+    backend.set_attrib_array_enabled(position, true);
+    backend.set_attrib_array_enabled(texcoord, true);
+    backend.vertex_attrib_pointer(position, 2, sizeof(vertex), offsetof(vertex, position));
+    backend.vertex_attrib_pointer(texcoord, 2, sizeof(vertex), offsetof(vertex, texcoord));
+
+    // Not bound to fixed locations, and compiled out if the shader does not use them
+    if (attribs.color >= 0) {
+        backend.set_attrib_array_enabled(GLuint(attribs.color), true);
+        backend.vertex_attrib_pointer(GLuint(attribs.color), 4, sizeof(vertex), offsetof(vertex, color));
+    }
+
+    if (attribs.msdf_unit >= 0) {
+        backend.set_attrib_array_enabled(GLuint(attribs.msdf_unit), true);
+        backend.vertex_attrib_pointer(GLuint(attribs.msdf_unit), 2, sizeof(vertex), offsetof(vertex, msdf_unit));
+    }
+
+    shader.bind();
+    shader.set_MVP(glm::ortho(0.f, display_area.x, 0.f, display_area.y, -1.f, 1.f));
+
+    for (const auto& r : runs) {
+        if (r.clip == 0) {
+            gl_state::set_enabled(GL_SCISSOR_TEST, false);
+        } else {
+            const auto& c = clips[r.clip];
+            auto x = GLint(std::floor(c.min.x));
+            auto y = GLint(std::floor(c.min.y));
+            gl_state::set_enabled(GL_SCISSOR_TEST, true);
+            gl_state::scissor(x, y, GLsizei(std::ceil(c.max.x)) - x, GLsizei(std::ceil(c.max.y)) - y);
+        }
+
+        gl_state::bind_texture(0, *r.texture);
+        backend.draw_arrays(GL_TRIANGLES, GLint(r.first), GLsizei(r.count));
+        ++frame_stats.draws;
+    }
+
+    gl_state::set_enabled(GL_SCISSOR_TEST, false);
+
+    // Other draws do not expect these attributes
+    if (attribs.color >= 0) {
+        backend.set_attrib_array_enabled(GLuint(attribs.color), false);
+    }
+
+    if (attribs.msdf_unit >= 0) {
+        backend.set_attrib_array_enabled(GLuint(attribs.msdf_unit), false);
+    }
+
+    backend.bind_buffer(0);
+}
+
+} // namespace ember
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "shaders.hpp"
+
+#include <sushi/sushi.hpp>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace ember {
+
+/**
+ * Collects the GUI's textured quads and MSDF glyphs into one vertex stream and draws them in submission order.
+ * Consecutive quads with the same texture and clip rect share a draw call, so a frame costs one draw per texture or
+ * clip change rather than one per panel or character. Coordinates are pixels with the origin at the bottom left.
+ */
+class gui_batch {
+public:
+    struct stats {
+        int draws;
+        int quads;
+    };
+
+    gui_batch() = default;
+    gui_batch(const gui_batch&) = delete;
+    gui_batch(gui_batch&&) = default;
+    gui_batch& operator=(const gui_batch&) = delete;
+    gui_batch& operator=(gui_batch&&) = default;
+
+    /** Starts a frame, clears the clip stack and stats */
+    void begin(const glm::vec2& display_area);
+
+    /** Restricts following quads to a rectangle, intersected with the enclosing clip */
+    void push_clip(glm::vec2 position, glm::vec2 size);
+
+    void pop_clip();
+
+    /**
+     * Adds a quad, uv1 is the texcoord at the bottom left corner and uv2 at the top right.
+     * A nonzero msdf_unit (pxRange / texture size) draws the texture as a multi-channel distance field in color.
+     * The texture is not owned and must live until the next flush().
+     */
+    void add_quad(
+        const sushi::texture_2d& texture,
+        glm::vec2 position,
+        glm::vec2 size,
+        glm::vec2 uv1,
+        glm::vec2 uv2,
+        const glm::vec4& color,
+        glm::vec2 msdf_unit = {0, 0});
+
+    /** Draws and clears queued quads, call before drawing anything else so the order is kept */
+    void flush(shaders::gui_shader_program& shader);
+
+    /** Totals since begin() */
+    auto get_stats() const -> const stats& { return frame_stats; }
+
+private:
+    struct vertex {
+        glm::vec2 position;
+        glm::vec2 texcoord;
+        glm::vec4 color;
+        glm::vec2 msdf_unit;
+    };
+
+    struct rect {
+        glm::vec2 min;
+        glm::vec2 max;
+    };
+
+    struct run {
+        const sushi::texture_2d* texture;
+        std::uint32_t clip; /** Index into clips, 0 is unclipped */
+        std::uint32_t first; /** In vertices */
+        std::uint32_t count;
+    };
+
+    auto current_clip() const -> std::uint32_t { return clip_stack.empty() ? 0 : clip_stack.back(); }
+
+    glm::vec2 display_area = {0, 0};
+    std::vector<vertex> vertices;
+    std::vector<run> runs;
+    std::vector<rect> clips = {rect{}};
+    std::vector<std::uint32_t> clip_stack;
+    sushi::unique_buffer buffer;
+    std::size_t buffer_capacity = 0; /** In vertices */
+    stats frame_stats = {};
+};
+
+} // namespace ember
@@ -0,0 +1,257 @@
+#include "instancing.hpp"
+
+#include "gl_state.hpp"
+#include "iqm.hpp"
+#include "sdl.hpp"
+#include "utility.hpp"
+
+#include <algorithm>
+#include <cstddef>
+
+namespace ember {
+
+namespace {
+
+bool instancing_supported() {
+#ifdef __EMSCRIPTEN__
+    return SDL_GL_ExtensionSupported("GL_ANGLE_instanced_arrays");
+#else
+    return SDL_GL_ExtensionSupported("GL_ARB_instanced_arrays");
+#endif
+}
+
+} // namespace
+
+auto instanced_mesh::load_iqm(const std::string& filename) -> std::optional<instanced_mesh> {
+    auto geo = iqm::load_geometry(filename);
+    if (!geo) {
+        return std::nullopt;
+    }
+
+    // Unindexed, so instanced draws do not depend on 32-bit element indices
+    auto vertices = std::vector<vertex>{};
+    vertices.reserve(geo->indices.size());
+
+    for (auto index : geo->indices) {
+        auto v = vertex{};
+        v.position = geo->positions[index];
+
+        if (!geo->texcoords.empty()) {
+            v.texcoord = geo->texcoords[index];
+        }
+
+        if (!geo->normals.empty()) {
+            v.normal = geo->normals[index];
+        }
+
+        vertices.push_back(v);
+    }
+
+    auto mesh = instanced_mesh{};
+    mesh.vertices = sushi::make_unique_buffer();
+    mesh.count = GLsizei(vertices.size());
+
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.vertices.get());
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(vertex), vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    return mesh;
+}
+
+void instance_renderer::begin(
+    shaders::instanced_shader_program& shader, const glm::mat4& proj, const glm::mat4& view) {
+    if (!hardware) {
+        hardware = instancing_supported();
+    }
+
+    this->shader = &shader;
+
+    for (std::size_t i = 0; i < batch_count; ++i) {
+        batches[i].mesh = nullptr;
+        batches[i].texture = nullptr;
+        batches[i].instances.clear();
+    }
+
+    batch_count = 0;
+    batch_index.clear();
+
+    shader.bind();
+    shader.set_ViewProj(proj * view);
+    shader.set_View(view);
+}
+
+void instance_renderer::add(
+    const std::shared_ptr<instanced_mesh>& mesh,
+    const std::shared_ptr<sushi::texture_2d>& texture,
+    const glm::mat4& modelmat,
+    const glm::vec4& tint) {
+    auto [iter, inserted] = batch_index.try_emplace({mesh.get(), texture.get()}, batch_count);
+
+    if (inserted) {
+        if (batch_count == batches.size()) {
+            batches.emplace_back();
+        }
+
+        batches[batch_count].mesh = mesh;
+        batches[batch_count].texture = texture;
+        ++batch_count;
+    }
+
+    batches[iter->second].instances.push_back({modelmat, tint});
+}
+
+void instance_renderer::finish() {
+    last_stats = {};
+    last_stats.hardware = hardware.value_or(false);
+
+    if (batch_count == 0) {
+        return;
+    }
+
+    shader->bind();
+
+    if (last_stats.hardware) {
+        draw_hardware();
+    } else {
+        draw_fallback();
+    }
+
+    get_render_backend().bind_buffer(0);
+}
+
+void instance_renderer::bind_mesh(const instanced_mesh& mesh) {
+    auto position = GLuint(sushi::attrib_location::POSITION);
+    auto texcoord = GLuint(sushi::attrib_location::TEXCOORD);
+    auto normal = GLuint(sushi::attrib_location::NORMAL);
+
+    auto& backend = get_render_backend();
+    auto stride = GLsizei(sizeof(instanced_mesh::vertex));
+
+    backend.bind_buffer(mesh.vertices.get());
+    backend.set_attrib_array_enabled(position, true);
+    backend.set_attrib_array_enabled(texcoord, true);
+    backend.set_attrib_array_enabled(normal, true);
+    backend.vertex_attrib_pointer(position, 3, stride, offsetof(instanced_mesh::vertex, position));
+    backend.vertex_attrib_pointer(texcoord, 2, stride, offsetof(instanced_mesh::vertex, texcoord));
+    backend.vertex_attrib_pointer(normal, 3, stride, offsetof(instanced_mesh::vertex, normal));
+}
+
+void instance_renderer::draw_hardware() {
+    const auto& attribs = shader->get_instance_attribs();
+
+    // All batches share one stream buffer, each batch points its attributes at its own range
+    stream.clear();
+    for (std::size_t i = 0; i < batch_count; ++i) {
+        const auto& instances = batches[i].instances;
+        stream.insert(stream.end(), instances.begin(), instances.end());
+    }
+
+    if (!stream_buffer) {
+        stream_buffer = sushi::make_unique_buffer();
+    }
+
+    auto& backend = get_render_backend();
+
+    backend.bind_buffer(stream_buffer.get());
+
+    // Orphan the old storage so the driver does not stall on last frame's draws
+    if (stream.size() > stream_capacity) {
+        stream_capacity = std::max(stream.size(), stream_capacity * 2);
+    }
+    backend.buffer_data(stream_capacity * sizeof(instance), nullptr, GL_STREAM_DRAW);
+    backend.buffer_sub_data(0, stream.size() * sizeof(instance), stream.data());
+
+    auto instance_locations = std::vector<GLuint>{};
+    for (auto loc : attribs.model) {
+        if (loc >= 0) {
+            instance_locations.push_back(GLuint(loc));
+        }
+    }
+    if (attribs.tint >= 0) {
+        instance_locations.push_back(GLuint(attribs.tint));
+    }
+
+    EMBER_DEFER {
+        // Other draws do not expect instanced attributes
+        for (auto loc : instance_locations) {
+            backend.vertex_attrib_divisor(loc, 0);
+            backend.set_attrib_array_enabled(loc, false);
+        }
+    };
+
+    for (auto loc : instance_locations) {
+        backend.set_attrib_array_enabled(loc, true);
+        backend.vertex_attrib_divisor(loc, 1);
+    }
+
+    auto first_instance = std::size_t{0};
+
+    for (std::size_t i = 0; i < batch_count; ++i) {
+        const auto& b = batches[i];
+        auto base = first_instance * sizeof(instance);
+
+        backend.bind_buffer(stream_buffer.get());
+
+        for (int c = 0; c < 4; ++c) {
+            if (attribs.model[c] >= 0) {
+                auto offset = base + offsetof(instance, modelmat) + c * sizeof(glm::vec4);
+                backend.vertex_attrib_pointer(GLuint(attribs.model[c]), 4, sizeof(instance), offset);
+            }
+        }
+
+        if (attribs.tint >= 0) {
+            auto offset = base + offsetof(instance, tint);
+            backend.vertex_attrib_pointer(GLuint(attribs.tint), 4, sizeof(instance), offset);
+        }
+
+        bind_mesh(*b.mesh);
+        gl_state::bind_texture(0, *b.texture);
+
+        backend.draw_arrays_instanced(GL_TRIANGLES, 0, b.mesh->count, GLsizei(b.instances.size()));
+
+        first_instance += b.instances.size();
+        ++last_stats.draws;
+        last_stats.instances += int(b.instances.size());
+    }
+}
+
+void instance_renderer::draw_fallback() {
+    const auto& attribs = shader->get_instance_attribs();
+    auto& backend = get_render_backend();
+
+    for (auto loc : attribs.model) {
+        if (loc >= 0) {
+            backend.set_attrib_array_enabled(GLuint(loc), false);
+        }
+    }
+    if (attribs.tint >= 0) {
+        backend.set_attrib_array_enabled(GLuint(attribs.tint), false);
+    }
+
+    for (std::size_t i = 0; i < batch_count; ++i) {
+        const auto& b = batches[i];
+
+        bind_mesh(*b.mesh);
+        gl_state::bind_texture(0, *b.texture);
+
+        // Constant attributes stand in for the instance streams
+        for (const auto& inst : b.instances) {
+            for (int c = 0; c < 4; ++c) {
+                if (attribs.model[c] >= 0) {
+                    backend.vertex_attrib(GLuint(attribs.model[c]), inst.modelmat[c]);
+                }
+            }
+
+            if (attribs.tint >= 0) {
+                backend.vertex_attrib(GLuint(attribs.tint), inst.tint);
+            }
+
+            backend.draw_arrays(GL_TRIANGLES, 0, b.mesh->count);
+            ++last_stats.draws;
+        }
+
+        last_stats.instances += int(b.instances.size());
+    }
+}
+
+} // namespace ember
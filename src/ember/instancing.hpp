@@ -0,0 +1,100 @@
+#pragma once
+
+#include "shaders.hpp"
+
+#include <sushi/sushi.hpp>
+#include <glm/glm.hpp>
+
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ember {
+
+/**
+ * Static geometry prepared for instanced drawing.
+ * sushi::mesh_group does not expose its vertex ranges, so instanced meshes keep their own unindexed vertex buffer.
+ */
+class instanced_mesh {
+public:
+    instanced_mesh() = default;
+
+    /** Loads the triangles of every mesh in an IQM file, skeletal data is ignored */
+    static auto load_iqm(const std::string& filename) -> std::optional<instanced_mesh>;
+
+    auto vertex_count() const -> GLsizei { return count; }
+
+private:
+    friend class instance_renderer;
+
+    struct vertex {
+        glm::vec3 position;
+        glm::vec2 texcoord;
+        glm::vec3 normal;
+    };
+
+    sushi::unique_buffer vertices;
+    GLsizei count = 0;
+};
+
+/**
+ * Draws many copies of the same meshes, one draw call per mesh and texture pair.
+ * Uses ANGLE_instanced_arrays on WebGL 1 or ARB_instanced_arrays natively, with per-instance model matrix and tint
+ * streams. Without the extension the instance data is set as constant attributes and each instance is its own draw,
+ * which still avoids uniform uploads and mesh rebinds.
+ */
+class instance_renderer {
+public:
+    struct stats {
+        int draws;
+        int instances;
+        bool hardware; /** Whether the instancing extension was used */
+    };
+
+    /** Binds the shader and clears last frame's instances */
+    void begin(shaders::instanced_shader_program& shader, const glm::mat4& proj, const glm::mat4& view);
+
+    void add(
+        const std::shared_ptr<instanced_mesh>& mesh,
+        const std::shared_ptr<sushi::texture_2d>& texture,
+        const glm::mat4& modelmat,
+        const glm::vec4& tint = {1, 1, 1, 1});
+
+    /** Draws all instances added since begin() */
+    void finish();
+
+    auto get_stats() const -> const stats& { return last_stats; }
+
+private:
+    struct instance {
+        glm::mat4 modelmat;
+        glm::vec4 tint;
+    };
+
+    struct batch {
+        std::shared_ptr<instanced_mesh> mesh;
+        std::shared_ptr<sushi::texture_2d> texture;
+        std::vector<instance> instances;
+    };
+
+    void bind_mesh(const instanced_mesh& mesh);
+
+    void draw_hardware();
+
+    void draw_fallback();
+
+    shaders::instanced_shader_program* shader = nullptr;
+    std::vector<batch> batches;
+    std::size_t batch_count = 0; /** Batches in use this frame, the rest keep their capacity */
+    std::map<std::pair<const instanced_mesh*, const sushi::texture_2d*>, std::size_t> batch_index;
+    std::vector<instance> stream;
+    sushi::unique_buffer stream_buffer;
+    std::size_t stream_capacity = 0; /** In instances */
+    std::optional<bool> hardware;
+    stats last_stats = {};
+};
+
+} // namespace ember
@@ -0,0 +1,156 @@
+#include "iqm.hpp"
+
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+namespace ember::iqm {
+
+namespace {
+
+constexpr char magic[] = "INTERQUAKEMODEL";
+constexpr std::uint32_t version = 2;
+
+enum header_field : std::size_t {
+    VERSION,
+    FILESIZE,
+    FLAGS,
+    NUM_TEXT,
+    OFS_TEXT,
+    NUM_MESHES,
+    OFS_MESHES,
+    NUM_VERTEXARRAYS,
+    NUM_VERTEXES,
+    OFS_VERTEXARRAYS,
+    NUM_TRIANGLES,
+    OFS_TRIANGLES,
+    HEADER_FIELD_COUNT = 27,
+};
+
+enum vertexarray_type : std::uint32_t {
+    POSITION = 0,
+    TEXCOORD = 1,
+    NORMAL = 2,
+};
+
+constexpr std::uint32_t format_float = 7;
+
+struct vertexarray {
+    std::uint32_t type;
+    std::uint32_t flags;
+    std::uint32_t format;
+    std::uint32_t size;
+    std::uint32_t offset;
+};
+
+template <typename T>
+auto read_at(const std::vector<char>& data, std::size_t offset) -> T {
+    auto value = T{};
+    std::memcpy(&value, data.data() + offset, sizeof(T));
+    return value;
+}
+
+
+/** Copies count elements of an IQM vertex array */
+template <typename T>
+auto read_array(const char* ptr, std::size_t count) -> std::vector<T> {
+    auto out = std::vector<T>(count);
+    std::memcpy(out.data(), ptr, count * sizeof(T));
+    return out;
+}
+
+} // namespace
+
+auto load_geometry(const std::string& filename) -> std::optional<geometry> {
+    auto file = std::ifstream(filename, std::ios::binary);
+    auto data = std::vector<char>(std::istreambuf_iterator<char>(file), {});
+
+    auto header_size = sizeof(magic) + HEADER_FIELD_COUNT * sizeof(std::uint32_t);
+
+    if (data.size() < header_size || std::memcmp(data.data(), magic, sizeof(magic)) != 0) {
+        std::cerr << "ERROR: \"" << filename << "\" is not an IQM file\n";
+        return std::nullopt;
+    }
+
+    auto header = [&](header_field field) {
+        return read_at<std::uint32_t>(data, sizeof(magic) + field * sizeof(std::uint32_t));
+    };
+
+    if (header(VERSION) != version) {
+        std::cerr << "ERROR: IQM file \"" << filename << "\" has unsupported version " << header(VERSION) << "\n";
+        return std::nullopt;
+    }
+
+    auto num_vertexes = std::size_t(header(NUM_VERTEXES));
+    auto num_triangles = std::size_t(header(NUM_TRIANGLES));
+    auto in_bounds = [&](std::size_t offset, std::size_t size) {
+        return offset <= data.size() && size <= data.size() - offset;
+    };
+
+    const char* positions = nullptr;
+    const char* texcoords = nullptr;
+    const char* normals = nullptr;
+
+    for (std::uint32_t i = 0; i < header(NUM_VERTEXARRAYS); ++i) {
+        auto array_offset = header(OFS_VERTEXARRAYS) + i * sizeof(vertexarray);
+
+        if (!in_bounds(array_offset, sizeof(vertexarray))) {
+            std::cerr << "ERROR: IQM file \"" << filename << "\" is truncated\n";
+            return std::nullopt;
+        }
+
+        auto va = read_at<vertexarray>(data, array_offset);
+
+        auto expected_size = va.type == TEXCOORD ? 2u : 3u;
+        auto wanted = va.type == POSITION || va.type == TEXCOORD || va.type == NORMAL;
+
+        if (!wanted) {
+            continue;
+        }
+
+        if (va.format != format_float || va.size != expected_size ||
+            !in_bounds(va.offset, num_vertexes * expected_size * sizeof(float))) {
+            std::cerr << "ERROR: IQM file \"" << filename << "\" has an unsupported vertex layout\n";
+            return std::nullopt;
+        }
+
+        auto ptr = data.data() + va.offset;
+
+        switch (va.type) {
+            case POSITION: positions = ptr; break;
+            case TEXCOORD: texcoords = ptr; break;
+            case NORMAL: normals = ptr; break;
+        }
+    }
+
+    if (!positions || !in_bounds(header(OFS_TRIANGLES), num_triangles * 3 * sizeof(std::uint32_t))) {
+        std::cerr << "ERROR: IQM file \"" << filename << "\" has no triangles\n";
+        return std::nullopt;
+    }
+
+    auto geo = geometry{};
+    geo.positions = read_array<glm::vec3>(positions, num_vertexes);
+
+    if (texcoords) {
+        geo.texcoords = read_array<glm::vec2>(texcoords, num_vertexes);
+    }
+
+    if (normals) {
+        geo.normals = read_array<glm::vec3>(normals, num_vertexes);
+    }
+
+    geo.indices = read_array<std::uint32_t>(data.data() + header(OFS_TRIANGLES), num_triangles * 3);
+
+    for (auto index : geo.indices) {
+        if (index >= num_vertexes) {
+            std::cerr << "ERROR: IQM file \"" << filename << "\" has an out of range triangle\n";
+            return std::nullopt;
+        }
+    }
+
+    return geo;
+}
+
+} // namespace ember::iqm
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+/** Minimal IQM reader for static geometry, see http://sauerbraten.org/iqm/ */
+namespace ember::iqm {
+
+/** Vertices and triangles of every mesh in an IQM file, skeletal data is ignored */
+struct geometry {
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec2> texcoords; /** Empty if the file has none */
+    std::vector<glm::vec3> normals; /** Empty if the file has none */
+    std::vector<std::uint32_t> indices; /** Three per triangle, all within positions */
+};
+
+/** Prints an error and returns nullopt if the file is missing or malformed */
+auto load_geometry(const std::string& filename) -> std::optional<geometry>;
+
+} // namespace ember::iqm
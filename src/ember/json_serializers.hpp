@@ -2,10 +2,24 @@
 
 #include "json.hpp"
 
+#include "atom.hpp"
 #include "reflection.hpp"
 
 #include <type_traits>
 
+namespace ember {
+
+/** Atoms are plain strings in JSON, found by ADL */
+inline void to_json(nlohmann::json& json, const atom& a) {
+    json = a.str();
+}
+
+inline void from_json(const nlohmann::json& json, atom& a) {
+    a = atom(json.get<std::string>());
+}
+
+} // namespace ember
+
 namespace ember::json_serializers::basic {
 
 template <typename T>
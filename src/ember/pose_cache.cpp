@@ -0,0 +1,100 @@
+#include "pose_cache.hpp"
+
+#include <glm/gtc/quaternion.hpp>
+
+#include <cmath>
+#include <stdexcept>
+
+namespace ember {
+
+namespace {
+
+/** Same result as sushi::get_pose() with smoothing, written into the pose's existing bone storage */
+void evaluate_into(const sushi::skeleton& skele, std::optional<int> anim_index, float time, sushi::pose& out) {
+    out.skele = &skele;
+    out.bone_transforms.resize(skele.bones.size());
+
+    if (!anim_index || skele.animations[*anim_index].frames.empty()) {
+        for (std::size_t i = 0; i < skele.bones.size(); ++i) {
+            out.bone_transforms[i] = skele.bones[i].base_pose;
+        }
+        return;
+    }
+
+    const auto& anim = skele.animations[*anim_index];
+    auto frame = time * anim.rate;
+    auto whole = std::floor(frame);
+    auto t = frame - whole;
+    auto count = std::int64_t(anim.frames.size());
+    auto index = (std::int64_t(whole) % count + count) % count; // Clips loop, negative times included
+    const auto& a = anim.frames[index];
+    const auto& b = anim.frames[(index + 1) % count];
+
+    for (std::size_t i = 0; i < skele.bones.size(); ++i) {
+        auto& bone = out.bone_transforms[i];
+        bone.pos = glm::mix(a[i].pos, b[i].pos, t);
+        bone.rot = glm::slerp(a[i].rot, b[i].rot, t);
+        bone.scl = glm::mix(a[i].scl, b[i].scl, t);
+    }
+}
+
+} // namespace
+
+pose_cache::pose_cache(float time_step) : time_step(time_step) {
+    if (!(time_step > 0)) {
+        throw std::invalid_argument("pose_cache: time_step must be positive");
+    }
+}
+
+auto pose_cache::request(
+    const std::shared_ptr<sushi::skeleton>& skeleton, std::optional<int> anim_index, float anim_time)
+    -> const sushi::pose* {
+    ++frame_stats.requests;
+
+    // Without a clip the bind pose does not depend on time
+    auto tick = anim_index ? std::int64_t(std::llround(anim_time / time_step)) : std::int64_t{0};
+    auto [iter, inserted] = lookup.try_emplace(key{skeleton.get(), anim_index.value_or(-1), tick}, nullptr);
+
+    if (!inserted) {
+        return iter->second;
+    }
+
+    if (used == poses.size()) {
+        poses.emplace_back();
+    }
+
+    auto pose = &poses[used++];
+
+    // Evaluate at the quantized time, so every request sharing this pose gets exactly what it would have computed
+    jobs.push_back({skeleton, anim_index, float(tick) * time_step, pose});
+    iter->second = pose;
+
+    return pose;
+}
+
+void pose_cache::evaluate(thread_pool* workers) {
+    auto run = [&](std::size_t b, std::size_t e) {
+        for (auto i = b; i < e; ++i) {
+            auto& j = jobs[i];
+            evaluate_into(*j.skeleton, j.anim_index, j.anim_time, *j.pose);
+        }
+    };
+
+    if (workers) {
+        workers->parallel_for(jobs.size(), 4, run);
+    } else {
+        run(0, jobs.size());
+    }
+
+    frame_stats.evaluated += int(jobs.size());
+    jobs.clear();
+}
+
+void pose_cache::clear() {
+    lookup.clear();
+    jobs.clear();
+    used = 0;
+    frame_stats = {};
+}
+
+} // namespace ember
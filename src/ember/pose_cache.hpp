@@ -0,0 +1,65 @@
+#pragma once
+
+#include "thread_pool.hpp"
+
+#include <sushi/sushi.hpp>
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <optional>
+#include <tuple>
+#include <vector>
+
+namespace ember {
+
+/**
+ * Per-frame pool of skeleton poses.
+ * Requests for the same skeleton and clip at the same quantized time share one pose, and all poses are evaluated
+ * together, in parallel, before rendering. Pose storage is reused between frames.
+ */
+class pose_cache {
+public:
+    struct stats {
+        int requests;
+        int evaluated;
+    };
+
+    /** Animation times are rounded to multiples of time_step */
+    explicit pose_cache(float time_step = 1.f / 60.f);
+
+    /**
+     * Returns the pose for a skeleton playing a clip, valid until the next clear().
+     * The pose is only filled in by evaluate(), the pointer is stable in the meantime.
+     */
+    auto request(const std::shared_ptr<sushi::skeleton>& skeleton, std::optional<int> anim_index, float anim_time)
+        -> const sushi::pose*;
+
+    /** Evaluates every pose requested since the last clear(), spread over the workers if given */
+    void evaluate(thread_pool* workers);
+
+    /** Forgets this frame's requests, keeping the storage */
+    void clear();
+
+    auto get_stats() const -> const stats& { return frame_stats; }
+
+private:
+    using key = std::tuple<const sushi::skeleton*, int, std::int64_t>;
+
+    struct job {
+        std::shared_ptr<sushi::skeleton> skeleton;
+        std::optional<int> anim_index;
+        float anim_time;
+        sushi::pose* pose;
+    };
+
+    float time_step;
+    std::map<key, const sushi::pose*> lookup;
+    std::vector<job> jobs;
+    std::deque<sushi::pose> poses; /** Only grows, so pointers stay valid */
+    std::size_t used = 0;
+    stats frame_stats = {};
+};
+
+} // namespace ember
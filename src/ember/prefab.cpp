@@ -0,0 +1,25 @@
+#include "prefab.hpp"
+
+#include <stdexcept>
+
+namespace ember {
+
+namespace scripting {
+
+template <>
+void register_type<prefab>(sol::table& lua) {
+    lua.new_usertype<prefab>("prefab", sol::constructors<prefab()>(),
+        "set", [](prefab& pre, sol::userdata com) -> prefab& {
+            auto prefab_set = com["_prefab_set"];
+            if (!prefab_set.valid()) {
+                throw std::runtime_error("prefab.set: Component type missing _prefab_set");
+            }
+            prefab_set(pre, com);
+            return pre;
+        },
+        "size", &prefab::size);
+}
+
+} //namespace scripting
+
+} // namespace ember
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "entities.hpp"
+#include "scripting.hpp"
+
+#include <ginseng/ginseng.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace ember {
+
+/**
+ * Entity archetype, built once and stamped onto any number of entities with database::instantiate().
+ * Holds one value per component type, instances receive copies.
+ */
+class prefab {
+public:
+    prefab() = default;
+    prefab(prefab&&) = default;
+    prefab& operator=(prefab&&) = default;
+
+    /** Sets the value of a component, replacing any previous value of the same type */
+    template <typename Com>
+    auto set(Com com) -> prefab& {
+        auto guid = ginseng::_detail::get_type_guid<Com>();
+        auto iter = std::find_if(begin(components), end(components), [&](auto& c) { return c->guid == guid; });
+
+        auto entry = std::make_unique<component<Com>>(guid, std::move(com));
+
+        if (iter != end(components)) {
+            *iter = std::move(entry);
+        } else {
+            components.push_back(std::move(entry));
+        }
+
+        return *this;
+    }
+
+    /** Component value, or nullptr if the prefab has none of that type */
+    template <typename Com>
+    auto get() -> Com* {
+        auto guid = ginseng::_detail::get_type_guid<Com>();
+        for (auto& c : components) {
+            if (c->guid == guid) {
+                return &static_cast<component<Com>&>(*c).value;
+            }
+        }
+        return nullptr;
+    }
+
+    auto size() const -> std::size_t { return components.size(); }
+
+private:
+    friend class database;
+
+    struct component_base {
+        explicit component_base(ginseng::_detail::type_guid guid) : guid(guid) {}
+        virtual ~component_base() = default;
+
+        /** Adds a copy of the value to every entity */
+        virtual void instantiate(database& db, utility::span<const database::ent_id> eids) const = 0;
+
+        ginseng::_detail::type_guid guid;
+    };
+
+    template <typename Com>
+    struct component final : component_base {
+        component(ginseng::_detail::type_guid guid, Com value) : component_base(guid), value(std::move(value)) {}
+
+        virtual void instantiate(database& db, utility::span<const database::ent_id> eids) const override {
+            db.add_components(eids, value);
+        }
+
+        Com value;
+    };
+
+    std::vector<std::unique_ptr<component_base>> components;
+};
+
+namespace scripting {
+
+template <>
+void register_type<prefab>(sol::table& lua);
+
+} //namespace scripting
+
+} // namespace ember
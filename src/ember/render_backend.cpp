@@ -0,0 +1,573 @@
+#include "render_backend.hpp"
+
+#include "gl_state.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <ostream>
+
+#ifdef __EMSCRIPTEN__
+// Provided by Emscripten's WebGL library when the context exposes ANGLE_instanced_arrays
+extern "C" {
+void glDrawArraysInstancedANGLE(GLenum mode, GLint first, GLsizei count, GLsizei primcount);
+void glVertexAttribDivisorANGLE(GLuint index, GLuint divisor);
+}
+#endif
+
+namespace ember {
+
+namespace {
+
+gl_render_backend default_backend;
+render_backend* current_backend = &default_backend;
+
+/** Size of one uniform value in 32 bit words */
+auto value_words(uniform_type type) -> std::size_t {
+    switch (type) {
+        case uniform_type::INT: return 1;
+        case uniform_type::FLOAT: return 1;
+        case uniform_type::VEC2: return 2;
+        case uniform_type::VEC3: return 3;
+        case uniform_type::VEC4: return 4;
+        case uniform_type::MAT3: return 9;
+        case uniform_type::MAT4: return 16;
+    }
+    return 0;
+}
+
+auto uniform_type_name(uniform_type type) -> const char* {
+    switch (type) {
+        case uniform_type::INT: return "int";
+        case uniform_type::FLOAT: return "float";
+        case uniform_type::VEC2: return "vec2";
+        case uniform_type::VEC3: return "vec3";
+        case uniform_type::VEC4: return "vec4";
+        case uniform_type::MAT3: return "mat3";
+        case uniform_type::MAT4: return "mat4";
+    }
+    return "?";
+}
+
+/** Meaningful entries of command::args */
+auto arg_count(command_type type) -> int {
+    switch (type) {
+        case command_type::USE_PROGRAM: return 1;
+        case command_type::UNIFORM: return 2;
+        case command_type::BIND_TEXTURE: return 2;
+        case command_type::SET_ENABLED: return 2;
+        case command_type::DEPTH_FUNC: return 1;
+        case command_type::DEPTH_MASK: return 1;
+        case command_type::COLOR_MASK: return 1;
+        case command_type::BLEND_FUNC: return 2;
+        case command_type::SCISSOR: return 4;
+        case command_type::VERTEX_ATTRIB: return 1;
+        case command_type::BIND_BUFFER: return 1;
+        case command_type::BUFFER_DATA: return 3;
+        case command_type::BUFFER_SUB_DATA: return 2;
+        case command_type::ATTRIB_ARRAY: return 2;
+        case command_type::VERTEX_ATTRIB_POINTER: return 4;
+        case command_type::VERTEX_ATTRIB_DIVISOR: return 2;
+        case command_type::DRAW_ARRAYS: return 3;
+        case command_type::DRAW_ARRAYS_INSTANCED: return 4;
+        case command_type::DRAW_MESH: return 1;
+    }
+    return 0;
+}
+
+} // namespace
+
+void gl_render_backend::use_program(GLuint program) {
+    glUseProgram(program);
+}
+
+void gl_render_backend::uniform_values(GLint location, uniform_type type, const void* values, GLsizei count) {
+    auto floats = static_cast<const GLfloat*>(values);
+
+    switch (type) {
+        case uniform_type::INT:
+            glUniform1iv(location, count, static_cast<const GLint*>(values));
+            break;
+        case uniform_type::FLOAT:
+            glUniform1fv(location, count, floats);
+            break;
+        case uniform_type::VEC2:
+            glUniform2fv(location, count, floats);
+            break;
+        case uniform_type::VEC3:
+            glUniform3fv(location, count, floats);
+            break;
+        case uniform_type::VEC4:
+            glUniform4fv(location, count, floats);
+            break;
+        case uniform_type::MAT3:
+            glUniformMatrix3fv(location, count, GL_FALSE, floats);
+            break;
+        case uniform_type::MAT4:
+            glUniformMatrix4fv(location, count, GL_FALSE, floats);
+            break;
+    }
+}
+
+void gl_render_backend::bind_texture(GLuint unit, GLuint texture) {
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D, texture);
+}
+
+void gl_render_backend::set_enabled(GLenum capability, bool enabled) {
+    if (enabled) {
+        glEnable(capability);
+    } else {
+        glDisable(capability);
+    }
+}
+
+void gl_render_backend::depth_func(GLenum func) {
+    glDepthFunc(func);
+}
+
+void gl_render_backend::depth_mask(bool write) {
+    glDepthMask(write);
+}
+
+void gl_render_backend::color_mask(bool write) {
+    glColorMask(write, write, write, write);
+}
+
+void gl_render_backend::blend_func(GLenum src, GLenum dst) {
+    glBlendFunc(src, dst);
+}
+
+void gl_render_backend::scissor(GLint x, GLint y, GLsizei width, GLsizei height) {
+    glScissor(x, y, width, height);
+}
+
+void gl_render_backend::vertex_attrib(GLuint location, const glm::vec4& value) {
+    glVertexAttrib4fv(location, &value[0]);
+}
+
+void gl_render_backend::bind_buffer(GLuint buffer) {
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+}
+
+void gl_render_backend::buffer_data(std::size_t size, const void* data, GLenum usage) {
+    glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(size), data, usage);
+}
+
+void gl_render_backend::buffer_sub_data(std::size_t offset, std::size_t size, const void* data) {
+    glBufferSubData(GL_ARRAY_BUFFER, GLintptr(offset), GLsizeiptr(size), data);
+}
+
+void gl_render_backend::set_attrib_array_enabled(GLuint location, bool enabled) {
+    if (enabled) {
+        glEnableVertexAttribArray(location);
+    } else {
+        glDisableVertexAttribArray(location);
+    }
+}
+
+void gl_render_backend::vertex_attrib_pointer(GLuint location, GLint components, GLsizei stride, std::size_t offset) {
+    glVertexAttribPointer(location, components, GL_FLOAT, GL_FALSE, stride, (void*)offset);
+}
+
+void gl_render_backend::vertex_attrib_divisor(GLuint location, GLuint divisor) {
+#ifdef __EMSCRIPTEN__
+    glVertexAttribDivisorANGLE(location, divisor);
+#else
+    glVertexAttribDivisor(location, divisor);
+#endif
+}
+
+void gl_render_backend::draw_arrays(GLenum mode, GLint first, GLsizei count) {
+    glDrawArrays(mode, first, count);
+}
+
+void gl_render_backend::draw_arrays_instanced(GLenum mode, GLint first, GLsizei count, GLsizei instances) {
+#ifdef __EMSCRIPTEN__
+    glDrawArraysInstancedANGLE(mode, first, count, instances);
+#else
+    glDrawArraysInstanced(mode, first, count, instances);
+#endif
+}
+
+void gl_render_backend::draw_mesh(const sushi::mesh_group& mesh, const sushi::pose* pose) {
+    if (pose) {
+        sushi::draw_mesh(mesh, *pose);
+    } else {
+        sushi::draw_mesh(mesh);
+    }
+}
+
+void command_list::push(command_type type, std::int32_t a, std::int32_t b, std::int32_t c, std::int32_t d) {
+    commands.push_back({type, uniform_type::INT, {a, b, c, d}, {nullptr, nullptr}, 0, 0});
+}
+
+void command_list::push_values(
+    command_type type, uniform_type values_type, const void* data, std::size_t words, std::int32_t a) {
+    auto offset = values.size();
+    values.resize(offset + words);
+    std::memcpy(values.data() + offset, data, words * sizeof(std::uint32_t));
+
+    auto count = std::int32_t(words / value_words(values_type));
+
+    commands.push_back(
+        {type, values_type, {a, count, 0, 0}, {nullptr, nullptr}, std::uint32_t(offset), std::uint32_t(words)});
+}
+
+void command_list::push_bytes(
+    command_type type, const void* data, std::size_t size, std::int32_t b, std::int32_t c) {
+    auto offset = values.size();
+    auto words = data ? (size + sizeof(std::uint32_t) - 1) / sizeof(std::uint32_t) : 0;
+    values.resize(offset + words);
+    if (words > 0) {
+        std::memcpy(values.data() + offset, data, size);
+    }
+
+    commands.push_back({type, uniform_type::INT, {std::int32_t(size), b, c, 0}, {nullptr, nullptr},
+        std::uint32_t(offset), std::uint32_t(words)});
+}
+
+void command_list::push_mesh(const sushi::mesh_group& mesh, const sushi::pose* pose) {
+    commands.push_back({command_type::DRAW_MESH, uniform_type::INT, {pose != nullptr, 0, 0, 0}, {&mesh, pose}, 0, 0});
+}
+
+void command_list::replay(render_backend& backend) const {
+    for (const auto& c : commands) {
+        switch (c.type) {
+            case command_type::USE_PROGRAM:
+                backend.use_program(GLuint(c.args[0]));
+                break;
+            case command_type::UNIFORM:
+                backend.uniform_values(c.args[0], c.values_type, values_of(c), c.args[1]);
+                break;
+            case command_type::BIND_TEXTURE:
+                backend.bind_texture(GLuint(c.args[0]), GLuint(c.args[1]));
+                break;
+            case command_type::SET_ENABLED:
+                backend.set_enabled(GLenum(c.args[0]), c.args[1]);
+                break;
+            case command_type::DEPTH_FUNC:
+                backend.depth_func(GLenum(c.args[0]));
+                break;
+            case command_type::DEPTH_MASK:
+                backend.depth_mask(c.args[0]);
+                break;
+            case command_type::COLOR_MASK:
+                backend.color_mask(c.args[0]);
+                break;
+            case command_type::BLEND_FUNC:
+                backend.blend_func(GLenum(c.args[0]), GLenum(c.args[1]));
+                break;
+            case command_type::SCISSOR:
+                backend.scissor(c.args[0], c.args[1], c.args[2], c.args[3]);
+                break;
+            case command_type::VERTEX_ATTRIB: {
+                auto value = glm::vec4{};
+                std::memcpy(&value[0], values_of(c), sizeof(value));
+                backend.vertex_attrib(GLuint(c.args[0]), value);
+                break;
+            }
+            case command_type::BIND_BUFFER:
+                backend.bind_buffer(GLuint(c.args[0]));
+                break;
+            case command_type::BUFFER_DATA:
+                backend.buffer_data(std::size_t(c.args[0]), c.args[2] ? values_of(c) : nullptr, GLenum(c.args[1]));
+                break;
+            case command_type::BUFFER_SUB_DATA:
+                backend.buffer_sub_data(std::size_t(c.args[1]), std::size_t(c.args[0]), values_of(c));
+                break;
+            case command_type::ATTRIB_ARRAY:
+                backend.set_attrib_array_enabled(GLuint(c.args[0]), c.args[1]);
+                break;
+            case command_type::VERTEX_ATTRIB_POINTER:
+                backend.vertex_attrib_pointer(GLuint(c.args[0]), c.args[1], c.args[2], std::size_t(c.args[3]));
+                break;
+            case command_type::VERTEX_ATTRIB_DIVISOR:
+                backend.vertex_attrib_divisor(GLuint(c.args[0]), GLuint(c.args[1]));
+                break;
+            case command_type::DRAW_ARRAYS:
+                backend.draw_arrays(GLenum(c.args[0]), c.args[1], c.args[2]);
+                break;
+            case command_type::DRAW_ARRAYS_INSTANCED:
+                backend.draw_arrays_instanced(GLenum(c.args[0]), c.args[1], c.args[2], c.args[3]);
+                break;
+            case command_type::DRAW_MESH:
+                backend.draw_mesh(
+                    *static_cast<const sushi::mesh_group*>(c.objects[0]),
+                    static_cast<const sushi::pose*>(c.objects[1]));
+                break;
+        }
+    }
+}
+
+auto command_list::count(command_type type) const -> std::size_t {
+    return std::count_if(commands.begin(), commands.end(), [&](const command& c) { return c.type == type; });
+}
+
+auto command_list::draw_count() const -> std::size_t {
+    return count(command_type::DRAW_ARRAYS) + count(command_type::DRAW_ARRAYS_INSTANCED) +
+        count(command_type::DRAW_MESH);
+}
+
+auto command_list::hash() const -> std::uint64_t {
+    // FNV-1a, over everything but object pointers
+    auto h = std::uint64_t{14695981039346656037ull};
+
+    auto mix = [&](std::uint32_t word) {
+        for (int i = 0; i < 4; ++i) {
+            h ^= (word >> (i * 8)) & 0xff;
+            h *= 1099511628211ull;
+        }
+    };
+
+    for (const auto& c : commands) {
+        mix(std::uint32_t(c.type) | std::uint32_t(c.values_type) << 8);
+        for (auto arg : c.args) {
+            mix(std::uint32_t(arg));
+        }
+        auto v = values_of(c);
+        for (std::uint32_t i = 0; i < c.values_count; ++i) {
+            mix(v[i]);
+        }
+    }
+
+    return h;
+}
+
+auto command_list::mismatch(const command_list& other) const -> std::optional<std::size_t> {
+    auto n = std::min(size(), other.size());
+
+    for (std::size_t i = 0; i < n; ++i) {
+        const auto& a = commands[i];
+        const auto& b = other.commands[i];
+
+        auto same = a.type == b.type && a.values_type == b.values_type &&
+            std::equal(std::begin(a.args), std::end(a.args), std::begin(b.args)) &&
+            a.values_count == b.values_count &&
+            std::equal(values_of(a), values_of(a) + a.values_count, other.values_of(b));
+
+        if (!same) {
+            return i;
+        }
+    }
+
+    if (size() != other.size()) {
+        return n;
+    }
+
+    return std::nullopt;
+}
+
+void command_list::print(std::ostream& out) const {
+    for (std::size_t i = 0; i < commands.size(); ++i) {
+        print(out, i);
+        out << '\n';
+    }
+}
+
+void command_list::print(std::ostream& out, std::size_t index) const {
+    const auto& c = commands[index];
+
+    out << to_string(c.type);
+
+    for (int i = 0; i < arg_count(c.type); ++i) {
+        out << ' ' << c.args[i];
+    }
+
+    // Buffer contents only take part in hashes and comparisons, a line per vertex would not be diffable
+    if (c.type == command_type::BUFFER_DATA || c.type == command_type::BUFFER_SUB_DATA) {
+        return;
+    }
+
+    if (c.values_count > 0) {
+        out << ' ' << uniform_type_name(c.values_type);
+
+        auto v = values_of(c);
+        for (std::uint32_t i = 0; i < c.values_count; ++i) {
+            if (c.values_type == uniform_type::INT) {
+                out << ' ' << std::int32_t(v[i]);
+            } else {
+                auto f = 0.f;
+                std::memcpy(&f, &v[i], sizeof(f));
+                out << ' ' << f;
+            }
+        }
+    }
+}
+
+void command_list::clear() {
+    commands.clear();
+    values.clear();
+}
+
+auto command_list::values_of(const command& c) const -> const std::uint32_t* {
+    return values.data() + c.values_offset;
+}
+
+void recording_render_backend::use_program(GLuint program) {
+    commands.push(command_type::USE_PROGRAM, std::int32_t(program));
+    if (forward) {
+        forward->use_program(program);
+    }
+}
+
+void recording_render_backend::uniform_values(GLint location, uniform_type type, const void* values, GLsizei count) {
+    commands.push_values(command_type::UNIFORM, type, values, value_words(type) * count, location);
+    if (forward) {
+        forward->uniform_values(location, type, values, count);
+    }
+}
+
+void recording_render_backend::bind_texture(GLuint unit, GLuint texture) {
+    commands.push(command_type::BIND_TEXTURE, std::int32_t(unit), std::int32_t(texture));
+    if (forward) {
+        forward->bind_texture(unit, texture);
+    }
+}
+
+void recording_render_backend::set_enabled(GLenum capability, bool enabled) {
+    commands.push(command_type::SET_ENABLED, std::int32_t(capability), enabled);
+    if (forward) {
+        forward->set_enabled(capability, enabled);
+    }
+}
+
+void recording_render_backend::depth_func(GLenum func) {
+    commands.push(command_type::DEPTH_FUNC, std::int32_t(func));
+    if (forward) {
+        forward->depth_func(func);
+    }
+}
+
+void recording_render_backend::depth_mask(bool write) {
+    commands.push(command_type::DEPTH_MASK, write);
+    if (forward) {
+        forward->depth_mask(write);
+    }
+}
+
+void recording_render_backend::color_mask(bool write) {
+    commands.push(command_type::COLOR_MASK, write);
+    if (forward) {
+        forward->color_mask(write);
+    }
+}
+
+void recording_render_backend::blend_func(GLenum src, GLenum dst) {
+    commands.push(command_type::BLEND_FUNC, std::int32_t(src), std::int32_t(dst));
+    if (forward) {
+        forward->blend_func(src, dst);
+    }
+}
+
+void recording_render_backend::scissor(GLint x, GLint y, GLsizei width, GLsizei height) {
+    commands.push(command_type::SCISSOR, x, y, width, height);
+    if (forward) {
+        forward->scissor(x, y, width, height);
+    }
+}
+
+void recording_render_backend::vertex_attrib(GLuint location, const glm::vec4& value) {
+    commands.push_values(command_type::VERTEX_ATTRIB, uniform_type::VEC4, &value[0], 4, std::int32_t(location));
+    if (forward) {
+        forward->vertex_attrib(location, value);
+    }
+}
+
+void recording_render_backend::bind_buffer(GLuint buffer) {
+    commands.push(command_type::BIND_BUFFER, std::int32_t(buffer));
+    if (forward) {
+        forward->bind_buffer(buffer);
+    }
+}
+
+void recording_render_backend::buffer_data(std::size_t size, const void* data, GLenum usage) {
+    commands.push_bytes(command_type::BUFFER_DATA, data, size, std::int32_t(usage), data != nullptr);
+    if (forward) {
+        forward->buffer_data(size, data, usage);
+    }
+}
+
+void recording_render_backend::buffer_sub_data(std::size_t offset, std::size_t size, const void* data) {
+    commands.push_bytes(command_type::BUFFER_SUB_DATA, data, size, std::int32_t(offset));
+    if (forward) {
+        forward->buffer_sub_data(offset, size, data);
+    }
+}
+
+void recording_render_backend::set_attrib_array_enabled(GLuint location, bool enabled) {
+    commands.push(command_type::ATTRIB_ARRAY, std::int32_t(location), enabled);
+    if (forward) {
+        forward->set_attrib_array_enabled(location, enabled);
+    }
+}
+
+void recording_render_backend::vertex_attrib_pointer(GLuint location, GLint components, GLsizei stride, std::size_t offset) {
+    commands.push(command_type::VERTEX_ATTRIB_POINTER, std::int32_t(location), components, stride, std::int32_t(offset));
+    if (forward) {
+        forward->vertex_attrib_pointer(location, components, stride, offset);
+    }
+}
+
+void recording_render_backend::vertex_attrib_divisor(GLuint location, GLuint divisor) {
+    commands.push(command_type::VERTEX_ATTRIB_DIVISOR, std::int32_t(location), std::int32_t(divisor));
+    if (forward) {
+        forward->vertex_attrib_divisor(location, divisor);
+    }
+}
+
+void recording_render_backend::draw_arrays(GLenum mode, GLint first, GLsizei count) {
+    commands.push(command_type::DRAW_ARRAYS, std::int32_t(mode), first, count);
+    if (forward) {
+        forward->draw_arrays(mode, first, count);
+    }
+}
+
+void recording_render_backend::draw_arrays_instanced(GLenum mode, GLint first, GLsizei count, GLsizei instances) {
+    commands.push(command_type::DRAW_ARRAYS_INSTANCED, std::int32_t(mode), first, count, instances);
+    if (forward) {
+        forward->draw_arrays_instanced(mode, first, count, instances);
+    }
+}
+
+void recording_render_backend::draw_mesh(const sushi::mesh_group& mesh, const sushi::pose* pose) {
+    commands.push_mesh(mesh, pose);
+    if (forward) {
+        forward->draw_mesh(mesh, pose);
+    }
+}
+
+auto get_render_backend() -> render_backend& {
+    return *current_backend;
+}
+
+void set_render_backend(render_backend* backend) {
+    current_backend = backend ? backend : &default_backend;
+    gl_state::invalidate();
+}
+
+auto to_string(command_type type) -> const char* {
+    switch (type) {
+        case command_type::USE_PROGRAM: return "USE_PROGRAM";
+        case command_type::UNIFORM: return "UNIFORM";
+        case command_type::BIND_TEXTURE: return "BIND_TEXTURE";
+        case command_type::SET_ENABLED: return "SET_ENABLED";
+        case command_type::DEPTH_FUNC: return "DEPTH_FUNC";
+        case command_type::DEPTH_MASK: return "DEPTH_MASK";
+        case command_type::COLOR_MASK: return "COLOR_MASK";
+        case command_type::BLEND_FUNC: return "BLEND_FUNC";
+        case command_type::SCISSOR: return "SCISSOR";
+        case command_type::VERTEX_ATTRIB: return "VERTEX_ATTRIB";
+        case command_type::BIND_BUFFER: return "BIND_BUFFER";
+        case command_type::BUFFER_DATA: return "BUFFER_DATA";
+        case command_type::BUFFER_SUB_DATA: return "BUFFER_SUB_DATA";
+        case command_type::ATTRIB_ARRAY: return "ATTRIB_ARRAY";
+        case command_type::VERTEX_ATTRIB_POINTER: return "VERTEX_ATTRIB_POINTER";
+        case command_type::VERTEX_ATTRIB_DIVISOR: return "VERTEX_ATTRIB_DIVISOR";
+        case command_type::DRAW_ARRAYS: return "DRAW_ARRAYS";
+        case command_type::DRAW_ARRAYS_INSTANCED: return "DRAW_ARRAYS_INSTANCED";
+        case command_type::DRAW_MESH: return "DRAW_MESH";
+    }
+    return "?";
+}
+
+} // namespace ember
@@ -0,0 +1,265 @@
+#pragma once
+
+#include <sushi/sushi.hpp>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <optional>
+#include <vector>
+
+namespace ember {
+
+enum class uniform_type : std::uint8_t {
+    INT,
+    FLOAT,
+    VEC2,
+    VEC3,
+    VEC4,
+    MAT3,
+    MAT4,
+};
+
+/**
+ * Destination of the render commands issued each frame: program, uniform, texture and fixed function state changes,
+ * streamed buffer uploads, vertex attribute setup, and draws. Renderers issue these through get_render_backend()
+ * instead of calling GL, so a frame can be recorded, counted or discarded. Creating buffers, textures and programs, and
+ * uploading data at load time, still go to GL directly.
+ */
+class render_backend {
+public:
+    virtual ~render_backend() = default;
+
+    virtual void use_program(GLuint program) = 0;
+
+    /** Values are GLint for INT and floats otherwise, count is the array length */
+    virtual void uniform_values(GLint location, uniform_type type, const void* values, GLsizei count) = 0;
+
+    virtual void bind_texture(GLuint unit, GLuint texture) = 0;
+
+    virtual void set_enabled(GLenum capability, bool enabled) = 0;
+
+    virtual void depth_func(GLenum func) = 0;
+
+    virtual void depth_mask(bool write) = 0;
+
+    virtual void color_mask(bool write) = 0;
+
+    virtual void blend_func(GLenum src, GLenum dst) = 0;
+
+    /** Window space, origin at the bottom left */
+    virtual void scissor(GLint x, GLint y, GLsizei width, GLsizei height) = 0;
+
+    /** Constant value of a disabled vertex attribute array */
+    virtual void vertex_attrib(GLuint location, const glm::vec4& value) = 0;
+
+    /** Binds GL_ARRAY_BUFFER, 0 unbinds */
+    virtual void bind_buffer(GLuint buffer) = 0;
+
+    /** Replaces the bound buffer's storage, data may be null to only allocate it */
+    virtual void buffer_data(std::size_t size, const void* data, GLenum usage) = 0;
+
+    virtual void buffer_sub_data(std::size_t offset, std::size_t size, const void* data) = 0;
+
+    virtual void set_attrib_array_enabled(GLuint location, bool enabled) = 0;
+
+    /** Float attribute read from the bound buffer, offset in bytes */
+    virtual void vertex_attrib_pointer(GLuint location, GLint components, GLsizei stride, std::size_t offset) = 0;
+
+    /** Number of instances drawn before the attribute advances, 0 to advance per vertex */
+    virtual void vertex_attrib_divisor(GLuint location, GLuint divisor) = 0;
+
+    virtual void draw_arrays(GLenum mode, GLint first, GLsizei count) = 0;
+
+    virtual void draw_arrays_instanced(GLenum mode, GLint first, GLsizei count, GLsizei instances) = 0;
+
+    /** Pose may be null for unanimated meshes */
+    virtual void draw_mesh(const sushi::mesh_group& mesh, const sushi::pose* pose) = 0;
+
+    void uniform(GLint location, GLint value) { uniform_values(location, uniform_type::INT, &value, 1); }
+    void uniform(GLint location, float value) { uniform_values(location, uniform_type::FLOAT, &value, 1); }
+    void uniform(GLint location, const glm::vec2& v) { uniform_values(location, uniform_type::VEC2, &v[0], 1); }
+    void uniform(GLint location, const glm::vec3& v) { uniform_values(location, uniform_type::VEC3, &v[0], 1); }
+    void uniform(GLint location, const glm::vec4& v) { uniform_values(location, uniform_type::VEC4, &v[0], 1); }
+    void uniform(GLint location, const glm::mat3& m) { uniform_values(location, uniform_type::MAT3, &m[0][0], 1); }
+    void uniform(GLint location, const glm::mat4& m) { uniform_values(location, uniform_type::MAT4, &m[0][0], 1); }
+
+    void uniform(GLint location, const glm::mat4* ms, std::size_t n) {
+        uniform_values(location, uniform_type::MAT4, &ms[0][0][0], GLsizei(n));
+    }
+};
+
+/** Issues commands to the current GL context */
+class gl_render_backend : public render_backend {
+public:
+    void use_program(GLuint program) override;
+    void uniform_values(GLint location, uniform_type type, const void* values, GLsizei count) override;
+    void bind_texture(GLuint unit, GLuint texture) override;
+    void set_enabled(GLenum capability, bool enabled) override;
+    void depth_func(GLenum func) override;
+    void depth_mask(bool write) override;
+    void color_mask(bool write) override;
+    void blend_func(GLenum src, GLenum dst) override;
+    void scissor(GLint x, GLint y, GLsizei width, GLsizei height) override;
+    void vertex_attrib(GLuint location, const glm::vec4& value) override;
+    void bind_buffer(GLuint buffer) override;
+    void buffer_data(std::size_t size, const void* data, GLenum usage) override;
+    void buffer_sub_data(std::size_t offset, std::size_t size, const void* data) override;
+    void set_attrib_array_enabled(GLuint location, bool enabled) override;
+    void vertex_attrib_pointer(GLuint location, GLint components, GLsizei stride, std::size_t offset) override;
+    void vertex_attrib_divisor(GLuint location, GLuint divisor) override;
+    void draw_arrays(GLenum mode, GLint first, GLsizei count) override;
+    void draw_arrays_instanced(GLenum mode, GLint first, GLsizei count, GLsizei instances) override;
+    void draw_mesh(const sushi::mesh_group& mesh, const sushi::pose* pose) override;
+};
+
+/** Discards every command, for measuring the CPU side of rendering */
+class null_render_backend : public render_backend {
+public:
+    void use_program(GLuint) override {}
+    void uniform_values(GLint, uniform_type, const void*, GLsizei) override {}
+    void bind_texture(GLuint, GLuint) override {}
+    void set_enabled(GLenum, bool) override {}
+    void depth_func(GLenum) override {}
+    void depth_mask(bool) override {}
+    void color_mask(bool) override {}
+    void blend_func(GLenum, GLenum) override {}
+    void scissor(GLint, GLint, GLsizei, GLsizei) override {}
+    void vertex_attrib(GLuint, const glm::vec4&) override {}
+    void bind_buffer(GLuint) override {}
+    void buffer_data(std::size_t, const void*, GLenum) override {}
+    void buffer_sub_data(std::size_t, std::size_t, const void*) override {}
+    void set_attrib_array_enabled(GLuint, bool) override {}
+    void vertex_attrib_pointer(GLuint, GLint, GLsizei, std::size_t) override {}
+    void vertex_attrib_divisor(GLuint, GLuint) override {}
+    void draw_arrays(GLenum, GLint, GLsizei) override {}
+    void draw_arrays_instanced(GLenum, GLint, GLsizei, GLsizei) override {}
+    void draw_mesh(const sushi::mesh_group&, const sushi::pose*) override {}
+};
+
+enum class command_type : std::uint8_t {
+    USE_PROGRAM,
+    UNIFORM,
+    BIND_TEXTURE,
+    SET_ENABLED,
+    DEPTH_FUNC,
+    DEPTH_MASK,
+    COLOR_MASK,
+    BLEND_FUNC,
+    SCISSOR,
+    VERTEX_ATTRIB,
+    BIND_BUFFER,
+    BUFFER_DATA,
+    BUFFER_SUB_DATA,
+    ATTRIB_ARRAY,
+    VERTEX_ATTRIB_POINTER,
+    VERTEX_ATTRIB_DIVISOR,
+    DRAW_ARRAYS,
+    DRAW_ARRAYS_INSTANCED,
+    DRAW_MESH,
+};
+
+/**
+ * Recorded render commands, with uniform and attribute values and uploaded buffer contents copied into the list.
+ * Meshes and poses are kept by pointer, they must outlive a replay and are left out of hashes and comparisons since
+ * their addresses change between runs.
+ */
+class command_list {
+public:
+    struct command {
+        command_type type;
+        uniform_type values_type;
+        std::int32_t args[4];
+        const void* objects[2];
+        std::uint32_t values_offset; /** Into values, in 32 bit words */
+        std::uint32_t values_count;
+    };
+
+    void push(command_type type, std::int32_t a = 0, std::int32_t b = 0, std::int32_t c = 0, std::int32_t d = 0);
+
+    void push_values(command_type type, uniform_type values_type, const void* values, std::size_t words, std::int32_t a);
+
+    /** Copies size bytes of data, which may be null, args[0] is set to size */
+    void push_bytes(command_type type, const void* data, std::size_t size, std::int32_t b = 0, std::int32_t c = 0);
+
+    void push_mesh(const sushi::mesh_group& mesh, const sushi::pose* pose);
+
+    /** Issues every command to a backend, in order */
+    void replay(render_backend& backend) const;
+
+    auto size() const -> std::size_t { return commands.size(); }
+
+    auto count(command_type type) const -> std::size_t;
+
+    /** Draw commands of any kind */
+    auto draw_count() const -> std::size_t;
+
+    /** Stable across runs, for comparing against golden captures */
+    auto hash() const -> std::uint64_t;
+
+    /** Index of the first command that differs, or nullopt if the lists match */
+    auto mismatch(const command_list& other) const -> std::optional<std::size_t>;
+
+    /** One command per line, in a diffable text form */
+    void print(std::ostream& out) const;
+
+    void print(std::ostream& out, std::size_t index) const;
+
+    auto get_commands() const -> const std::vector<command>& { return commands; }
+
+    void clear();
+
+private:
+    auto values_of(const command& c) const -> const std::uint32_t*;
+
+    std::vector<command> commands;
+    std::vector<std::uint32_t> values;
+};
+
+/** Records commands into a command list, optionally passing them on to another backend */
+class recording_render_backend : public render_backend {
+public:
+    explicit recording_render_backend(render_backend* forward = nullptr) : forward(forward) {}
+
+    void use_program(GLuint program) override;
+    void uniform_values(GLint location, uniform_type type, const void* values, GLsizei count) override;
+    void bind_texture(GLuint unit, GLuint texture) override;
+    void set_enabled(GLenum capability, bool enabled) override;
+    void depth_func(GLenum func) override;
+    void depth_mask(bool write) override;
+    void color_mask(bool write) override;
+    void blend_func(GLenum src, GLenum dst) override;
+    void scissor(GLint x, GLint y, GLsizei width, GLsizei height) override;
+    void vertex_attrib(GLuint location, const glm::vec4& value) override;
+    void bind_buffer(GLuint buffer) override;
+    void buffer_data(std::size_t size, const void* data, GLenum usage) override;
+    void buffer_sub_data(std::size_t offset, std::size_t size, const void* data) override;
+    void set_attrib_array_enabled(GLuint location, bool enabled) override;
+    void vertex_attrib_pointer(GLuint location, GLint components, GLsizei stride, std::size_t offset) override;
+    void vertex_attrib_divisor(GLuint location, GLuint divisor) override;
+    void draw_arrays(GLenum mode, GLint first, GLsizei count) override;
+    void draw_arrays_instanced(GLenum mode, GLint first, GLsizei count, GLsizei instances) override;
+    void draw_mesh(const sushi::mesh_group& mesh, const sushi::pose* pose) override;
+
+    auto get_commands() const -> const command_list& { return commands; }
+
+    void clear() { commands.clear(); }
+
+private:
+    render_backend* forward;
+    command_list commands;
+};
+
+/** The backend renderers issue commands to, GL unless replaced */
+auto get_render_backend() -> render_backend&;
+
+/**
+ * Replaces the backend, nullptr restores GL. The backend is not owned.
+ * Invalidates the GL state shadow so the new backend receives the full state on the next frame.
+ */
+void set_render_backend(render_backend* backend);
+
+auto to_string(command_type type) -> const char*;
+
+} // namespace ember
@@ -1,7 +1,12 @@
 #include "render_queue.hpp"
 
+#include "gl_state.hpp"
+#include "utility.hpp"
+
 #include <glm/gtc/matrix_inverse.hpp>
 
+#include <cstring>
+
 namespace ember {
 
 /** Prepares the queue */
@@ -10,61 +15,129 @@ void render_queue::prepare(
     basic_shader = &shader;
     proj = proj_matrix;
     view = view_matrix;
-    frustum = {proj * view};
+    forward = -glm::vec3(glm::row(view, 2));
 }
 
-/** Adds an item to the queue if it is within the view frustum */
-void render_queue::add(const item& item) {
-    if (frustum.contains(item.transform.pos, 2)) {
-        queue.push_back(item);
+/** Adds an item to the queue */
+void render_queue::add(item item) {
+    auto index = std::uint32_t(items.size());
+    auto depth = glm::dot(item.transform.pos, forward);
+    auto texture = resource_id(texture_ids, item.texture.get());
+    auto mesh = resource_id(mesh_ids, item.mesh.get());
+
+    entries.push_back({color_key(item.layer, depth, texture, mesh), index});
+
+    if (item.layer == bucket::OPAQUE) {
+        depth_entries.push_back({depth_bits(depth), index});
     }
+
+    items.push_back(std::move(item));
 }
 
 /** Renders all queued items */
 void render_queue::render_items() {
-    auto forward = -glm::vec3(glm::row(view, 2));
+    EMBER_DEFER {
+        items.clear();
+        modelmats.clear();
+        entries.clear();
+        depth_entries.clear();
+        texture_ids.clear();
+        mesh_ids.clear();
+    };
+
+    last_stats = {};
 
-    std::sort(begin(queue), end(queue), [&](const item& a, const item& b) {
-        auto dist_a = glm::dot(a.transform.pos, forward);
-        auto dist_b = glm::dot(b.transform.pos, forward);
+    // Other renderers may have bound their own program since prepare()
+    basic_shader->bind();
 
-        return dist_a > dist_b;
-    });
+    modelmats.reserve(items.size());
 
-    for (const auto& item : queue) {
+    for (const auto& item : items) {
         auto modelmat = to_mat4(item.transform);
 
         if (item.attached_to) {
-            auto& pose = item.attached_to->pose;
+            auto& pose = *item.attached_to->pose;
             auto bone_idx = item.attached_to->bone_idx;
             auto bt = pose.get_bone_transform(bone_idx);
             modelmat = modelmat * bt;
         }
 
+        modelmats.push_back(modelmat);
+    }
+
+    utility::radix_sort(entries, sort_buffer, [](const entry& e) { return e.key; });
+    utility::radix_sort(depth_entries, sort_buffer, [](const entry& e) { return e.key; });
+
+    auto opaque_count = depth_entries.size();
+
+    // Depth pre-pass, front to back so later fragments are rejected early
+    gl_state::color_mask(false);
+    last_stats.depth_draws = draw_entries(depth_entries, 0, opaque_count);
+    gl_state::color_mask(true);
+
+    // Opaque color pass, only the nearest surface of each pixel passes, so the order only needs to group state
+    gl_state::depth_func(GL_EQUAL);
+    gl_state::depth_mask(false);
+    last_stats.opaque_draws = draw_entries(entries, 0, opaque_count);
+
+    // Transparent bucket, back to front and without depth writes so they blend over each other
+    gl_state::depth_func(GL_LEQUAL);
+    last_stats.transparent_draws = draw_entries(entries, opaque_count, entries.size());
+    gl_state::depth_mask(true);
+}
+
+auto render_queue::draw_entries(const std::vector<entry>& order, std::size_t first, std::size_t last) -> int {
+    auto draws = 0;
+
+    for (auto i = first; i < last; ++i) {
+        const auto& item = items[order[i].index];
+        const auto& modelmat = modelmats[order[i].index];
+
         basic_shader->set_tint(item.tint);
         basic_shader->set_normal_mat(glm::inverseTranspose(view * modelmat));
         basic_shader->set_MVP(proj * view * modelmat);
         basic_shader->set_uvmat(glm::mat3(1.f));
 
-        sushi::set_texture(0, *item.texture);
+        // Also bound for the depth pass, the shader discards transparent texels
+        gl_state::bind_texture(0, *item.texture);
+
+        get_render_backend().draw_mesh(*item.mesh, item.pose);
+
+        ++draws;
+    }
+
+    return draws;
+}
+
+auto render_queue::depth_bits(float depth) -> std::uint32_t {
+    // Flip the float bits so that unsigned integer order matches float order, including negatives
+    auto bits = std::uint32_t{};
+    std::memcpy(&bits, &depth, sizeof(bits));
+    bits = (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
 
-        auto draw = [&] {
-            if (item.pose) {
-                sushi::draw_mesh(*item.mesh, *item.pose);
-            } else {
-                sushi::draw_mesh(*item.mesh);
-            }
-        };
+    // The top 24 bits are plenty to order items a few units apart
+    return bits >> 8;
+}
+
+auto render_queue::color_key(bucket layer, float depth, std::uint32_t texture, std::uint32_t mesh) -> sort_key {
+    constexpr auto id_mask = (1u << 19) - 1;
+    constexpr auto depth_mask = (1u << 24) - 1;
 
-        // Depth pre-pass
-        glColorMask(false, false, false, false);
-        draw();
+    auto pass = sort_key(layer) & 0x3;
+    auto tex = sort_key(texture & id_mask);
+    auto msh = sort_key(mesh & id_mask);
 
-        glColorMask(true, true, true, true);
-        draw();
+    if (layer == bucket::OPAQUE) {
+        return (pass << 62) | (tex << 43) | (msh << 24) | sort_key(depth_bits(depth));
+    } else {
+        auto far_first = sort_key(~depth_bits(depth) & depth_mask);
+        return (pass << 62) | (far_first << 38) | (tex << 19) | msh;
     }
+}
 
-    queue.clear();
+auto render_queue::resource_id(std::unordered_map<const void*, std::uint32_t>& ids, const void* ptr)
+    -> std::uint32_t {
+    return ids.try_emplace(ptr, std::uint32_t(ids.size())).first->second;
 }
 
 } // namespace ember
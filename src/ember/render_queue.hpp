@@ -5,25 +5,38 @@
 #include <sushi/sushi.hpp>
 #include <glm/glm.hpp>
 
+#include <cstdint>
 #include <memory>
 #include <optional>
+#include <unordered_map>
 #include <vector>
 
 namespace ember {
 
+/**
+ * Sorts and draws meshes with the basic shader.
+ * Opaque items get a front-to-back depth-only pass, then a color pass with depth-equal testing sorted by state.
+ * Transparent items are drawn afterwards, back to front, without depth writes.
+ */
 class render_queue {
 public:
+    enum class bucket : std::uint8_t {
+        OPAQUE,
+        TRANSPARENT,
+    };
+
     struct item {
         struct attachment {
-            sushi::pose pose;
+            const sushi::pose* pose;
             int bone_idx;
         };
 
         sushi::transform transform;
         glm::vec4 tint = {1, 1, 1, 1};
+        bucket layer = bucket::OPAQUE;
         std::shared_ptr<sushi::mesh_group> mesh;
         std::shared_ptr<sushi::texture_2d> texture;
-        std::optional<sushi::pose> pose;
+        const sushi::pose* pose = nullptr; /** Not owned, usually from a pose_cache, must outlive render_items() */
         std::optional<attachment> attached_to;
     };
 
@@ -33,18 +46,60 @@ public:
         const glm::mat4& proj_matrix,
         const glm::mat4& view_matrix);
 
-    /** Adds an item to the queue if it is within the view frustum */
-    void add(const item& item);
+    /** Adds an item to the queue, items are moved into the queue and never copied. Culling is up to the caller. */
+    void add(item item);
 
     /** Renders all queued items */
     void render_items();
 
+    struct stats {
+        int depth_draws;
+        int opaque_draws;
+        int transparent_draws;
+    };
+
+    /** Draw call counts of the last render_items() */
+    auto get_stats() const -> const stats& { return last_stats; }
+
+    auto size() const -> std::size_t { return items.size(); }
+
 private:
-    std::vector<item> queue;
+    /**
+     * Sort key, most significant field first.
+     * Opaque: bucket (2 bits), texture (19 bits), mesh (19 bits), depth near to far (24 bits).
+     * Transparent: bucket (2 bits), depth far to near (24 bits), texture (19 bits), mesh (19 bits).
+     * Depth pre-pass: depth near to far.
+     */
+    using sort_key = std::uint64_t;
+
+    struct entry {
+        sort_key key;
+        std::uint32_t index; /** Into items */
+    };
+
+    /** 24 bit depth in unsigned integer order, nearest first */
+    static auto depth_bits(float depth) -> std::uint32_t;
+
+    static auto color_key(bucket layer, float depth, std::uint32_t texture, std::uint32_t mesh) -> sort_key;
+
+    /** Draws entries in order, returns the number of draw calls */
+    auto draw_entries(const std::vector<entry>& order, std::size_t first, std::size_t last) -> int;
+
+    /** Small per-frame id for a resource, in first-seen order */
+    static auto resource_id(std::unordered_map<const void*, std::uint32_t>& ids, const void* ptr) -> std::uint32_t;
+
+    std::vector<item> items; /** Arena, cleared each frame but keeps its capacity */
+    std::vector<glm::mat4> modelmats; /** Parallel to items */
+    std::vector<entry> entries;
+    std::vector<entry> depth_entries; /** Opaque items only */
+    std::vector<entry> sort_buffer;
+    std::unordered_map<const void*, std::uint32_t> texture_ids;
+    std::unordered_map<const void*, std::uint32_t> mesh_ids;
     shaders::basic_shader_program* basic_shader;
     glm::mat4 proj;
     glm::mat4 view;
-    sushi::frustum frustum;
+    glm::vec3 forward;
+    stats last_stats = {};
 };
 
 } // namespace ember
@@ -0,0 +1,115 @@
+#include "scheduler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace ember {
+
+void scheduler::add_exclusive_system(std::string name, system_function func) {
+    auto sys = system{};
+    sys.name = std::move(name);
+    sys.exclusive = true;
+    sys.func = std::move(func);
+    add(std::move(sys));
+}
+
+void scheduler::add(system sys) {
+    systems.push_back(std::move(sys));
+    built = false;
+}
+
+void scheduler::build() {
+    stages.clear();
+
+    for (auto& sys : systems) {
+        sys.successors.clear();
+        sys.num_predecessors = 0;
+    }
+
+    for (std::size_t i = 0; i < systems.size(); ++i) {
+        if (systems[i].exclusive) {
+            stages.push_back({i, i + 1, true});
+        } else if (!stages.empty() && !stages.back().exclusive) {
+            stages.back().end = i + 1;
+        } else {
+            stages.push_back({i, i + 1, false});
+        }
+    }
+
+    for (const auto& s : stages) {
+        for (auto j = s.begin; j < s.end; ++j) {
+            for (auto i = s.begin; i < j; ++i) {
+                if (conflicts(systems[i], systems[j])) {
+                    systems[i].successors.push_back(j);
+                    ++systems[j].num_predecessors;
+                }
+            }
+        }
+    }
+
+    built = true;
+}
+
+void scheduler::run(thread_pool& pool, float delta) {
+    if (!built) {
+        build();
+    }
+
+    for (const auto& s : stages) {
+        if (s.exclusive) {
+            systems[s.begin].func(delta);
+        } else {
+            run_stage(pool, s, delta);
+        }
+    }
+}
+
+void scheduler::run_stage(thread_pool& pool, const stage& s, float delta) {
+    if (s.end - s.begin == 1) {
+        systems[s.begin].func(delta);
+        return;
+    }
+
+    auto group = thread_pool::task_group{};
+    auto remaining = std::make_unique<std::atomic<int>[]>(s.end - s.begin);
+
+    for (auto i = s.begin; i < s.end; ++i) {
+        remaining[i - s.begin] = systems[i].num_predecessors;
+    }
+
+    std::function<void(std::size_t)> launch = [&](std::size_t i) {
+        pool.submit(group, [&, i] {
+            systems[i].func(delta);
+            for (auto j : systems[i].successors) {
+                if (--remaining[j - s.begin] == 0) {
+                    launch(j);
+                }
+            }
+        });
+    };
+
+    for (auto i = s.begin; i < s.end; ++i) {
+        if (systems[i].num_predecessors == 0) {
+            launch(i);
+        }
+    }
+
+    pool.wait(group);
+}
+
+bool scheduler::conflicts(const system& a, const system& b) {
+    if (a.exclusive || b.exclusive) {
+        return true;
+    }
+
+    auto overlaps = [](const auto& x, const auto& y) {
+        return std::any_of(begin(x), end(x), [&](auto guid) {
+            return std::find(begin(y), end(y), guid) != end(y);
+        });
+    };
+
+    return overlaps(a.writes, b.writes) || overlaps(a.writes, b.reads) || overlaps(a.reads, b.writes);
+}
+
+} // namespace ember
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "thread_pool.hpp"
+
+#include <ginseng/ginseng.hpp>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace ember {
+
+/** Components a system reads */
+template <typename... Coms>
+struct reads {};
+
+/** Components a system writes */
+template <typename... Coms>
+struct writes {};
+
+/**
+ * Runs a scene's systems, in parallel where their declared component access allows it.
+ * Systems run in registration order unless they do not conflict, in which case they may overlap.
+ * Exclusive systems (Lua, structural changes, anything touching scene state) never overlap with anything,
+ * and always run on the thread that called run().
+ */
+class scheduler {
+public:
+    using system_function = std::function<void(float delta)>;
+
+    /** Adds a system that only touches the listed components */
+    template <typename... Reads, typename... Writes>
+    void add_system(std::string name, reads<Reads...>, writes<Writes...>, system_function func) {
+        auto sys = system{};
+        sys.name = std::move(name);
+        sys.reads = {ginseng::_detail::get_type_guid<Reads>()...};
+        sys.writes = {ginseng::_detail::get_type_guid<Writes>()...};
+        sys.func = std::move(func);
+        add(std::move(sys));
+    }
+
+    /** Adds a system that must run alone */
+    void add_exclusive_system(std::string name, system_function func);
+
+    /** Builds the dependency graph, called by the first run() after adding systems */
+    void build();
+
+    /** Runs every system once */
+    void run(thread_pool& pool, float delta);
+
+private:
+    struct system {
+        std::string name;
+        std::vector<ginseng::_detail::type_guid> reads;
+        std::vector<ginseng::_detail::type_guid> writes;
+        bool exclusive = false;
+        system_function func;
+        std::vector<std::size_t> successors;
+        int num_predecessors = 0;
+    };
+
+    /** Run of consecutive systems, either a single exclusive system or a group of shared ones */
+    struct stage {
+        std::size_t begin;
+        std::size_t end;
+        bool exclusive;
+    };
+
+    void add(system sys);
+
+    void run_stage(thread_pool& pool, const stage& s, float delta);
+
+    static bool conflicts(const system& a, const system& b);
+
+    std::vector<system> systems;
+    std::vector<stage> stages;
+    bool built = false;
+};
+
+} // namespace ember
@@ -2,103 +2,155 @@
 
 namespace ember::shaders {
 
+void program_base::bind() {
+    gl_state::use_program(handle);
+}
+
+void program_base::capture_handle() {
+    sushi::shader_base::bind();
+
+    auto program = GLint{};
+    glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+    handle = GLuint(program);
+
+    // Bound behind the shadow's back
+    gl_state::invalidate_program();
+}
+
 basic_shader_program::basic_shader_program(const std::string& vert, const std::string& frag) :
-    sushi::shader_base({
+    program_base({
         {sushi::shader_type::VERTEX, vert},
         {sushi::shader_type::FRAGMENT, frag},
     })
 {
-    bind();
-
-    uniforms.MVP = get_uniform_location("MVP");
-    uniforms.normal_mat = get_uniform_location("normal_mat");
-    uniforms.uvmat = get_uniform_location("uvmat");
-    uniforms.s_texture = get_uniform_location("s_texture");
-    uniforms.cam_forward = get_uniform_location("cam_forward");
-    uniforms.tint = get_uniform_location("tint");
-    uniforms.hue = get_uniform_location("hue");
-    uniforms.saturation = get_uniform_location("saturation");
+    capture_handle();
+
+    uniforms.MVP.location = get_uniform_location("MVP");
+    uniforms.normal_mat.location = get_uniform_location("normal_mat");
+    uniforms.uvmat.location = get_uniform_location("uvmat");
+    uniforms.s_texture.location = get_uniform_location("s_texture");
+    uniforms.cam_forward.location = get_uniform_location("cam_forward");
+    uniforms.tint.location = get_uniform_location("tint");
+    uniforms.hue.location = get_uniform_location("hue");
+    uniforms.saturation.location = get_uniform_location("saturation");
     uniforms.animated = get_uniform_location("Animated");
     uniforms.bones = get_uniform_location("Bones");
 }
 
 void basic_shader_program::set_MVP(const glm::mat4& mat) {
-    sushi::set_current_program_uniform(uniforms.MVP, mat);
+    uniforms.MVP.set(mat);
 }
 
 void basic_shader_program::set_normal_mat(const glm::mat4& mat) {
-    sushi::set_current_program_uniform(uniforms.normal_mat, mat);
+    uniforms.normal_mat.set(mat);
 }
 
 void basic_shader_program::set_uvmat(const glm::mat3& mat) {
-    sushi::set_current_program_uniform(uniforms.uvmat, mat);
+    uniforms.uvmat.set(mat);
 }
 
 void basic_shader_program::set_s_texture(GLint i) {
-    sushi::set_current_program_uniform(uniforms.s_texture, i);
+    uniforms.s_texture.set(i);
 }
 
 void basic_shader_program::set_cam_forward(const glm::vec3& vec) {
-    sushi::set_current_program_uniform(uniforms.cam_forward, vec);
+    uniforms.cam_forward.set(vec);
 }
 
 void basic_shader_program::set_tint(const glm::vec4& v) {
-    sushi::set_current_program_uniform(uniforms.tint, v);
+    uniforms.tint.set(v);
 }
 
 void basic_shader_program::set_hue(float f) {
-    sushi::set_current_program_uniform(uniforms.hue, f);
+    uniforms.hue.set(f);
 }
 
 void basic_shader_program::set_saturation(float f) {
-    sushi::set_current_program_uniform(uniforms.saturation, f);
+    uniforms.saturation.set(f);
 }
 
 void basic_shader_program::set_animated(bool b) {
-    sushi::set_current_program_uniform(uniforms.animated, int(b));
+    get_render_backend().uniform(uniforms.animated, GLint(b));
 }
 
 void basic_shader_program::set_bones(const glm::mat4* ms, std::size_t n) {
-    sushi::set_current_program_uniform(uniforms.bones, ms, n);
+    get_render_backend().uniform(uniforms.bones, ms, n);
 }
 
-msdf_shader_program::msdf_shader_program(const std::string& vertfile, const std::string& fragfile) :
-    sushi::shader_base({
-        {sushi::shader_type::VERTEX, vertfile},
-        {sushi::shader_type::FRAGMENT, fragfile}
+instanced_shader_program::instanced_shader_program(const std::string& vert, const std::string& frag) :
+    program_base({
+        {sushi::shader_type::VERTEX, vert},
+        {sushi::shader_type::FRAGMENT, frag},
     })
 {
-    bind();
-    uniforms.MVP = get_uniform_location("MVP");
-    uniforms.normal_mat = get_uniform_location("normal_mat");
-    uniforms.msdf = get_uniform_location("msdf");
-    uniforms.pxRange = get_uniform_location("pxRange");
-    uniforms.texSize = get_uniform_location("texSize");
-    uniforms.fgColor = get_uniform_location("fgColor");
+    capture_handle();
+
+    uniforms.ViewProj.location = get_uniform_location("ViewProj");
+    uniforms.View.location = get_uniform_location("View");
+    uniforms.s_texture.location = get_uniform_location("s_texture");
+    uniforms.cam_forward.location = get_uniform_location("cam_forward");
+    uniforms.hue.location = get_uniform_location("hue");
+    uniforms.saturation.location = get_uniform_location("saturation");
+
+    // Instance attributes are not part of sushi's vertex layout, so their locations are assigned by the linker
+    auto program = GLint{};
+    glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+
+    attribs.model[0] = glGetAttribLocation(program, "InstanceModel0");
+    attribs.model[1] = glGetAttribLocation(program, "InstanceModel1");
+    attribs.model[2] = glGetAttribLocation(program, "InstanceModel2");
+    attribs.model[3] = glGetAttribLocation(program, "InstanceModel3");
+    attribs.tint = glGetAttribLocation(program, "InstanceTint");
+}
+
+void instanced_shader_program::set_ViewProj(const glm::mat4& mat) {
+    uniforms.ViewProj.set(mat);
+}
+
+void instanced_shader_program::set_View(const glm::mat4& mat) {
+    uniforms.View.set(mat);
 }
 
-void msdf_shader_program::set_MVP(const glm::mat4& mat) {
-    sushi::set_current_program_uniform(uniforms.MVP, mat);
+void instanced_shader_program::set_s_texture(GLint i) {
+    uniforms.s_texture.set(i);
 }
 
-void msdf_shader_program::set_normal_mat(const glm::mat4& mat) {
-    sushi::set_current_program_uniform(uniforms.normal_mat, mat);
+void instanced_shader_program::set_cam_forward(const glm::vec3& vec) {
+    uniforms.cam_forward.set(vec);
 }
 
-void msdf_shader_program::set_msdf(int slot) {
-    sushi::set_current_program_uniform(uniforms.msdf, slot);
+void instanced_shader_program::set_hue(float f) {
+    uniforms.hue.set(f);
 }
 
-void msdf_shader_program::set_pxRange(float f) {
-    sushi::set_current_program_uniform(uniforms.pxRange, f);
+void instanced_shader_program::set_saturation(float f) {
+    uniforms.saturation.set(f);
+}
+
+gui_shader_program::gui_shader_program(const std::string& vert, const std::string& frag) :
+    program_base({
+        {sushi::shader_type::VERTEX, vert},
+        {sushi::shader_type::FRAGMENT, frag},
+    })
+{
+    capture_handle();
+
+    uniforms.MVP.location = get_uniform_location("MVP");
+    uniforms.s_texture.location = get_uniform_location("s_texture");
+
+    auto program = GLint{};
+    glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+
+    attribs.color = glGetAttribLocation(program, "VertexColor");
+    attribs.msdf_unit = glGetAttribLocation(program, "VertexMsdfUnit");
 }
 
-void msdf_shader_program::set_texSize(const glm::vec2& vec) {
-    sushi::set_current_program_uniform(uniforms.texSize, vec);
+void gui_shader_program::set_MVP(const glm::mat4& mat) {
+    uniforms.MVP.set(mat);
 }
 
-void msdf_shader_program::set_fgColor(const glm::vec4& vec) {
-    sushi::set_current_program_uniform(uniforms.fgColor, vec);
+void gui_shader_program::set_s_texture(GLint i) {
+    uniforms.s_texture.set(i);
 }
 
 } // namespace ember::shaders
@@ -1,10 +1,27 @@
 #pragma once
 
+#include "gl_state.hpp"
+
 #include <sushi/sushi.hpp>
 
 namespace ember::shaders {
 
-class basic_shader_program : public sushi::shader_base {
+/** Shader program bound through the GL state shadow, so binding the current program again is free */
+class program_base : public sushi::shader_base {
+public:
+    using sushi::shader_base::shader_base;
+
+    void bind();
+
+protected:
+    /** Binds the program directly and records its GL name, call once after linking */
+    void capture_handle();
+
+private:
+    GLuint handle = 0;
+};
+
+class basic_shader_program : public program_base {
 public:
     basic_shader_program() = default;
 
@@ -23,41 +40,79 @@ public:
 
 private:
     struct {
-        GLint MVP;
-        GLint normal_mat;
-        GLint uvmat;
-        GLint s_texture;
-        GLint cam_forward;
-        GLint tint;
-        GLint hue;
-        GLint saturation;
-        GLint animated;
+        gl_state::uniform<glm::mat4> MVP;
+        gl_state::uniform<glm::mat4> normal_mat;
+        gl_state::uniform<glm::mat3> uvmat;
+        gl_state::uniform<GLint> s_texture;
+        gl_state::uniform<glm::vec3> cam_forward;
+        gl_state::uniform<glm::vec4> tint;
+        gl_state::uniform<float> hue;
+        gl_state::uniform<float> saturation;
+        GLint animated; /** Not cached, sushi::draw_mesh sets the skinning uniforms itself */
         GLint bones;
     } uniforms;
 };
 
-class msdf_shader_program : public sushi::shader_base {
+/** Basic shader variant taking the model matrix and tint as per-instance vertex attributes */
+class instanced_shader_program : public program_base {
 public:
-    msdf_shader_program() = default;
+    /** Attribute locations of the per-instance streams, one per model matrix column */
+    struct instance_attribs {
+        GLint model[4];
+        GLint tint;
+    };
+
+    instanced_shader_program() = default;
+
+    instanced_shader_program(const std::string& vert, const std::string& frag);
 
-    msdf_shader_program(const std::string& vertfile, const std::string& fragfile);
+    void set_ViewProj(const glm::mat4& mat);
+    void set_View(const glm::mat4& mat);
+    void set_s_texture(GLint i);
+    void set_cam_forward(const glm::vec3& vec);
+    void set_hue(float f);
+    void set_saturation(float f);
+
+    auto get_instance_attribs() const -> const instance_attribs& { return attribs; }
+
+private:
+    struct {
+        gl_state::uniform<glm::mat4> ViewProj;
+        gl_state::uniform<glm::mat4> View;
+        gl_state::uniform<GLint> s_texture;
+        gl_state::uniform<glm::vec3> cam_forward;
+        gl_state::uniform<float> hue;
+        gl_state::uniform<float> saturation;
+    } uniforms;
+
+    instance_attribs attribs;
+};
+
+/** GUI quads and MSDF glyphs, color and glyph scale are per-vertex attributes so a frame batches into few draws */
+class gui_shader_program : public program_base {
+public:
+    /** Attribute locations beyond sushi's vertex layout */
+    struct vertex_attribs {
+        GLint color;
+        GLint msdf_unit;
+    };
+
+    gui_shader_program() = default;
+
+    gui_shader_program(const std::string& vert, const std::string& frag);
 
     void set_MVP(const glm::mat4& mat);
-    void set_normal_mat(const glm::mat4& mat);
-    void set_msdf(int slot);
-    void set_pxRange(float f);
-    void set_texSize(const glm::vec2& vec);
-    void set_fgColor(const glm::vec4& vec);
+    void set_s_texture(GLint i);
+
+    auto get_vertex_attribs() const -> const vertex_attribs& { return attribs; }
 
 private:
     struct {
-        GLint MVP;
-        GLint normal_mat;
-        GLint msdf;
-        GLint pxRange;
-        GLint texSize;
-        GLint fgColor;
+        gl_state::uniform<glm::mat4> MVP;
+        gl_state::uniform<GLint> s_texture;
     } uniforms;
+
+    vertex_attribs attribs;
 };
 
 } // namespace ember::shaders
@@ -0,0 +1,38 @@
+#include "snapshot.hpp"
+
+namespace ember::snapshot {
+
+void writer::write_bytes(const void* data, std::size_t size) {
+    auto pos = buffer.size();
+    buffer.resize(pos + size);
+    if (size > 0) {
+        std::memcpy(buffer.data() + pos, data, size);
+    }
+}
+
+void reader::read_bytes(void* out, std::size_t size) {
+    if (size > data.size() - pos) {
+        throw std::runtime_error("snapshot: unexpected end of data");
+    }
+    if (size > 0) {
+        std::memcpy(out, data.data() + pos, size);
+    }
+    pos += size;
+}
+
+auto reader::read_count(std::size_t min_size) -> std::size_t {
+    auto count = std::size_t{read_raw<std::uint32_t>()};
+    if (count * std::max(min_size, std::size_t{1}) > data.size() - pos) {
+        throw std::runtime_error("snapshot: count exceeds remaining data");
+    }
+    return count;
+}
+
+void reader::skip(std::size_t size) {
+    if (size > data.size() - pos) {
+        throw std::runtime_error("snapshot: unexpected end of data");
+    }
+    pos += size;
+}
+
+} // namespace ember::snapshot
@@ -0,0 +1,440 @@
+#pragma once
+
+#include "atom.hpp"
+#include "entities.hpp"
+#include "net_id.hpp"
+#include "reflection.hpp"
+#include "utility.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Binary world snapshots.
+ *
+ * Layout:
+ *   header:   magic "EMBS", u32 version, i64 next net_id
+ *   entities: u32 count, i64 net_id[count]
+ *   sections: u32 count, then per component type:
+ *             string type name, u64 byte size, u32 count, u32 row[count], u8 raw, payload
+ *
+ * Rows index the entity table. Trivially copyable components without atoms are stored raw as a contiguous array,
+ * everything else is written member by member using its REFLECT list.
+ * Pointers are stored as-is, so snapshots containing them are only valid within the same process.
+ */
+namespace ember::snapshot {
+
+class writer {
+public:
+    void write_bytes(const void* data, std::size_t size);
+
+    template <typename T>
+    void write_raw(const T& value) {
+        write_bytes(&value, sizeof(T));
+    }
+
+    /** Reserves space for a value to be filled in by patch_raw() */
+    template <typename T>
+    auto reserve_raw() -> std::size_t {
+        auto pos = buffer.size();
+        buffer.resize(pos + sizeof(T));
+        return pos;
+    }
+
+    template <typename T>
+    void patch_raw(std::size_t pos, const T& value) {
+        std::memcpy(buffer.data() + pos, &value, sizeof(T));
+    }
+
+    auto size() const -> std::size_t { return buffer.size(); }
+
+    auto release() -> std::vector<char> { return std::move(buffer); }
+
+private:
+    std::vector<char> buffer;
+};
+
+class reader {
+public:
+    explicit reader(utility::span<const char> data) : data(data) {}
+
+    void read_bytes(void* out, std::size_t size);
+
+    void skip(std::size_t size);
+
+    template <typename T>
+    auto read_raw() -> T {
+        auto value = T{};
+        read_bytes(&value, sizeof(T));
+        return value;
+    }
+
+    /** Reads a u32 element count, throws if that many elements of at least min_size bytes cannot fit in the data */
+    auto read_count(std::size_t min_size) -> std::size_t;
+
+    auto position() const -> std::size_t { return pos; }
+
+    auto remaining() const -> std::size_t { return data.size() - pos; }
+
+private:
+    utility::span<const char> data;
+    std::size_t pos = 0;
+};
+
+constexpr char magic[4] = {'E', 'M', 'B', 'S'};
+constexpr std::uint32_t version = 1;
+
+namespace _detail {
+
+template <typename T>
+struct is_vector : std::false_type {};
+
+template <typename T, typename A>
+struct is_vector<std::vector<T, A>> : std::true_type {};
+
+template <typename T>
+struct is_optional : std::false_type {};
+
+template <typename T>
+struct is_optional<std::optional<T>> : std::true_type {};
+
+template <typename M>
+struct member_type;
+
+template <typename C, typename M>
+struct member_type<M C::*> {
+    using type = M;
+};
+
+template <typename T>
+constexpr bool is_raw();
+
+template <typename Info>
+struct raw_members;
+
+template <typename T, auto... Ps>
+struct raw_members<reflection::refl_info<T, Ps...>> {
+    static constexpr bool value = (is_raw<typename member_type<decltype(Ps)>::type>() && ...);
+};
+
+/** True if values can be copied as bytes, which excludes atoms since they are pointers into the atom table */
+template <typename T>
+constexpr bool is_raw() {
+    if constexpr (std::is_same_v<T, atom> || !std::is_trivially_copyable_v<T>) {
+        return false;
+    } else if constexpr (reflection::refl_traits<T>::is_reflectable) {
+        return raw_members<decltype(reflect<T>())>::value;
+    } else {
+        return true;
+    }
+}
+
+template <typename T>
+constexpr std::size_t min_size();
+
+template <typename Info>
+struct min_members_size;
+
+template <typename T, auto... Ps>
+struct min_members_size<reflection::refl_info<T, Ps...>> {
+    static constexpr std::size_t value = (std::size_t{0} + ... + min_size<typename member_type<decltype(Ps)>::type>());
+};
+
+/** Fewest bytes a value can be written as, used to reject counts the remaining data cannot hold */
+template <typename T>
+constexpr std::size_t min_size() {
+    if constexpr (std::is_same_v<T, atom>) {
+        return sizeof(std::uint32_t);
+    } else if constexpr (is_raw<T>()) {
+        return sizeof(T);
+    } else if constexpr (std::is_same_v<T, std::string> || is_vector<T>::value) {
+        return sizeof(std::uint32_t);
+    } else if constexpr (is_optional<T>::value) {
+        return sizeof(std::uint8_t);
+    } else if constexpr (reflection::refl_traits<T>::is_reflectable) {
+        return min_members_size<decltype(reflect<T>())>::value;
+    } else {
+        return 0;
+    }
+}
+
+template <typename T>
+void write_value(writer& w, const T& value);
+
+template <typename T>
+void read_value(reader& r, T& value);
+
+inline void write_string(writer& w, const std::string& str) {
+    w.write_raw(std::uint32_t(str.size()));
+    w.write_bytes(str.data(), str.size());
+}
+
+inline auto read_string(reader& r) -> std::string {
+    auto str = std::string(r.read_count(1), '\0');
+    r.read_bytes(str.data(), str.size());
+    return str;
+}
+
+template <typename T>
+void write_value(writer& w, const T& value) {
+    if constexpr (std::is_same_v<T, atom>) {
+        write_string(w, value.str());
+    } else if constexpr (is_raw<T>()) {
+        w.write_raw(value);
+    } else if constexpr (std::is_same_v<T, std::string>) {
+        write_string(w, value);
+    } else if constexpr (is_vector<T>::value) {
+        using value_type = typename T::value_type;
+        w.write_raw(std::uint32_t(value.size()));
+        if constexpr (is_raw<value_type>()) {
+            w.write_bytes(value.data(), value.size() * sizeof(value_type));
+        } else {
+            for (const auto& v : value) {
+                write_value(w, v);
+            }
+        }
+    } else if constexpr (is_optional<T>::value) {
+        w.write_raw(std::uint8_t(value.has_value()));
+        if (value) {
+            write_value(w, *value);
+        }
+    } else if constexpr (reflection::refl_traits<T>::is_reflectable) {
+        std::apply([&](const auto&... members) { (write_value(w, value.*members.ptr()), ...); }, reflect<T>().members);
+    } else {
+        static_assert(reflection::refl_traits<T>::is_reflectable, "snapshot: type is not serializable");
+    }
+}
+
+template <typename T>
+void read_value(reader& r, T& value) {
+    if constexpr (std::is_same_v<T, atom>) {
+        value = atom(read_string(r));
+    } else if constexpr (is_raw<T>()) {
+        r.read_bytes(&value, sizeof(T));
+    } else if constexpr (std::is_same_v<T, std::string>) {
+        value = read_string(r);
+    } else if constexpr (is_vector<T>::value) {
+        using value_type = typename T::value_type;
+        value.resize(r.read_count(min_size<value_type>()));
+        if constexpr (is_raw<value_type>()) {
+            r.read_bytes(value.data(), value.size() * sizeof(value_type));
+        } else {
+            for (auto& v : value) {
+                read_value(r, v);
+            }
+        }
+    } else if constexpr (is_optional<T>::value) {
+        if (r.read_raw<std::uint8_t>()) {
+            value.emplace();
+            read_value(r, *value);
+        } else {
+            value = std::nullopt;
+        }
+    } else if constexpr (reflection::refl_traits<T>::is_reflectable) {
+        std::apply([&](const auto&... members) { (read_value(r, value.*members.ptr()), ...); }, reflect<T>().members);
+    } else {
+        static_assert(reflection::refl_traits<T>::is_reflectable, "snapshot: type is not serializable");
+    }
+}
+
+template <typename Com>
+void write_section(writer& w, database& db, const std::vector<std::uint32_t>& rows_by_index) {
+    auto rows = std::vector<std::uint32_t>{};
+    auto coms = std::vector<const Com*>{};
+
+    rows.reserve(db.count_components<Com>());
+    coms.reserve(db.count_components<Com>());
+
+    db.visit([&](database::ent_id eid, const net_id&, const Com& com) {
+        rows.push_back(rows_by_index[eid.get_index()]);
+        coms.push_back(&com);
+    });
+
+    write_string(w, reflect<Com>().name);
+
+    auto size_pos = w.reserve_raw<std::uint64_t>();
+    auto begin = w.size();
+
+    w.write_raw(std::uint32_t(rows.size()));
+    w.write_bytes(rows.data(), rows.size() * sizeof(std::uint32_t));
+
+    if constexpr (is_raw<Com>()) {
+        w.write_raw(std::uint8_t(1));
+        auto contiguous = std::vector<Com>{};
+        contiguous.reserve(coms.size());
+        for (auto com : coms) {
+            contiguous.push_back(*com);
+        }
+        w.write_bytes(contiguous.data(), contiguous.size() * sizeof(Com));
+    } else {
+        w.write_raw(std::uint8_t(0));
+        for (auto com : coms) {
+            write_value(w, *com);
+        }
+    }
+
+    w.patch_raw(size_pos, std::uint64_t(w.size() - begin));
+}
+
+/** Component section parsed ahead of time, applied once the whole snapshot is known to be valid */
+using staged_section = std::function<void(database& db, const std::vector<database::ent_id>& eids)>;
+
+template <typename Com>
+auto read_section(reader& r, std::size_t num_entities) -> staged_section {
+    auto rows = std::vector<std::uint32_t>(r.read_count(sizeof(std::uint32_t)));
+    r.read_bytes(rows.data(), rows.size() * sizeof(std::uint32_t));
+
+    for (auto row : rows) {
+        if (row >= num_entities) {
+            throw std::runtime_error("snapshot: entity row out of range");
+        }
+    }
+
+    auto raw = r.read_raw<std::uint8_t>() != 0;
+
+    if (raw != is_raw<Com>()) {
+        throw std::runtime_error(std::string("snapshot: layout mismatch for ") + reflect<Com>().name);
+    }
+
+    // Every row has a component, so their count is bounded by the remaining data as well
+    if (rows.size() * std::max(min_size<Com>(), std::size_t{1}) > r.remaining()) {
+        throw std::runtime_error("snapshot: unexpected end of data");
+    }
+
+    auto coms = std::vector<Com>(rows.size());
+
+    if constexpr (is_raw<Com>()) {
+        r.read_bytes(coms.data(), coms.size() * sizeof(Com));
+    } else {
+        for (auto& com : coms) {
+            read_value(r, com);
+        }
+    }
+
+    auto staged = std::make_shared<std::pair<std::vector<std::uint32_t>, std::vector<Com>>>(
+        std::move(rows), std::move(coms));
+
+    return [staged](database& db, const std::vector<database::ent_id>& eids) {
+        auto& [rows, coms] = *staged;
+        for (std::size_t i = 0; i < rows.size(); ++i) {
+            db.add_component(eids[rows[i]], std::move(coms[i]));
+        }
+    };
+}
+
+} // namespace _detail
+
+/** Saves every entity with a net_id, along with their Coms */
+template <typename... Coms>
+auto save(database& db) -> std::vector<char> {
+    auto w = writer{};
+
+    w.write_bytes(magic, sizeof(magic));
+    w.write_raw(version);
+    w.write_raw(db.get_next_net_id());
+
+    auto ids = std::vector<net_id::id_type>{};
+    auto rows_by_index = std::vector<std::uint32_t>{};
+
+    db.visit([&](database::ent_id eid, const net_id& id) {
+        auto index = eid.get_index();
+        if (index >= rows_by_index.size()) {
+            rows_by_index.resize(index + 1);
+        }
+        rows_by_index[index] = std::uint32_t(ids.size());
+        ids.push_back(id.id);
+    });
+
+    w.write_raw(std::uint32_t(ids.size()));
+    w.write_bytes(ids.data(), ids.size() * sizeof(net_id::id_type));
+
+    w.write_raw(std::uint32_t(sizeof...(Coms)));
+    (_detail::write_section<Coms>(w, db, rows_by_index), ...);
+
+    return w.release();
+}
+
+/** Saves using a tuple of reflection::tag, such as a component registry */
+template <typename... Coms>
+auto save(database& db, std::tuple<reflection::tag<Coms>...>) -> std::vector<char> {
+    return save<Coms...>(db);
+}
+
+/**
+ * Replaces every entity in the database with the ones in the snapshot, keeping their net_ids.
+ * The whole snapshot is parsed and validated first, so the database is left untouched if it is malformed.
+ */
+template <typename... Coms>
+void load(database& db, utility::span<const char> data) {
+    auto r = reader{data};
+
+    char m[sizeof(magic)];
+    r.read_bytes(m, sizeof(m));
+
+    if (std::memcmp(m, magic, sizeof(magic)) != 0) {
+        throw std::runtime_error("snapshot: bad magic");
+    }
+
+    if (r.read_raw<std::uint32_t>() != version) {
+        throw std::runtime_error("snapshot: unsupported version");
+    }
+
+    auto next_id = r.read_raw<net_id::id_type>();
+
+    auto ids = std::vector<net_id::id_type>(r.read_count(sizeof(net_id::id_type)));
+    r.read_bytes(ids.data(), ids.size() * sizeof(net_id::id_type));
+
+    auto num_sections = r.read_raw<std::uint32_t>();
+    auto sections = std::vector<_detail::staged_section>{};
+
+    for (std::uint32_t i = 0; i < num_sections; ++i) {
+        auto name = _detail::read_string(r);
+        auto size = r.read_raw<std::uint64_t>();
+
+        if (size > r.remaining()) {
+            throw std::runtime_error("snapshot: unexpected end of data");
+        }
+
+        auto begin = r.position();
+        auto found = ((name == reflect<Coms>().name ? (sections.push_back(_detail::read_section<Coms>(r, ids.size())), true)
+                                                    : false) ||
+            ...);
+
+        if (!found) {
+            r.skip(size);
+        } else if (r.position() - begin != size) {
+            throw std::runtime_error("snapshot: section size mismatch for " + name);
+        }
+    }
+
+    auto existing = std::vector<database::ent_id>{};
+    db.visit([&](database::ent_id eid, const net_id&) { existing.push_back(eid); });
+    db.destroy_entities({existing.data(), existing.size()});
+
+    auto eids = db.create_entities({ids.data(), ids.size()});
+
+    if (next_id > db.get_next_net_id()) {
+        db.set_next_net_id(next_id);
+    }
+
+    for (const auto& section : sections) {
+        section(db, eids);
+    }
+}
+
+/** Loads using a tuple of reflection::tag, such as a component registry */
+template <typename... Coms>
+void load(database& db, utility::span<const char> data, std::tuple<reflection::tag<Coms>...>) {
+    load<Coms...>(db, data);
+}
+
+} // namespace ember::snapshot
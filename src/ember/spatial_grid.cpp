@@ -0,0 +1,190 @@
+#include "spatial_grid.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace ember {
+
+spatial_grid::spatial_grid(float cell_size) : cell_size(cell_size) {
+    if (!(cell_size > 0)) {
+        throw std::invalid_argument("spatial_grid: cell_size must be positive");
+    }
+}
+
+void spatial_grid::update(database::ent_id eid, const rect& bounds) {
+    auto index = eid.get_index();
+
+    if (index >= records.size()) {
+        records.resize(index + 1);
+    }
+
+    auto& rec = records[index];
+    auto range = cells_of(bounds);
+
+    // Entity slots are recycled, so a record for a different entity is replaced entirely
+    if (rec.eid && !(*rec.eid == eid)) {
+        remove(*rec.eid);
+    }
+
+    if (rec.eid) {
+        auto same_cells = rec.cells.x1 == range.x1 && rec.cells.y1 == range.y1 && rec.cells.x2 == range.x2 &&
+                          rec.cells.y2 == range.y2;
+
+        if (same_cells) {
+            rec.bounds = bounds;
+            return;
+        }
+
+        remove(eid);
+    }
+
+    for (int y = range.y1; y <= range.y2; ++y) {
+        for (int x = range.x1; x <= range.x2; ++x) {
+            cells[cell_key(x, y)].push_back(eid);
+        }
+    }
+
+    rec.eid = eid;
+    rec.bounds = bounds;
+    rec.cells = range;
+    ++count;
+}
+
+void spatial_grid::remove(database::ent_id eid) {
+    auto index = eid.get_index();
+
+    if (index >= records.size() || !records[index].eid || !(*records[index].eid == eid)) {
+        return;
+    }
+
+    auto& rec = records[index];
+
+    for (int y = rec.cells.y1; y <= rec.cells.y2; ++y) {
+        for (int x = rec.cells.x1; x <= rec.cells.x2; ++x) {
+            auto iter = cells.find(cell_key(x, y));
+            if (iter == cells.end()) {
+                continue;
+            }
+
+            auto& cell = iter->second;
+            auto pos = std::find(begin(cell), end(cell), eid);
+            if (pos != end(cell)) {
+                *pos = cell.back();
+                cell.pop_back();
+            }
+
+            if (cell.empty()) {
+                cells.erase(iter);
+            }
+        }
+    }
+
+    rec.eid = std::nullopt;
+    --count;
+}
+
+void spatial_grid::clear() {
+    cells.clear();
+    records.clear();
+    seen.clear();
+    count = 0;
+}
+
+void spatial_grid::query_point(glm::vec2 p, std::vector<database::ent_id>& out) const {
+    auto c = cell_of(p);
+    gather({c.x, c.y, c.x, c.y}, out, [&](const record& rec) {
+        return p.x >= rec.bounds.min.x && p.x <= rec.bounds.max.x && p.y >= rec.bounds.min.y &&
+               p.y <= rec.bounds.max.y;
+    });
+}
+
+void spatial_grid::query_rect(const rect& area, std::vector<database::ent_id>& out) const {
+    gather(cells_of(area), out, [&](const record& rec) {
+        return rec.bounds.min.x <= area.max.x && rec.bounds.max.x >= area.min.x && rec.bounds.min.y <= area.max.y &&
+               rec.bounds.max.y >= area.min.y;
+    });
+}
+
+void spatial_grid::query_radius(glm::vec2 center, float radius, std::vector<database::ent_id>& out) const {
+    auto area = rect{center - glm::vec2{radius, radius}, center + glm::vec2{radius, radius}};
+    gather(cells_of(area), out, [&](const record& rec) {
+        auto nearest = glm::clamp(center, rec.bounds.min, rec.bounds.max);
+        auto d = nearest - center;
+        return glm::dot(d, d) <= radius * radius;
+    });
+}
+
+auto spatial_grid::cell_of(glm::vec2 p) const -> glm::ivec2 {
+    return {int(std::floor(p.x / cell_size)), int(std::floor(p.y / cell_size))};
+}
+
+auto spatial_grid::cells_of(const rect& r) const -> cell_range {
+    auto a = cell_of(r.min);
+    auto b = cell_of(r.max);
+    return {a.x, a.y, b.x, b.y};
+}
+
+auto spatial_grid::cell_key(int x, int y) -> std::uint64_t {
+    return (std::uint64_t(std::uint32_t(x)) << 32) | std::uint32_t(y);
+}
+
+template <typename F>
+void spatial_grid::gather(const cell_range& range, std::vector<database::ent_id>& out, const F& pred) const {
+    if (seen.size() < records.size()) {
+        seen.resize(records.size(), 0);
+    }
+
+    if (++stamp == 0) {
+        std::fill(begin(seen), end(seen), 0);
+        stamp = 1;
+    }
+
+    for (int y = range.y1; y <= range.y2; ++y) {
+        for (int x = range.x1; x <= range.x2; ++x) {
+            auto iter = cells.find(cell_key(x, y));
+            if (iter == cells.end()) {
+                continue;
+            }
+
+            for (auto eid : iter->second) {
+                auto index = eid.get_index();
+                if (seen[index] != stamp) {
+                    seen[index] = stamp;
+                    if (pred(records[index])) {
+                        out.push_back(eid);
+                    }
+                }
+            }
+        }
+    }
+}
+
+namespace scripting {
+
+template <>
+void register_type<spatial_grid>(sol::table& lua) {
+    using ent_list = sol::as_table_t<std::vector<database::ent_id>>;
+
+    lua.new_usertype<spatial_grid>("spatial_grid", sol::no_constructor,
+        "size", &spatial_grid::size,
+        "query_point", [](const spatial_grid& grid, float x, float y) -> ent_list {
+            auto out = std::vector<database::ent_id>{};
+            grid.query_point({x, y}, out);
+            return sol::as_table(std::move(out));
+        },
+        "query_rect", [](const spatial_grid& grid, float x1, float y1, float x2, float y2) -> ent_list {
+            auto out = std::vector<database::ent_id>{};
+            grid.query_rect({{x1, y1}, {x2, y2}}, out);
+            return sol::as_table(std::move(out));
+        },
+        "query_radius", [](const spatial_grid& grid, float x, float y, float radius) -> ent_list {
+            auto out = std::vector<database::ent_id>{};
+            grid.query_radius({x, y}, radius, out);
+            return sol::as_table(std::move(out));
+        });
+}
+
+} //namespace scripting
+
+} // namespace ember
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "entities.hpp"
+#include "scripting.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace ember {
+
+/**
+ * Uniform grid of entity bounds, for picking and neighbourhood lookups.
+ * Entities are stored in every cell their bounds overlap, so queries only touch nearby entities.
+ * Kept up to date incrementally from the database change sets, see sync().
+ */
+class spatial_grid {
+public:
+    /** Axis-aligned rectangle, min inclusive, max inclusive */
+    struct rect {
+        glm::vec2 min;
+        glm::vec2 max;
+    };
+
+    explicit spatial_grid(float cell_size = 1.f);
+
+    /** Inserts an entity, or moves it if it is already present */
+    void update(database::ent_id eid, const rect& bounds);
+
+    void remove(database::ent_id eid);
+
+    void clear();
+
+    /**
+     * Applies this frame's added, modified and removed Coms, call before database::clear_changes().
+     * bounds_of(const Com&) must return the rect the component covers.
+     */
+    template <typename Com, typename F>
+    void sync(database& db, const F& bounds_of) {
+        for (auto eid : db.get_removed<Com>()) {
+            remove(eid);
+        }
+
+        auto refresh = [&](database::ent_id eid) {
+            if (db.exists(eid) && db.has_component<Com>(eid)) {
+                update(eid, bounds_of(db.get_component<Com>(eid)));
+            }
+        };
+
+        for (auto eid : db.get_added<Com>()) {
+            refresh(eid);
+        }
+
+        for (auto eid : db.get_modified<Com>()) {
+            refresh(eid);
+        }
+    }
+
+    /** Appends entities whose bounds contain the point */
+    void query_point(glm::vec2 p, std::vector<database::ent_id>& out) const;
+
+    /** Appends entities whose bounds overlap the rect */
+    void query_rect(const rect& area, std::vector<database::ent_id>& out) const;
+
+    /** Appends entities whose bounds come within radius of the point */
+    void query_radius(glm::vec2 center, float radius, std::vector<database::ent_id>& out) const;
+
+    auto size() const -> std::size_t { return count; }
+
+private:
+    struct cell_range {
+        int x1, y1, x2, y2;
+    };
+
+    struct record {
+        std::optional<database::ent_id> eid; /** Empty when no entity with this index is stored */
+        rect bounds;
+        cell_range cells;
+    };
+
+    auto cell_of(glm::vec2 p) const -> glm::ivec2;
+
+    auto cells_of(const rect& r) const -> cell_range;
+
+    static auto cell_key(int x, int y) -> std::uint64_t;
+
+    /** Visits each distinct entity in the cells, calling pred(record) to filter */
+    template <typename F>
+    void gather(const cell_range& range, std::vector<database::ent_id>& out, const F& pred) const;
+
+    float cell_size;
+    std::unordered_map<std::uint64_t, std::vector<database::ent_id>> cells;
+    std::vector<record> records; /** Indexed by entity index */
+    std::size_t count = 0;
+    mutable std::vector<std::uint32_t> seen; /** Query stamp per entity index, dedupes entities spanning cells */
+    mutable std::uint32_t stamp = 0;
+};
+
+namespace scripting {
+
+template <>
+void register_type<spatial_grid>(sol::table& lua);
+
+} //namespace scripting
+
+} // namespace ember
@@ -0,0 +1,170 @@
+#include "sprite_batch.hpp"
+
+#include "gl_state.hpp"
+#include "utility.hpp"
+
+#include <glm/gtc/matrix_inverse.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <numeric>
+
+namespace ember {
+
+void sprite_batch::set_tint(const glm::vec4& tint) {
+    auto s = states[current_state];
+    s.tint = tint;
+    use_state(s);
+}
+
+void sprite_batch::set_saturation(float saturation) {
+    auto s = states[current_state];
+    s.saturation = saturation;
+    use_state(s);
+}
+
+void sprite_batch::use_state(const state& s) {
+    // Only a few distinct states are used per frame, reusing them keeps equal states in one run
+    auto iter = std::find_if(begin(states), end(states), [&](const state& other) {
+        return other.tint == s.tint && other.saturation == s.saturation;
+    });
+
+    current_state = std::uint32_t(iter - begin(states));
+
+    if (iter == end(states)) {
+        states.push_back(s);
+    }
+}
+
+void sprite_batch::add(const atom& texture, const glm::mat4& modelmat, const glm::mat3& uvmat) {
+    // Same corners and texcoords as the sprite mesh, texcoords are flipped vertically
+    constexpr glm::vec2 corners[4] = {{0, 0}, {0, 1}, {1, 0}, {1, 1}};
+    constexpr glm::vec2 texcoords[4] = {{0, 1}, {0, 0}, {1, 1}, {1, 0}};
+
+    // World space normal, the view part is applied by the shader
+    auto normal = glm::normalize(glm::inverseTranspose(glm::mat3(modelmat)) * glm::vec3{0, 1, 0});
+
+    auto page_uvmat = uvmat;
+
+    auto& q = quads.emplace_back();
+    q.layer = modelmat[3].z;
+    q.texture = atlas ? atlas->remap(texture, page_uvmat) : texture;
+    q.texture_id = texture_ids.try_emplace(q.texture, std::uint32_t(texture_ids.size())).first->second;
+    q.state = current_state;
+
+    for (int i = 0; i < 4; ++i) {
+        q.vertices[i].position = glm::vec3(modelmat * glm::vec4(corners[i], 0, 1));
+        q.vertices[i].texcoord = glm::vec2(page_uvmat * glm::vec3(texcoords[i], 1));
+        q.vertices[i].normal = normal;
+    }
+}
+
+void sprite_batch::draw(
+    shaders::basic_shader_program& shader,
+    const glm::mat4& proj,
+    const glm::mat4& view,
+    resource_cache<sushi::texture_2d, atom>& textures) {
+    EMBER_DEFER {
+        quads.clear();
+        texture_ids.clear();
+        states.assign(1, state{});
+        current_state = 0;
+    };
+
+    if (quads.empty()) {
+        return;
+    }
+
+    order.resize(quads.size());
+    std::iota(begin(order), end(order), 0);
+
+    std::stable_sort(begin(order), end(order), [&](std::uint32_t a, std::uint32_t b) {
+        const auto& qa = quads[a];
+        const auto& qb = quads[b];
+        if (qa.layer != qb.layer) {
+            return qa.layer < qb.layer;
+        }
+        if (qa.texture_id != qb.texture_id) {
+            return qa.texture_id < qb.texture_id;
+        }
+        return qa.state < qb.state;
+    });
+
+    // Two triangles per quad, matching the sprite mesh winding
+    vertices.clear();
+    vertices.reserve(quads.size() * 6);
+
+    for (auto i : order) {
+        const auto& v = quads[i].vertices;
+        vertices.insert(end(vertices), {v[0], v[1], v[3], v[3], v[2], v[0]});
+    }
+
+    if (!buffer) {
+        buffer = sushi::make_unique_buffer();
+    }
+
+    auto& backend = get_render_backend();
+
+    backend.bind_buffer(buffer.get());
+
+    // Orphan the old storage so the driver does not stall on last frame's draws
+    if (vertices.size() > buffer_capacity) {
+        buffer_capacity = std::max(vertices.size(), buffer_capacity * 2);
+    }
+    backend.buffer_data(buffer_capacity * sizeof(vertex), nullptr, GL_STREAM_DRAW);
+    backend.buffer_sub_data(0, vertices.size() * sizeof(vertex), vertices.data());
+
+    auto position = GLuint(sushi::attrib_location::POSITION);
+    auto texcoord = GLuint(sushi::attrib_location::TEXCOORD);
+    auto normal = GLuint(sushi::attrib_location::NORMAL);
+
+    backend.set_attrib_array_enabled(position, true);
+    backend.set_attrib_array_enabled(texcoord, true);
+    backend.set_attrib_array_enabled(normal, true);
+    backend.vertex_attrib_pointer(position, 3, sizeof(vertex), offsetof(vertex, position));
+    backend.vertex_attrib_pointer(texcoord, 2, sizeof(vertex), offsetof(vertex, texcoord));
+    backend.vertex_attrib_pointer(normal, 3, sizeof(vertex), offsetof(vertex, normal));
+
+    shader.bind();
+    shader.set_MVP(proj * view);
+    shader.set_normal_mat(glm::inverseTranspose(view));
+    shader.set_uvmat(glm::mat3(1.f));
+    shader.set_animated(false);
+
+    auto run_begin = std::size_t{0};
+
+    while (run_begin < order.size()) {
+        const auto& first = quads[order[run_begin]];
+
+        // Consecutive quads with the same texture and state share a draw call, even across layers
+        auto run_end = run_begin + 1;
+        while (run_end < order.size()) {
+            const auto& q = quads[order[run_end]];
+            if (q.texture != first.texture || q.state != first.state) {
+                break;
+            }
+            ++run_end;
+        }
+
+        const auto& s = states[first.state];
+        shader.set_tint(s.tint);
+        shader.set_saturation(s.saturation);
+
+        if (auto tex = textures.get(first.texture)) {
+            gl_state::bind_texture(0, *tex);
+            backend.draw_arrays(GL_TRIANGLES, GLint(run_begin * 6), GLsizei((run_end - run_begin) * 6));
+        } else {
+            std::cout << "Warning: Texture not found: " << first.texture << std::endl;
+        }
+
+        run_begin = run_end;
+    }
+
+    backend.bind_buffer(0);
+
+    shader.set_tint({1, 1, 1, 1});
+    shader.set_saturation(1);
+}
+
+} // namespace ember
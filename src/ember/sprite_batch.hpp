@@ -0,0 +1,87 @@
+#pragma once
+
+#include "atom.hpp"
+#include "resource_cache.hpp"
+#include "shaders.hpp"
+#include "texture_atlas.hpp"
+
+#include <sushi/sushi.hpp>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace ember {
+
+/**
+ * Collects textured quads over a frame and draws them with as few draw calls as possible.
+ * Quads are transformed on the CPU into a streaming vertex buffer, then drawn sorted by layer, texture and tint,
+ * one draw call per run. Layers are drawn back to front, within a layer textures are drawn in the order they were first
+ * used and quads keep their submission order per texture, so the draw order does not change between runs.
+ * Uses the basic shader, vertices are in world space so the model and UV matrices are identity.
+ * With an atlas, packed textures are drawn from their atlas page so different sprites can share a draw call.
+ */
+class sprite_batch {
+public:
+    explicit sprite_batch(const texture_atlas* atlas = nullptr) : atlas(atlas) {}
+    sprite_batch(const sprite_batch&) = delete;
+    sprite_batch(sprite_batch&&) = default;
+    sprite_batch& operator=(const sprite_batch&) = delete;
+    sprite_batch& operator=(sprite_batch&&) = default;
+
+    /** Tint and saturation applied to quads added after this call */
+    void set_tint(const glm::vec4& tint);
+
+    void set_saturation(float saturation);
+
+    /**
+     * Adds a unit quad from (0,0) to (1,1), transformed by modelmat and with texcoords transformed by uvmat.
+     * The layer is the translation's z, so quads stack the same way they would when drawn individually.
+     * The texture name and uvmat refer to the source texture, they are remapped if it is packed in the atlas.
+     */
+    void add(const atom& texture, const glm::mat4& modelmat, const glm::mat3& uvmat);
+
+    /** Draws and clears all quads, leaves the shader bound with default uniforms */
+    void draw(
+        shaders::basic_shader_program& shader,
+        const glm::mat4& proj,
+        const glm::mat4& view,
+        resource_cache<sushi::texture_2d, atom>& textures);
+
+    auto size() const -> std::size_t { return quads.size(); }
+
+private:
+    struct vertex {
+        glm::vec3 position;
+        glm::vec2 texcoord;
+        glm::vec3 normal;
+    };
+
+    struct state {
+        glm::vec4 tint = {1, 1, 1, 1};
+        float saturation = 1;
+    };
+
+    struct quad {
+        float layer;
+        atom texture;
+        std::uint32_t texture_id; /** Order of the texture's first use this frame, sorted on instead of the atom */
+        std::uint32_t state; /** Index into states */
+        vertex vertices[4];  /** Bottom left, top left, bottom right, top right */
+    };
+
+    void use_state(const state& s);
+
+    const texture_atlas* atlas;
+    std::vector<quad> quads;
+    std::vector<state> states = {state{}};
+    std::uint32_t current_state = 0;
+    std::unordered_map<atom, std::uint32_t> texture_ids;
+    std::vector<std::uint32_t> order;
+    std::vector<vertex> vertices;
+    sushi::unique_buffer buffer;
+    std::size_t buffer_capacity = 0; /** In vertices */
+};
+
+} // namespace ember
@@ -1,100 +1,86 @@
 #include "sushi_renderer.hpp"
 
+#include "gl_state.hpp"
+
 #include <glm/gtc/matrix_inverse.hpp>
 
+#include <algorithm>
 #include <cmath>
+#include <tuple>
+#include <vector>
 
 namespace ember {
 
 sushi_renderer::sushi_renderer(
     const glm::vec2& display_area,
     shaders::basic_shader_program& program,
-    shaders::msdf_shader_program& msdf_shader,
+    shaders::gui_shader_program& gui_shader,
     cache<msdf_font>& font_cache,
+    glyph_atlas& glyphs,
     cache<sushi::mesh_group>& mesh_cache,
-    cache<sushi::texture_2d>& texture_cache)
+    cache<sushi::texture_2d>& texture_cache,
+    const texture_atlas* atlas)
     : display_area(display_area),
       program(&program),
-      msdf_shader(&msdf_shader),
+      gui_shader(&gui_shader),
       font_cache(&font_cache),
+      glyphs(&glyphs),
       mesh_cache(&mesh_cache),
-      texture_cache(&texture_cache) {
-    sushi::mesh_group_builder mb;
-    mb.enable(sushi::attrib_location::POSITION);
-    mb.enable(sushi::attrib_location::TEXCOORD);
-    mb.enable(sushi::attrib_location::NORMAL);
-
-    mb.mesh("");
-
-    auto left = 0.f;
-    auto right = 1.f;
-    auto bottom = 0.f;
-    auto top = 1.f;
-
-    auto bottomleft = mb.vertex()
-        .position({left, bottom, 0})
-        .texcoord({0, 1})
-        .normal({0, 0, 1})
-        .get();
-
-    auto topleft = mb.vertex()
-        .position({left, top, 0})
-        .texcoord({0, 0})
-        .normal({0, 0, 1})
-        .get();
-
-    auto bottomright = mb.vertex()
-        .position({right, bottom, 0})
-        .texcoord({1, 1})
-        .normal({0, 0, 1})
-        .get();
-
-    auto topright = mb.vertex()
-        .position({right, top, 0})
-        .texcoord({1, 0})
-        .normal({0, 0, 1})
-        .get();
-    
-    mb.tri(bottomleft, topleft, topright);
-    mb.tri(topright, bottomright, bottomleft);
-
-    rectangle_mesh = mb.get();
-}
+      texture_cache(&texture_cache),
+      atlas(atlas) {}
 
 void sushi_renderer::begin() {
-    glDisable(GL_DEPTH_TEST);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    batch.begin(display_area);
+    glyphs->begin_frame();
+    gl_state::set_enabled(GL_DEPTH_TEST, false);
+    gl_state::set_enabled(GL_BLEND, true);
+    gl_state::blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     glClear(GL_DEPTH_BUFFER_BIT);
 }
 
 void sushi_renderer::end() {
-    glDisable(GL_BLEND);
-    glEnable(GL_DEPTH_TEST);
-}
+    batch.flush(*gui_shader);
+    gl_state::set_enabled(GL_BLEND, false);
+    gl_state::set_enabled(GL_DEPTH_TEST, true);
+
+    // Widgets keep their own layouts, so dropping entries only costs a new layout if the text comes back
+    if (text_cache.size() > text_cache_capacity) {
+        using entry_iter = decltype(text_cache)::iterator;
+
+        auto entries = std::vector<entry_iter>{};
+        entries.reserve(text_cache.size());
+        for (auto iter = text_cache.begin(); iter != text_cache.end(); ++iter) {
+            entries.push_back(iter);
+        }
+
+        auto evicted = entries.begin() + (entries.size() - text_cache_capacity / 2);
+        std::nth_element(entries.begin(), evicted, entries.end(), [](const entry_iter& a, const entry_iter& b) {
+            return std::tie(a->second.last_used, a->second.inserted) < std::tie(b->second.last_used, b->second.inserted);
+        });
+
+        for (auto iter = entries.begin(); iter != evicted; ++iter) {
+            text_cache.erase(*iter);
+        }
+    }
 
-void sushi_renderer::draw_rectangle(const std::string& texture, const glm::vec4& color, glm::vec2 position, glm::vec2 size) {
-    auto proj = glm::ortho(0.f, display_area.x, 0.f, display_area.y, 10.f, -10.f);
-    auto model_mat = glm::mat4(1.f);
+    ++frame;
+}
 
-    model_mat = glm::translate(model_mat, glm::vec3(position, 0.f));
-    model_mat = glm::scale(model_mat, glm::vec3(size, 1.f));
+void sushi_renderer::draw_rectangle(const atom& texture, const glm::vec4& color, glm::vec2 position, glm::vec2 size) {
+    // Texcoords are flipped vertically, like the sprite mesh
+    auto uvmat = glm::mat3(1.f);
+    const auto& page = atlas ? atlas->remap(texture, uvmat) : texture;
 
-    program->bind();
-    program->set_cam_forward({0.0, 0.0, -1.0});
-    program->set_normal_mat(glm::inverseTranspose(model_mat));
-    program->set_MVP(proj * model_mat);
-    program->set_uvmat(glm::mat3(1.f));
-    program->set_tint(color);
-    program->set_hue(0);
-    program->set_saturation(1);
-    program->set_animated(false);
+    auto uv1 = glm::vec2(uvmat * glm::vec3{0, 1, 1});
+    auto uv2 = glm::vec2(uvmat * glm::vec3{1, 0, 1});
 
-    sushi::set_texture(0, *texture_cache->get(texture));
-    sushi::draw_mesh(rectangle_mesh);
+    batch.add_quad(*texture_cache->get(page), position, size, uv1, uv2, color);
 }
 
-void sushi_renderer::draw_model(const std::string& mesh, const std::string& texture, glm::vec2 position, glm::vec2 size, glm::mat4 model_mat) {
+void sushi_renderer::draw_model(const atom& mesh, const atom& texture, glm::vec2 position, glm::vec2 size, glm::mat4 model_mat) {
+    // Models use the basic shader, everything queued before them has to be drawn first
+    batch.flush(*gui_shader);
+
     auto half_size = size * 0.5f;
 
     auto bottom_left = -(position / half_size + glm::vec2{1.f, 1.f});
@@ -113,47 +99,91 @@ void sushi_renderer::draw_model(const std::string& mesh, const std::string& text
     program->set_tint({1, 1, 1, 1});
     program->set_hue(0);
     program->set_saturation(1);
+    program->set_animated(false);
 
-    sushi::set_texture(0, *texture_cache->get(texture));
+    gl_state::bind_texture(0, *texture_cache->get(texture));
 
-    glEnable(GL_DEPTH_TEST);
-    sushi::draw_mesh(*mesh_cache->get(mesh));
-    glDisable(GL_DEPTH_TEST);
+    gl_state::set_enabled(GL_DEPTH_TEST, true);
+    get_render_backend().draw_mesh(*mesh_cache->get(mesh), nullptr);
+    gl_state::set_enabled(GL_DEPTH_TEST, false);
 }
 
-float sushi_renderer::get_text_width(const std::string& text, const std::string& fontname) {
+auto sushi_renderer::layout_text(const std::string& text, const atom& fontname, float size)
+    -> std::shared_ptr<const gui::text_layout> {
+    auto key = text_key{text, fontname, size};
+
+    if (auto iter = text_cache.find(key); iter != text_cache.end()) {
+        iter->second.last_used = frame;
+        return iter->second.layout;
+    }
+
     auto font = font_cache->get(fontname);
-    auto width = 0.f;
+    auto layout = std::make_shared<gui::text_layout>();
+    layout->font = fontname;
+    layout->size = size;
+
+    auto pen = glm::vec2{0, 0};
+    auto prev = 0;
+    auto line_start = std::size_t{0};
+
+    auto end_line = [&] {
+        layout->lines.push_back({line_start, layout->glyphs.size() - line_start, pen.x});
+        layout->width = std::max(layout->width, pen.x);
+        line_start = layout->glyphs.size();
+    };
 
     for (auto c : text) {
+        if (c == '\n') {
+            end_line();
+            pen = {0, pen.y - size};
+            prev = 0;
+            continue;
+        }
+
         auto& glyph = font->get_glyph(c);
-        width += glyph.advance;
+
+        if (prev) {
+            pen.x += size * font->get_kerning(prev, c);
+        }
+
+        layout->glyphs.push_back({c, pen, size * glyph.advance});
+
+        pen.x += size * glyph.advance;
+        prev = c;
     }
 
-    return width;
-}
+    end_line();
 
-void sushi_renderer::draw_text(const std::string& text, const std::string& fontname, const glm::vec4& color, glm::vec2 position, float size) {
-    auto font = font_cache->get(fontname);
-    auto proj = glm::ortho(0.f, display_area.x, 0.f, display_area.y, -1.f, 1.f);
-    auto model = glm::scale(glm::translate(glm::mat4(1.f), glm::vec3(position, 0.f)), glm::vec3{size, size, 1.f});
+    text_cache.emplace(std::move(key), cached_text{layout, frame, text_inserts++});
 
-    msdf_shader->bind();
-    msdf_shader->set_msdf(0);
-    msdf_shader->set_pxRange(4.f);
-    msdf_shader->set_fgColor(color);
+    return layout;
+}
 
-    for (auto c : text) {
-        auto& glyph = font->get_glyph(c);
+void sushi_renderer::draw_text(const gui::text_layout& text, const glm::vec4& color, glm::vec2 position) {
+    auto font = font_cache->get(text.font);
 
-        msdf_shader->set_MVP(proj * model);
-        msdf_shader->set_texSize({glyph.texture.width, glyph.texture.height});
+    for (const auto& g : text.glyphs) {
+        // Looked up every draw, the region changes when a background glyph arrives or its page is evicted
+        auto& glyph = font->get_glyph(g.codepoint);
 
-        sushi::set_texture(0, glyph.texture);
-        sushi::draw_mesh(glyph.mesh);
+        if (glyph.region) {
+            const auto& r = *glyph.region;
+            const auto& page = glyphs->get_page(r.page);
+            auto msdf_unit = font->get_px_range() / glm::vec2{page.width, page.height};
+            auto corner = position + g.pen + text.size * glyph.bounds_min;
+            auto extent = text.size * (glyph.bounds_max - glyph.bounds_min);
 
-        model = glm::translate(model, glm::vec3{glyph.advance, 0.f, 0.f});
+            batch.add_quad(page, corner, extent, r.uv1, r.uv2, color, msdf_unit);
+        }
     }
 }
 
+void sushi_renderer::push_clip(glm::vec2 position, glm::vec2 size) {
+    batch.push_clip(position, size);
+}
+
+void sushi_renderer::pop_clip() {
+    batch.pop_clip();
+}
+
 } // namespace ember
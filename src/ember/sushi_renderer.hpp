@@ -1,45 +1,99 @@
 #pragma once
 
+#include "atom.hpp"
 #include "gui.hpp"
 #include "font.hpp"
+#include "glyph_atlas.hpp"
+#include "gui_batch.hpp"
 #include "shaders.hpp"
 #include "resource_cache.hpp"
+#include "texture_atlas.hpp"
 
 #include <sushi/sushi.hpp>
 
+#include <cstddef>
+#include <functional>
+#include <memory>
 #include <string>
+#include <unordered_map>
 
 namespace ember {
 
+/**
+ * GUI render context drawing through sushi.
+ * Panels and text are recorded into a gui_batch and drawn together at end(), models flush the batch first so the
+ * drawing order is kept. Glyphs of all fonts share the glyph atlas, so text costs one draw per atlas page.
+ * Text layouts are cached by text, font and size, and dropped once the cache is full and they go unused.
+ */
 class sushi_renderer final : public gui::render_context {
 public:
     template <typename T>
-    using cache = resource_cache<T, std::string>;
+    using cache = resource_cache<T, atom>;
 
     sushi_renderer() = default;
     sushi_renderer(
         const glm::vec2& display_area,
         shaders::basic_shader_program& program,
-        shaders::msdf_shader_program& msdf_shader,
+        shaders::gui_shader_program& gui_shader,
         cache<msdf_font>& font_cache,
+        glyph_atlas& glyphs,
         cache<sushi::mesh_group>& mesh_cache,
-        cache<sushi::texture_2d>& texture_cache);
+        cache<sushi::texture_2d>& texture_cache,
+        const texture_atlas* atlas = nullptr);
 
     virtual void begin() override;
     virtual void end() override;
-    virtual void draw_rectangle(const std::string& texture, const glm::vec4& color, glm::vec2 position, glm::vec2 size) override;
-    virtual void draw_model(const std::string& mesh, const std::string& texture, glm::vec2 position, glm::vec2 size, glm::mat4 model_mat) override;
-    virtual void draw_text(const std::string& text, const std::string& font, const glm::vec4& color, glm::vec2 position, float size) override;
-    virtual float get_text_width(const std::string& text, const std::string& font) override;
+    virtual void draw_rectangle(const atom& texture, const glm::vec4& color, glm::vec2 position, glm::vec2 size) override;
+    virtual void draw_model(const atom& mesh, const atom& texture, glm::vec2 position, glm::vec2 size, glm::mat4 model_mat) override;
+    virtual void draw_text(const gui::text_layout& text, const glm::vec4& color, glm::vec2 position) override;
+    virtual auto layout_text(const std::string& text, const atom& font, float size)
+        -> std::shared_ptr<const gui::text_layout> override;
+    virtual void push_clip(glm::vec2 position, glm::vec2 size) override;
+    virtual void pop_clip() override;
+
+    /** Batch totals for the last frame */
+    auto get_stats() const -> const gui_batch::stats& { return batch.get_stats(); }
 
 private:
+    struct text_key {
+        std::string text;
+        atom font;
+        float size;
+
+        friend bool operator==(const text_key& a, const text_key& b) {
+            return a.font == b.font && a.size == b.size && a.text == b.text;
+        }
+    };
+
+    struct text_key_hash {
+        auto operator()(const text_key& k) const -> std::size_t {
+            auto h = std::hash<std::string>{}(k.text);
+            h = h * 31 + std::hash<atom>{}(k.font);
+            return h * 31 + std::hash<float>{}(k.size);
+        }
+    };
+
+    struct cached_text {
+        std::shared_ptr<const gui::text_layout> layout;
+        int last_used; /** Frame number */
+        std::size_t inserted; /** Insertion order, breaks ties between entries used in the same frame */
+    };
+
+    /** Layouts kept before ones unused the longest are dropped */
+    static constexpr std::size_t text_cache_capacity = 256;
+
     glm::vec2 display_area;
     shaders::basic_shader_program* program;
-    shaders::msdf_shader_program* msdf_shader;
+    shaders::gui_shader_program* gui_shader;
     cache<msdf_font>* font_cache;
+    glyph_atlas* glyphs;
     cache<sushi::mesh_group>* mesh_cache;
     cache<sushi::texture_2d>* texture_cache;
-    sushi::mesh_group rectangle_mesh;
+    const texture_atlas* atlas;
+    gui_batch batch;
+    std::unordered_map<text_key, cached_text, text_key_hash> text_cache;
+    int frame = 0;
+    std::size_t text_inserts = 0;
 };
 
 } // namespace ember
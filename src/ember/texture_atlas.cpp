@@ -0,0 +1,59 @@
+#include "texture_atlas.hpp"
+
+#include "json.hpp"
+
+#include <fstream>
+#include <stdexcept>
+
+namespace ember {
+
+texture_atlas::texture_atlas(const std::string& filename) {
+    auto file = std::ifstream(filename);
+
+    if (!file) {
+        return;
+    }
+
+    auto json = nlohmann::json{};
+    file >> json;
+
+    if (json.count("regions") == 0) {
+        throw std::runtime_error("texture_atlas: " + filename + " has no regions");
+    }
+
+    const auto& table = json["regions"];
+
+    for (auto it = table.begin(); it != table.end(); ++it) {
+        const auto& r = it.value();
+        const auto& uv1 = r["uv1"];
+        const auto& uv2 = r["uv2"];
+        regions.emplace(
+            atom(it.key()),
+            region{
+                atom(r["texture"].get<std::string>()),
+                {uv1[0].get<float>(), uv1[1].get<float>()},
+                {uv2[0].get<float>(), uv2[1].get<float>()}});
+    }
+}
+
+auto texture_atlas::find(const atom& name) const -> const region* {
+    auto iter = regions.find(name);
+    return iter != regions.end() ? &iter->second : nullptr;
+}
+
+auto texture_atlas::remap(const atom& name, glm::mat3& uvmat) const -> const atom& {
+    auto r = find(name);
+
+    if (!r) {
+        return name;
+    }
+
+    auto size = r->uv2 - r->uv1;
+    auto to_page = glm::mat3({size.x, 0, 0}, {0, size.y, 0}, {r->uv1.x, r->uv1.y, 1});
+
+    uvmat = to_page * uvmat;
+
+    return r->texture;
+}
+
+} // namespace ember
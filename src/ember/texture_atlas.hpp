@@ -0,0 +1,42 @@
+#pragma once
+
+#include "atom.hpp"
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <unordered_map>
+
+namespace ember {
+
+/**
+ * Lookup table produced by the atlas cooking step (tools/pack_atlas.py).
+ * Maps a source texture name to the atlas page holding it and its UV rectangle in that page.
+ * UVs use the same orientation as source textures, (0,0) is the first row of the image.
+ */
+class texture_atlas {
+public:
+    struct region {
+        atom texture; /** Atlas page, loaded through the texture cache like any other texture */
+        glm::vec2 uv1;
+        glm::vec2 uv2;
+    };
+
+    texture_atlas() = default;
+
+    /** Loads a table, a missing file gives an empty atlas so uncooked builds fall back to separate textures */
+    explicit texture_atlas(const std::string& filename);
+
+    /** Region of a packed texture, or nullptr if the texture is not in the atlas */
+    auto find(const atom& name) const -> const region*;
+
+    /** Maps a UV matrix for the source texture into the atlas page, returns the page to bind */
+    auto remap(const atom& name, glm::mat3& uvmat) const -> const atom&;
+
+    auto size() const -> std::size_t { return regions.size(); }
+
+private:
+    std::unordered_map<atom, region> regions;
+};
+
+} // namespace ember
@@ -0,0 +1,150 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+namespace ember {
+
+namespace { // static
+
+/** Index of the queue owned by the current thread, or -1 outside of the pool */
+thread_local std::ptrdiff_t current_queue = -1;
+
+} // static
+
+auto thread_pool::default_thread_count() -> unsigned {
+#if EMBER_THREADS_ENABLED
+    auto n = std::thread::hardware_concurrency();
+    return n > 1 ? n - 1 : 0;
+#else
+    return 0;
+#endif
+}
+
+thread_pool::thread_pool(unsigned num_threads) {
+#if !EMBER_THREADS_ENABLED
+    num_threads = 0;
+#endif
+
+    for (unsigned i = 0; i <= num_threads; ++i) {
+        queues.push_back(std::make_unique<worker_queue>());
+    }
+
+    workers.reserve(num_threads);
+
+    for (unsigned i = 0; i < num_threads; ++i) {
+        workers.emplace_back([this, i] { worker_main(i); });
+    }
+}
+
+thread_pool::~thread_pool() {
+    {
+        auto lock = std::lock_guard(sleep_mutex);
+        stopping = true;
+    }
+
+    sleep_cv.notify_all();
+
+    for (auto& w : workers) {
+        w.join();
+    }
+}
+
+void thread_pool::submit(task_group& group, std::function<void()> func) {
+    group.pending.fetch_add(1, std::memory_order_relaxed);
+
+    auto index = current_queue >= 0 ? std::size_t(current_queue) : next_queue++ % queues.size();
+
+    {
+        auto& q = *queues[index];
+        auto lock = std::lock_guard(q.mutex);
+        q.tasks.push_back({&group, std::move(func)});
+    }
+
+    ++queued;
+
+    {
+        auto lock = std::lock_guard(sleep_mutex);
+    }
+
+    sleep_cv.notify_one();
+}
+
+void thread_pool::wait(task_group& group) {
+    auto index = current_queue >= 0 ? std::size_t(current_queue) : workers.size();
+
+    // Only the group's own tasks are run here, so waiting never picks up unrelated long tasks like glyph jobs
+    while (!group.done()) {
+        if (auto t = try_pop(index, &group)) {
+            run_task(*t);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    if (group.error) {
+        std::rethrow_exception(std::exchange(group.error, nullptr));
+    }
+}
+
+void thread_pool::worker_main(std::size_t index) {
+    current_queue = std::ptrdiff_t(index);
+
+    while (true) {
+        if (auto t = try_pop(index)) {
+            run_task(*t);
+        } else {
+            auto lock = std::unique_lock(sleep_mutex);
+            sleep_cv.wait(lock, [&] { return stopping || queued > 0; });
+            if (stopping && queued == 0) {
+                return;
+            }
+        }
+    }
+}
+
+auto thread_pool::try_pop(std::size_t index, const task_group* group) -> std::optional<task> {
+    auto matches = [&](const task& t) { return !group || t.group == group; };
+
+    {
+        auto& q = *queues[index];
+        auto lock = std::lock_guard(q.mutex);
+        auto iter = std::find_if(q.tasks.rbegin(), q.tasks.rend(), matches);
+        if (iter != q.tasks.rend()) {
+            auto t = std::move(*iter);
+            q.tasks.erase(std::next(iter).base());
+            --queued;
+            return t;
+        }
+    }
+
+    for (std::size_t i = 1; i < queues.size(); ++i) {
+        auto& q = *queues[(index + i) % queues.size()];
+        auto lock = std::lock_guard(q.mutex);
+        auto iter = std::find_if(q.tasks.begin(), q.tasks.end(), matches);
+        if (iter != q.tasks.end()) {
+            auto t = std::move(*iter);
+            q.tasks.erase(iter);
+            --queued;
+            return t;
+        }
+    }
+
+    return std::nullopt;
+}
+
+void thread_pool::run_task(task& t) {
+    try {
+        t.func();
+    } catch (...) {
+        auto lock = std::lock_guard(t.group->error_mutex);
+        if (!t.group->error) {
+            t.group->error = std::current_exception();
+        }
+    }
+
+    t.group->pending.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+} // namespace ember
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+#define EMBER_THREADS_ENABLED 0
+#else
+#define EMBER_THREADS_ENABLED 1
+#endif
+
+namespace ember {
+
+/**
+ * Work-stealing pool of worker threads.
+ * Every worker owns a task deque, pops its own work from the back and steals from the front of the others.
+ * Threads waiting on a task group help run that group's queued tasks, so with zero workers the group runs on the
+ * waiting thread, while tasks of other groups are left to the workers.
+ */
+class thread_pool {
+public:
+    /** Counts the unfinished tasks submitted against it */
+    class task_group {
+    public:
+        task_group() = default;
+        task_group(const task_group&) = delete;
+        task_group& operator=(const task_group&) = delete;
+
+        bool done() const { return pending.load(std::memory_order_acquire) == 0; }
+
+    private:
+        friend class thread_pool;
+        std::atomic<int> pending = 0;
+        std::mutex error_mutex;
+        std::exception_ptr error; /** First exception thrown by a task, rethrown by wait() */
+    };
+
+    /** Number of workers used by default, leaves one hardware thread for the main thread */
+    static auto default_thread_count() -> unsigned;
+
+    explicit thread_pool(unsigned num_threads = default_thread_count());
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+    ~thread_pool();
+
+    /** Number of worker threads, not counting threads that help while waiting */
+    auto size() const -> unsigned { return unsigned(workers.size()); }
+
+    /** Queues a task, it will run on a worker or on a thread waiting on the group */
+    void submit(task_group& group, std::function<void()> task);
+
+    /** Blocks until every task in the group has finished, running its queued tasks meanwhile, rethrows task errors */
+    void wait(task_group& group);
+
+    /** Calls func(begin, end) over [0, count) split into chunks of at most grain, blocking until done */
+    template <typename F>
+    void parallel_for(std::size_t count, std::size_t grain, const F& func) {
+        if (grain == 0) {
+            grain = 1;
+        }
+
+        if (count <= grain || workers.empty()) {
+            if (count > 0) {
+                func(std::size_t{0}, count);
+            }
+            return;
+        }
+
+        auto group = task_group{};
+
+        for (std::size_t b = 0; b < count; b += grain) {
+            auto e = b + grain < count ? b + grain : count;
+            submit(group, [&func, b, e] { func(b, e); });
+        }
+
+        wait(group);
+    }
+
+private:
+    struct task {
+        task_group* group;
+        std::function<void()> func;
+    };
+
+    struct worker_queue {
+        std::mutex mutex;
+        std::deque<task> tasks;
+    };
+
+    void worker_main(std::size_t index);
+
+    /** Pops from the given queue, or steals from the others, only tasks of the group if one is given */
+    auto try_pop(std::size_t index, const task_group* group = nullptr) -> std::optional<task>;
+
+    void run_task(task& t);
+
+    std::vector<std::unique_ptr<worker_queue>> queues; /** One per worker, plus one shared by outside threads */
+    std::vector<std::thread> workers;
+    std::atomic<std::size_t> next_queue = 0;
+    std::atomic<int> queued = 0;
+    std::atomic<bool> stopping = false;
+    std::mutex sleep_mutex;
+    std::condition_variable sleep_cv;
+};
+
+} // namespace ember
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <cstddef>
 #include <iterator>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 #define EMBER_CAT_IMPL(A,B) A##B
 #define EMBER_CAT(A,B) EMBER_CAT_IMPL(A,B)
@@ -143,4 +146,45 @@ private:
     std::size_t length = 0;
 };
 
+/**
+ * Stable O(n) sort by an unsigned integer key, least significant byte first.
+ * Bytes that all keys share are skipped. buffer is scratch space, reused between calls to avoid allocation.
+ */
+template <typename T, typename GetKey>
+void radix_sort(std::vector<T>& data, std::vector<T>& buffer, const GetKey& get_key) {
+    using key_type = std::decay_t<decltype(get_key(data.front()))>;
+    static_assert(std::is_unsigned_v<key_type>, "radix_sort keys must be unsigned integers");
+
+    if (data.size() < 2) {
+        return;
+    }
+
+    buffer.resize(data.size());
+
+    for (unsigned shift = 0; shift < sizeof(key_type) * 8; shift += 8) {
+        std::size_t counts[256] = {};
+
+        for (const auto& d : data) {
+            ++counts[(get_key(d) >> shift) & 0xff];
+        }
+
+        if (counts[(get_key(data.front()) >> shift) & 0xff] == data.size()) {
+            continue;
+        }
+
+        auto offset = std::size_t{0};
+        for (auto& c : counts) {
+            auto n = c;
+            c = offset;
+            offset += n;
+        }
+
+        for (const auto& d : data) {
+            buffer[counts[(get_key(d) >> shift) & 0xff]++] = d;
+        }
+
+        data.swap(buffer);
+    }
+}
+
 } // namespace ember::utility
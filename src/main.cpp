@@ -1,3 +1,5 @@
+#include "render_check.hpp"
+#include "scene_gameplay.hpp"
 #include "scene_mainmenu.hpp"
 
 #include "ember/engine.hpp"
@@ -46,11 +48,24 @@ int main() try {
 
     auto engine = std::make_unique<ember::engine>(config);
 
-    engine->queue_transition<scene_mainmenu>();
-
     std::cout << "Success." << std::endl;
 
-    loop = [&engine]{ engine->tick(); };
+    if (config.render_check.enabled) {
+        engine->queue_transition<scene_gameplay>();
+
+        // The first tick enters the scene and the second runs it once, then the check renders without presenting
+        loop = [&engine, &config, ticks = 0]() mutable {
+            engine->tick();
+            if (++ticks == 2) {
+                auto passed = run_render_check(*engine, config.render_check.expected_hash);
+                emscripten_force_exit(passed ? EXIT_SUCCESS : EXIT_FAILURE);
+            }
+        };
+    } else {
+        engine->queue_transition<scene_mainmenu>();
+
+        loop = [&engine]{ engine->tick(); };
+    }
 
     emscripten_set_main_loop(main_loop, 0, 1);
 
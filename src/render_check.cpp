@@ -0,0 +1,84 @@
+#include "render_check.hpp"
+
+#include "ember/render_backend.hpp"
+#include "ember/utility.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+/** Frames rendered into the null backend, for timing and to let glyph uploads finish */
+constexpr int warmup_frames = 30;
+
+/** Recordings tried before giving up on two consecutive ones matching */
+constexpr int max_recordings = 60;
+
+auto to_hex(std::uint64_t value) -> std::string {
+    auto out = std::ostringstream{};
+    out << std::hex << std::setw(16) << std::setfill('0') << value;
+    return out.str();
+}
+
+} // namespace
+
+auto run_render_check(ember::engine& engine, const std::string& expected_hash) -> bool {
+    using clock = std::chrono::steady_clock;
+
+    auto null_backend = ember::null_render_backend{};
+    auto recorder = ember::recording_render_backend{&null_backend};
+
+    EMBER_DEFER { ember::set_render_backend(nullptr); };
+
+    ember::set_render_backend(&null_backend);
+
+    auto start = clock::now();
+    for (int i = 0; i < warmup_frames; ++i) {
+        engine.render();
+    }
+    auto elapsed = std::chrono::duration<double, std::milli>(clock::now() - start);
+
+    std::cout << "render_check: " << elapsed.count() / warmup_frames << " ms/frame into the null backend" << std::endl;
+
+    auto record = [&] {
+        recorder.clear();
+        ember::set_render_backend(&recorder);
+        engine.render();
+        return recorder.get_commands();
+    };
+
+    auto previous = record();
+    auto settled = false;
+
+    for (int i = 1; i < max_recordings && !settled; ++i) {
+        auto current = record();
+        settled = !current.mismatch(previous);
+        previous = std::move(current);
+    }
+
+    auto draws = previous.draw_count();
+    auto hash = to_hex(previous.hash());
+
+    std::cout << "render_check: " << draws << " draws, " << previous.size() << " commands, hash " << hash << std::endl;
+
+    if (!settled) {
+        std::cerr << "ERROR: render_check: consecutive frames never matched" << std::endl;
+        return false;
+    }
+
+    if (draws == 0) {
+        std::cerr << "ERROR: render_check: the frame has no draws" << std::endl;
+        return false;
+    }
+
+    if (!expected_hash.empty() && expected_hash != hash) {
+        std::cerr << "ERROR: render_check: expected hash " << expected_hash << std::endl;
+        return false;
+    }
+
+    std::cout << "render_check: passed" << std::endl;
+    return true;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "ember/engine.hpp"
+
+#include <string>
+
+/**
+ * Headless rendering check, enabled with the render_check page parameter.
+ * Renders the current scene into the null render backend, then records it with the recording backend until two
+ * consecutive frames match, so nothing is drawn or presented. Fails if the frame never settles, has no draws, or its
+ * hash differs from expected_hash when one is given. Prints the draw count and hash for updating the expected value.
+ */
+auto run_render_check(ember::engine& engine, const std::string& expected_hash) -> bool;
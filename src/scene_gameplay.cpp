@@ -3,12 +3,13 @@
 #include "scene_lose.hpp"
 #include "scene_mainmenu.hpp"
 #include "components.hpp"
-#include "meshes.hpp"
 
 #include "board_mesh.hpp"
 
 #include "ember/camera.hpp"
 #include "ember/engine.hpp"
+#include "ember/gl_state.hpp"
+#include "ember/snapshot.hpp"
 #include "ember/vdom.hpp"
 
 #include <glm/gtc/matrix_inverse.hpp>
@@ -19,10 +20,24 @@
 
 namespace { // static
 
+// Textures drawn every frame, interned once
+namespace textures {
+const auto background = ember::atom("background");
+const auto board = ember::atom("board");
+const auto character_card2 = ember::atom("character_card2");
+const auto overlays = ember::atom("overlays");
+} // namespace textures
+
 bool is_in(glm::vec2 p, glm::vec2 a, glm::vec2 s) {
     return p.x >= a.x && p.x <= a.x + s.x && p.y >= a.y && p.y <= a.y + s.y;
 }
 
+// Sprites are drawn as unit squares from their position
+auto sprite_bounds(const component::transform& tform) -> ember::spatial_grid::rect {
+    auto pos = glm::vec2(tform.pos);
+    return {pos, pos + glm::vec2{1, 1}};
+}
+
 }
 
 // Scene constructor
@@ -32,8 +47,9 @@ scene_gameplay::scene_gameplay(ember::engine& engine, ember::scene* prev)
     : scene(engine),
       camera(),                             // Camera has a sane default constructor, it is tweaked below
       entities(),                           // Entity database has no constructor parameters
+      spatial(1.f),                         // Sprites are one unit across, so are the grid cells
       gui_state{engine.lua.create_table()}, // Gui state is initialized to an empty Lua table
-      sprite_mesh{get_sprite_mesh()},       // Sprite and tilemap meshes is created statically
+      sprites(&engine.atlas),               // Sprite batch draws packed textures from the engine's atlas
       tiles(3*4),
       num_rows(4),
       num_cols(3),
@@ -42,6 +58,7 @@ scene_gameplay::scene_gameplay(ember::engine& engine, ember::scene* prev)
       board_pos{6, 3},
       player_characters(),
       enemy_characters(),
+      enemy_prefabs(),
       movement_cards(load_movement_cards()),
       enemy_movement_cards(load_movement_cards("/data/enemyMovement.json")),
       available_movement_cards(),
@@ -121,6 +138,26 @@ scene_gameplay::scene_gameplay(ember::engine& engine, ember::scene* prev)
         }
     }
 
+    // Compile enemy prefabs, per-instance state is filled in by spawn_enemy()
+    for (auto& e : enemy_characters) {
+        auto sprite = component::sprite{};
+        sprite.texture = e.base.portrait.str() + "_sprite";
+        sprite.frames = {3};
+        sprite.size = {0.5, 0.5};
+        sprite.inset = {0.15, 0.15};
+
+        auto character_ref = component::character_ref{};
+        character_ref.player_controlled = false;
+
+        auto prefab = ember::prefab{};
+        prefab.set(component::transform{});
+        prefab.set(std::move(sprite));
+        prefab.set(character_ref);
+        prefab.set(e.base);
+
+        enemy_prefabs.push_back(std::move(prefab));
+    }
+
     // Load player movement cards
     {
         auto loc = glm::vec2{11, 3};
@@ -164,96 +201,127 @@ void scene_gameplay::init() {
     // We want scripts to have access to the entities and other things as a global variables, so they are set here.
     engine->lua["entities"] = std::ref(entities);
     engine->lua["queue_destroy"] = [this](ember::database::ent_id eid) {
-        destroy_queue.push_back(eid);
+        entities.queue_destroy_entity(eid);
     };
 
     engine->lua["tile_at"] = [this](int r, int c) { return std::ref(tile_at(r, c)); };
+    engine->lua["spatial"] = std::ref(spatial);
 
-    // Call the "init" function in the "data/scripts/scenes/gameplay.lua" script, with no params.
-    engine->call_script("scenes.gameplay", "init");
+    entities.set_thread_pool(&engine->workers);
 
-    engine->soloud.stopAll();
-    engine->soloud.play(*engine->music_cache.get("gameplay"));
-}
+    // Systems, in order. Non-exclusive systems run in parallel when their component access does not conflict.
 
-// Tick/update function
-// Performs all necessary game processing based on the delta time.
-// Updates gui_state as necessary.
-// Basically does everything except rendering.
-void scene_gameplay::tick(float delta) {
     // Scripting system
-    engine->call_script("systems.scripting", "visit", delta);
+    systems.add_exclusive_system("scripting", [this](float delta) {
+        engine->call_script("systems.scripting", "visit", delta);
+        entities.flush_commands();
+    });
 
     // Sprite system
-    entities.visit([&](component::sprite& sprite) {
-        sprite.time += delta;
+    systems.add_system("sprite", ember::reads<>{}, ember::writes<component::sprite>{}, [this](float delta) {
+        entities.parallel_visit<component::sprite>([&](ember::database::ent_id, component::sprite& sprite) {
+            sprite.time += delta;
+        });
     });
 
     // Locomotion system
-    entities.visit([&](ember::database::ent_id eid, component::locomotion& loco, component::transform& tform) {
-        if (loco.duration > 0) {
-            auto d = loco.target - tform.pos;
-            auto a = d * delta / loco.duration;
-
-            tform.pos += a;
-            loco.duration -= delta;
-
-            if (loco.duration <= 0) {
-                if (!loco.return_target) {
-                    if (loco.bring_me_peace) {
-                        entities.destroy_entity(eid);
-                    } else {
-                        tform.pos = loco.target;
-                        entities.remove_component<component::locomotion>(eid);
+    systems.add_system(
+        "locomotion",
+        ember::reads<>{},
+        ember::writes<component::locomotion, component::transform>{},
+        [this](float delta) {
+            entities.parallel_visit<component::locomotion, component::transform>([&](
+                ember::database::ent_id eid, component::locomotion& loco, component::transform& tform) {
+                if (loco.duration > 0) {
+                    auto d = loco.target - tform.pos;
+                    auto a = d * delta / loco.duration;
+
+                    tform.pos += a;
+                    loco.duration -= delta;
+                    entities.mark_modified<component::transform>(eid);
+
+                    if (loco.duration <= 0) {
+                        if (!loco.return_target) {
+                            if (loco.bring_me_peace) {
+                                entities.queue_destroy_entity(eid);
+                            } else {
+                                tform.pos = loco.target;
+                                entities.queue_remove_component<component::locomotion>(eid);
+                            }
+                        } else {
+                            loco.return_duration += loco.duration;
+                        }
+                    }
+                } else if (loco.return_target) {
+                    auto d = *loco.return_target - tform.pos;
+                    auto a = d * delta / loco.return_duration;
+
+                    tform.pos += a;
+                    loco.return_duration -= delta;
+                    entities.mark_modified<component::transform>(eid);
+
+                    if (loco.return_duration <= 0) {
+                        if (loco.bring_me_peace) {
+                            entities.queue_destroy_entity(eid);
+                        } else {
+                            tform.pos = *loco.return_target;
+                            entities.queue_remove_component<component::locomotion>(eid);
+                        }
                     }
-                } else {
-                    loco.return_duration += loco.duration;
                 }
-            }
-        } else if (loco.return_target) {
-            auto d = *loco.return_target - tform.pos;
-            auto a = d * delta / loco.return_duration;
+            });
+        });
 
-            tform.pos += a;
-            loco.return_duration -= delta;
+    systems.add_exclusive_system("locomotion_sync", [this](float) {
+        entities.flush_commands();
+    });
 
-            if (loco.return_duration <= 0) {
-                if (loco.bring_me_peace) {
-                    entities.destroy_entity(eid);
-                } else {
-                    tform.pos = *loco.return_target;
-                    entities.remove_component<component::locomotion>(eid);
+    // Turn systems
+    systems.add_exclusive_system("turn", [this](float) {
+        switch (current_turn) {
+            case turn::AUTOPLAYER:
+            case turn::ENEMY_MOVE:
+            case turn::ATTACK:
+            case turn::ENEMY_ATTACK:
+            case turn::RETURN:
+                if (entities.count_components<component::locomotion>() == 0) {
+                    next_turn(true);
                 }
-            }
+                break;
+            case turn::SUMMON:
+            case turn::SET_ACTIONS:
+            case turn::ENEMY_SPAWN:
+                break;
         }
     });
 
-    // Turn systems
-    switch (current_turn) {
-        case turn::AUTOPLAYER:
-        case turn::ENEMY_MOVE:
-        case turn::ATTACK:
-        case turn::ENEMY_ATTACK:
-        case turn::RETURN:
-            if (entities.count_components<component::locomotion>() == 0) {
-                next_turn(true);
-            }
-            break;
-        case turn::SUMMON:
-        case turn::SET_ACTIONS:
-        case turn::ENEMY_SPAWN:
-            break;
-    }
-
     // Dead entity cleanup
-    std::sort(begin(destroy_queue), end(destroy_queue), [](auto& a, auto& b) {
-        return a.get_index() < b.get_index();
+    systems.add_exclusive_system("cleanup", [this](float) {
+        entities.flush_commands();
+
+        // Bring picking up to date with this frame's transform changes
+        spatial.sync<component::transform>(entities, sprite_bounds);
+
+        // Reset per-frame change tracking
+        entities.clear_changes();
     });
-    destroy_queue.erase(std::unique(begin(destroy_queue), end(destroy_queue)), end(destroy_queue));
-    for (const auto& eid : destroy_queue) {
-        entities.destroy_entity(eid);
-    }
-    destroy_queue.clear();
+
+    systems.build();
+
+    // Call the "init" function in the "data/scripts/scenes/gameplay.lua" script, with no params.
+    engine->call_script("scenes.gameplay", "init");
+
+    engine->soloud.stopAll();
+    engine->soloud.play(*engine->music_cache.get("gameplay"));
+}
+
+// Tick/update function
+// Performs all necessary game processing based on the delta time.
+// Updates gui_state as necessary.
+// Basically does everything except rendering.
+void scene_gameplay::tick(float delta) {
+    // Run all systems, see init() for the system list
+    systems.run(engine->workers, delta);
 
     // Update UI props
     gui_state["turn"] = int(current_turn);
@@ -279,10 +347,10 @@ void scene_gameplay::tick(float delta) {
 // The EZ3D helper can be used for efficient 3D rendering, currently there is no equivalent for 2D.
 void scene_gameplay::render() {
     // Set up some OpenGL state. This is mostly copy-pasted and should be self-explanatory.
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LEQUAL);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    ember::gl_state::set_enabled(GL_DEPTH_TEST, true);
+    ember::gl_state::depth_func(GL_LEQUAL);
+    ember::gl_state::set_enabled(GL_BLEND, true);
+    ember::gl_state::blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     //glEnable(GL_SAMPLE_COVERAGE);
     //glEnable(GL_SAMPLE_ALPHA_TO_COVERAGE);
 
@@ -305,25 +373,20 @@ void scene_gameplay::render() {
 
     auto projview = proj * view;
 
-    auto draw_sprite = [&](glm::vec3 pos, glm::vec2 size, const std::string& name, glm::vec2 uv1, glm::vec2 uv2) {
+    auto draw_sprite = [&](glm::vec3 pos, glm::vec2 size, const ember::atom& name, glm::vec2 uv1, glm::vec2 uv2) {
         auto modelmat = glm::mat4(1);
         modelmat = glm::translate(modelmat, pos);
         modelmat = glm::scale(modelmat, {size, 1});
 
         auto uvmat = glm::mat3({uv2.x - uv1.x, 0, 0}, {0, uv2.y - uv1.y, 0}, {uv1.x, uv1.y, 1});
 
-        // Set matrix uniforms.
-        engine->basic_shader.set_uvmat(uvmat);
-        engine->basic_shader.set_normal_mat(glm::inverseTranspose(view * modelmat));
-        engine->basic_shader.set_MVP(projview * modelmat);
-
-        sushi::set_texture(0, *engine->texture_cache.get(name));
-        sushi::draw_mesh(sprite_mesh);
+        sprites.add(name, modelmat, uvmat);
     };
 
     // Render background
     {
-        draw_sprite({0, 0, -10}, {16, 9}, "background", {0, 0}, {1, 1});
+        draw_sprite({0, 0, -10}, {16, 9}, textures::background, {0, 0}, {1, 1});
+        sprites.draw(engine->basic_shader, proj, view, engine->texture_cache);
     }
 
     // Render board
@@ -336,23 +399,23 @@ void scene_gameplay::render() {
         engine->basic_shader.set_normal_mat(glm::inverseTranspose(view * modelmat));
         engine->basic_shader.set_MVP(projview * modelmat);
 
-        sushi::set_texture(0, *engine->texture_cache.get("board"));
-        sushi::draw_mesh(board_mesh);
+        ember::gl_state::bind_texture(0, *engine->texture_cache.get(textures::board));
+        ember::get_render_backend().draw_mesh(board_mesh, nullptr);
     }
 
     // Render board overlays
     {
-        engine->basic_shader.set_tint({1, 1, 1, 0.5});
+        sprites.set_tint({1, 1, 1, 0.5});
         for (int r = 0; r < num_rows; ++r) {
             for (int c = 0; c < num_cols; ++c) {
                 auto& t = tile_at(r, c);
                 if (t.enemy_spawning) {
                     draw_sprite(
-                        glm::vec3{t.center + glm::vec2{-0.5, -0.5}, 5}, {1, 1}, "overlays", {0, 0.25}, {0.25, 0.5});
+                        glm::vec3{t.center + glm::vec2{-0.5, -0.5}, 5}, {1, 1}, textures::overlays, {0, 0.25}, {0.25, 0.5});
                 }
             }
         }
-        engine->basic_shader.set_tint({1, 1, 1, 1});
+        sprites.set_tint({1, 1, 1, 1});
     }
 
     // Render character sheets
@@ -362,24 +425,24 @@ void scene_gameplay::render() {
 
         for (auto& c : player_characters) {
             if (c.dead) {
-                engine->basic_shader.set_saturation(0);
-                engine->basic_shader.set_tint({0.5, 0.5, 0.5, 0.5});
+                sprites.set_saturation(0);
+                sprites.set_tint({0.5, 0.5, 0.5, 0.5});
             }
 
             // Card
-            draw_sprite({c.pos, 1}, c.size, "character_card2", {0, 0}, {card_width_px / 256.f, card_height_px / 256.f});
+            draw_sprite({c.pos, 1}, c.size, textures::character_card2, {0, 0}, {card_width_px / 256.f, card_height_px / 256.f});
 
             // Portrait
             if (!c.dead) {
                 if (c.deployed) {
-                    engine->basic_shader.set_saturation(0);
-                    engine->basic_shader.set_tint({0.5, 0.5, 0.5, 0.5});
+                    sprites.set_saturation(0);
+                    sprites.set_tint({0.5, 0.5, 0.5, 0.5});
                 }
                 draw_sprite(
                     {c.pos + glm::vec2{0, (card_height_px - 64.f) / 64.f}, 2}, {1, 1}, c.base.portrait, {0, 0}, {1, 1});
                 if (c.deployed) {
-                    engine->basic_shader.set_saturation(1);
-                    engine->basic_shader.set_tint({1, 1, 1, 1});
+                    sprites.set_saturation(1);
+                    sprites.set_tint({1, 1, 1, 1});
                 }
             }
 
@@ -392,7 +455,7 @@ void scene_gameplay::render() {
                 auto x = 67.f/64.f;
                 auto y = (card_height_px - 22.f - 21.f*i)/64.f;
                 draw_sprite(
-                    {c.pos + glm::vec2{x, y}, 2}, {0.5, 0.5}, "character_card2", uv1, uv1 + glm::vec2{0.125, 0.125});
+                    {c.pos + glm::vec2{x, y}, 2}, {0.5, 0.5}, textures::character_card2, uv1, uv1 + glm::vec2{0.125, 0.125});
             }
 
             // Power
@@ -401,7 +464,7 @@ void scene_gameplay::render() {
                 auto x = 87.f/64.f;
                 auto y = (card_height_px - 22.f - 21.f*i)/64.f;
                 draw_sprite(
-                    {c.pos + glm::vec2{x, y}, 2}, {0.5, 0.5}, "character_card2", uv1, uv1 + glm::vec2{0.125, 0.125});
+                    {c.pos + glm::vec2{x, y}, 2}, {0.5, 0.5}, textures::character_card2, uv1, uv1 + glm::vec2{0.125, 0.125});
             }
 
             // Attacks
@@ -410,12 +473,12 @@ void scene_gameplay::render() {
                 auto x = (48.f + pattern.x * 21.f)/64.f;
                 auto y = (45.f + pattern.y * 20.f)/64.f;
                 draw_sprite(
-                    {c.pos + glm::vec2{x, y}, 2}, {0.5, 0.5}, "character_card2", uv1, uv1 + glm::vec2{0.125, 0.125});
+                    {c.pos + glm::vec2{x, y}, 2}, {0.5, 0.5}, textures::character_card2, uv1, uv1 + glm::vec2{0.125, 0.125});
             }
 
             if (c.dead) {
-                engine->basic_shader.set_saturation(1);
-                engine->basic_shader.set_tint({1, 1, 1, 1});
+                sprites.set_saturation(1);
+                sprites.set_tint({1, 1, 1, 1});
             }
         }
     }
@@ -436,17 +499,11 @@ void scene_gameplay::render() {
             auto uvd = glm::vec2{3.f/256.f, 13.f/256.f};
             auto uvmat = glm::mat3({uvd.x, 0, 0}, {0, uvd.y, 0}, {uv1.x, uv1.y, 1});
 
-            // Set matrix uniforms.
-            engine->basic_shader.set_uvmat(uvmat);
-            engine->basic_shader.set_normal_mat(glm::inverseTranspose(view * modelmat));
-            engine->basic_shader.set_MVP(projview * modelmat);
-
-            sushi::set_texture(0, *engine->texture_cache.get("character_card2"));
-            sushi::draw_mesh(sprite_mesh);
+            sprites.add(textures::character_card2, modelmat, uvmat);
         };
 
     auto render_movement_card = [&](const glm::vec3& loc, const glm::vec2& size, const movement_card& c) {
-        draw_sprite(loc, size, "character_card2", {0.f, 170.f / 256.f}, {65.f / 256.f, 1.f});
+        draw_sprite(loc, size, textures::character_card2, {0.f, 170.f / 256.f}, {65.f / 256.f, 1.f});
 
         auto pos = loc + glm::vec3{23.f / 64.f, 2.f / 64.f, 1};
         auto offs = glm::vec3{21.f / 64.f, 21.f / 64.f, 0};
@@ -465,7 +522,7 @@ void scene_gameplay::render() {
                 uvoffs = {0.375, 0};
             }
 
-            draw_sprite(pos, {0.5f, 0.5f}, "character_card2", uv1 + uvoffs, uv1 + uvoffs + uvd);
+            draw_sprite(pos, {0.5f, 0.5f}, textures::character_card2, uv1 + uvoffs, uv1 + uvoffs + uvd);
 
             uv1.y = 0.375f;
 
@@ -500,13 +557,13 @@ void scene_gameplay::render() {
                 }
 
                 if (!c.pickable) {
-                    engine->basic_shader.set_tint({0.5, 0.5, 0.5, 0.5});
+                    sprites.set_tint({0.5, 0.5, 0.5, 0.5});
                 }
 
                 render_movement_card(loc, c.size, *c.data);
 
                 if (!c.pickable) {
-                    engine->basic_shader.set_tint({1, 1, 1, 1});
+                    sprites.set_tint({1, 1, 1, 1});
                 }
             }
         }
@@ -515,7 +572,6 @@ void scene_gameplay::render() {
     // Render entities
     entities.visit([&](ember::database::ent_id eid, component::sprite& sprite, const component::transform& transform) {
         auto modelmat = to_mat4(transform);
-        auto tex = engine->texture_cache.get(sprite.texture);
 
         // Calculate UV matrix for rendering the correct sprite.
         auto cols = int(1 / sprite.size.x);
@@ -525,18 +581,7 @@ void scene_gameplay::render() {
         uvmat = glm::translate(uvmat, uvoffset);
         uvmat = glm::scale(uvmat, sprite.size - 2.f * sprite.inset * sprite.size);
 
-        // Set matrix uniforms.
-        engine->basic_shader.set_uvmat(uvmat);
-        engine->basic_shader.set_normal_mat(glm::inverseTranspose(view * modelmat));
-        engine->basic_shader.set_MVP(projview * modelmat);
-
-        if (tex) {
-            sushi::set_texture(0, *tex);
-        } else {
-            std::cout << "Warning: Texture not found: " << sprite.texture << std::endl;
-        }
-        
-        sushi::draw_mesh(sprite_mesh);
+        sprites.add(sprite.texture, modelmat, uvmat);
 
         if (auto cref = entities.get_component<component::character_ref*>(eid)) {
             // Health
@@ -550,7 +595,7 @@ void scene_gameplay::render() {
                 draw_sprite(
                     transform.pos + glm::vec3{x, y, 1},
                     {0.5, 0.5},
-                    "character_card2",
+                    textures::character_card2,
                     uv1,
                     uv1 + glm::vec2{0.125, 0.125});
             }
@@ -569,22 +614,32 @@ void scene_gameplay::render() {
                     auto pos = transform.pos;
                     pos.z += 1;
 
-                    engine->basic_shader.set_tint({1, 1, 1, 0.5});
-                    draw_sprite(pos, {1, 1}, "overlays", uv1, uv1 + glm::vec2{0.25, 0.25});
-                    engine->basic_shader.set_tint({1, 1, 1, 1});
+                    sprites.set_tint({1, 1, 1, 0.5});
+                    draw_sprite(pos, {1, 1}, textures::overlays, uv1, uv1 + glm::vec2{0.25, 0.25});
+                    sprites.set_tint({1, 1, 1, 1});
                 }
             }
+        }
+    });
+
+    // Render movement card of hovered units
+    {
+        auto hovered = std::vector<ember::database::ent_id>{};
+        spatial.query_point(mouse, hovered);
 
-            // Render movement card
-            if (is_in(mouse, transform.pos, {1, 1})) {
-                auto pos = transform.pos + glm::vec3{1, 1, 1};
+        for (auto eid : hovered) {
+            if (auto cref = entities.get_component<component::character_ref*>(eid)) {
+                auto pos = entities.get_component<component::transform>(eid).pos + glm::vec3{1, 1, 1};
                 if (pos.y > 9.f - 86.f/64.f) {
                     pos.y = 9.f - 86.f/64.f;
                 }
                 render_movement_card(pos, glm::vec2{65.f / 64.f, 86.f / 64.f}, *cref->m);
             }
         }
-    });
+    }
+
+    // Draw everything queued since the board, back to front
+    sprites.draw(engine->basic_shader, proj, view, engine->texture_cache);
 }
 
 // Handle input events, called asynchronously
@@ -639,18 +694,22 @@ auto scene_gameplay::handle_game_input(const SDL_Event& event) -> bool {
 
         // Check unit state toggling
         if (current_turn == turn::SET_ACTIONS) {
-            entities.visit([&](component::character_ref& cref, const component::transform& tform) {
-                if (cref.player_controlled && p.x >= tform.pos.x && p.x <= tform.pos.x + 1 && p.y >= tform.pos.y && p.y <= tform.pos.y + 1) {
-                    switch (cref.a) {
+            auto picked = std::vector<ember::database::ent_id>{};
+            spatial.query_point(p, picked);
+
+            for (auto eid : picked) {
+                auto cref = entities.get_component<component::character_ref*>(eid);
+                if (cref && cref->player_controlled) {
+                    switch (cref->a) {
                         case component::character_ref::PAUSE:
-                            cref.a = component::character_ref::PLAY;
+                            cref->a = component::character_ref::PLAY;
                             break;
                         case component::character_ref::PLAY:
-                            cref.a = component::character_ref::PAUSE;
+                            cref->a = component::character_ref::PAUSE;
                             break;
                     }
                 }
-            });
+            }
         }
 
         return false;
@@ -680,7 +739,7 @@ auto scene_gameplay::handle_game_input(const SDL_Event& event) -> bool {
                         cref->m = card.data;
                         cref->player_controlled = true;
                         cref->did_move = true;
-                        sref->texture = cref->c->portrait + "_sprite";
+                        sref->texture = cref->c->portrait.str() + "_sprite";
                         sref->size = {0.5, 0.5};
                         sref->inset = {0.15, 0.15};
                         sref->frames = {0};
@@ -1071,29 +1130,42 @@ void scene_gameplay::enemy_ai() {
 }
 
 void scene_gameplay::spawn_enemy() {
-    // Spawn previous incoming
+    // Spawn previous incoming, one batch per enemy type
+    auto incoming = std::vector<std::vector<board_tile*>>(enemy_characters.size());
+
     for (auto r = 0; r < num_rows; ++r) {
         for (auto c = 0; c < num_cols; ++c) {
             auto& tile = tile_at(r, c);
             if (tile.enemy_spawning && !tile.occupant) {
-                auto i = tile.spawn_enemy_id;
-                auto& e = enemy_characters[i];
-
-                auto [eid, cref, sref] = spawn_entity(r, c);
-                auto cid = entities.add_component(eid, enemy_characters[i].base);
-                cref->c = &entities.get_component_by_id<character>(cid);
-                cref->m = &enemy_movement_cards[tile.spawn_move_id];
-                cref->player_controlled = false;
-                sref->texture = e.base.portrait + "_sprite";
-                sref->frames = {3};
-                sref->size = {0.5, 0.5};
-                sref->inset = {0.15, 0.15};
-
-                tile.enemy_spawning = false;
+                incoming[tile.spawn_enemy_id].push_back(&tile);
             }
         }
     }
 
+    for (std::size_t i = 0; i < incoming.size(); ++i) {
+        if (incoming[i].empty()) {
+            continue;
+        }
+
+        auto eids = entities.instantiate(enemy_prefabs[i], int(incoming[i].size()));
+
+        for (std::size_t k = 0; k < eids.size(); ++k) {
+            auto& tile = *incoming[i][k];
+            auto eid = eids[k];
+
+            auto& transform = entities.get_component<component::transform>(eid);
+            transform.pos = {tile.center - glm::vec2{0.5, 0.5}, 1};
+
+            auto& cref = entities.get_component<component::character_ref>(eid);
+            cref.c = &entities.get_component<character>(eid);
+            cref.m = &enemy_movement_cards[tile.spawn_move_id];
+            cref.board_pos = glm::ivec2{tile.c, tile.r};
+
+            tile.occupant = eid;
+            tile.enemy_spawning = false;
+        }
+    }
+
     // Count
     int enemy_count = 0;
     entities.visit([&](component::character_ref& c) {
@@ -1145,6 +1217,46 @@ void scene_gameplay::spawn_enemy() {
     }
 }
 
+namespace { // static
+
+using snapshot_components = std::tuple<
+    ember::reflection::tag<component::script>,
+    ember::reflection::tag<component::transform>,
+    ember::reflection::tag<component::sprite>,
+    ember::reflection::tag<component::character_ref>,
+    ember::reflection::tag<component::locomotion>,
+    ember::reflection::tag<character>>;
+
+} // static
+
+auto scene_gameplay::save_snapshot() -> std::vector<char> {
+    return ember::snapshot::save(entities, snapshot_components{});
+}
+
+void scene_gameplay::load_snapshot(const std::vector<char>& data) {
+    ember::snapshot::load(entities, {data.data(), data.size()}, snapshot_components{});
+
+    // Enemy characters live in their own component, so the old pointers are gone
+    entities.visit([&](component::character_ref& cref, character& c) {
+        cref.c = &c;
+    });
+
+    // Entity ids do not survive a restore, so neither do occupants or the picking grid
+    spatial.clear();
+    entities.visit([&](ember::database::ent_id eid, const component::transform& tform) {
+        spatial.update(eid, sprite_bounds(tform));
+    });
+
+    for (auto& t : tiles) {
+        t.occupant = std::nullopt;
+    }
+    entities.visit([&](ember::database::ent_id eid, const component::character_ref& cref) {
+        if (cref.board_pos) {
+            tile_at(*cref.board_pos).occupant = eid;
+        }
+    });
+}
+
 bool scene_gameplay::damage(ember::database::ent_id eid, component::character_ref& cref, int dmg) {
     cref.c->health -= dmg;
     if (cref.c->health <= 0) {
@@ -7,7 +7,11 @@
 #include "ember/box2d_helpers.hpp"
 #include "ember/camera.hpp"
 #include "ember/entities.hpp"
+#include "ember/prefab.hpp"
+#include "ember/scheduler.hpp"
 #include "ember/scene.hpp"
+#include "ember/spatial_grid.hpp"
+#include "ember/sprite_batch.hpp"
 
 #include <sushi/sushi.hpp>
 #include <sol.hpp>
@@ -101,6 +105,12 @@ public:
 
     bool damage(ember::database::ent_id eid, component::character_ref& cref, int dmg);
 
+    /** Captures all entities, for autosave and rewind within this scene instance */
+    auto save_snapshot() -> std::vector<char>;
+
+    /** Restores entities captured by save_snapshot(), relinking enemy characters and board occupants */
+    void load_snapshot(const std::vector<char>& data);
+
     struct stats {
         int enemies_spawned;
         int turn_count;
@@ -112,9 +122,10 @@ public:
 private:
     ember::camera::orthographic camera;
     ember::database entities;
+    ember::scheduler systems;
+    ember::spatial_grid spatial;
     sol::table gui_state;
-    sushi::mesh_group sprite_mesh;
-    std::vector<ember::database::ent_id> destroy_queue;
+    ember::sprite_batch sprites;
 
     std::vector<board_tile> tiles;
     int num_rows;
@@ -125,6 +136,7 @@ private:
 
     std::vector<player_character_card> player_characters;
     std::vector<enemy_character> enemy_characters;
+    std::vector<ember::prefab> enemy_prefabs; /** One per enemy character */
 
     std::vector<movement_card> movement_cards;
     std::vector<movement_card> enemy_movement_cards;
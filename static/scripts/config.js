@@ -4,6 +4,10 @@ var EmberConfig = (function(){
         display: {
             width: 1920,
             height: 1080
+        },
+        render_check: {
+            enabled: params.has('render_check'),
+            expected_hash: params.get('render_check') || ''
         }
     };
 })();
@@ -0,0 +1,443 @@
+#include "font_format.hpp"
+
+#include <msdfgen.h>
+#include <msdfgen-ext.h>
+#include <core/simd.h>
+#include <lodepng.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Pre-renders glyph ranges of a TTF into an MSDF atlas image and a binary metrics and kerning table.
+// Glyphs are rasterized with the same scale, range and border as msdf_font does at runtime, so cooked and
+// runtime glyphs are interchangeable.
+// With --benchmark, times the per-pixel and batched distance field generators over the glyph ranges instead.
+
+namespace {
+
+namespace font_format = ember::font_format;
+
+constexpr double px_range = 4.0;
+constexpr int padding = 1;
+
+struct options {
+    std::string font_file;
+    std::string out_dir;
+    std::string name;
+    std::vector<std::pair<int, int>> ranges = {{32, 126}};
+    int page_size = 512;
+    int threads = int(std::max(std::thread::hardware_concurrency(), 1u));
+    bool benchmark = false;
+};
+
+struct shaped_glyph {
+    msdfgen::Shape shape;
+    double advance;
+    double left, bottom, right, top;
+    int width, height;
+};
+
+struct cooked_glyph {
+    font_format::glyph metrics;
+    std::vector<unsigned char> pixels; /** RGBA, bottom row first */
+};
+
+struct font_deleter {
+    void operator()(msdfgen::FontHandle* ptr) { msdfgen::destroyFont(ptr); }
+};
+
+auto parse_ranges(const std::string& str) -> std::vector<std::pair<int, int>> {
+    auto ranges = std::vector<std::pair<int, int>>{};
+    auto pos = std::size_t{0};
+
+    while (pos < str.size()) {
+        auto end = std::min(str.find(',', pos), str.size());
+        auto item = str.substr(pos, end - pos);
+        auto dash = item.find('-');
+
+        if (dash == std::string::npos) {
+            auto c = std::stoi(item, nullptr, 0);
+            ranges.emplace_back(c, c);
+        } else {
+            ranges.emplace_back(std::stoi(item.substr(0, dash), nullptr, 0), std::stoi(item.substr(dash + 1), nullptr, 0));
+        }
+
+        pos = end + 1;
+    }
+
+    return ranges;
+}
+
+auto parse_options(int argc, char* argv[]) -> options {
+    auto opts = options{};
+    auto positional = std::vector<std::string>{};
+
+    for (int i = 1; i < argc; ++i) {
+        auto arg = std::string(argv[i]);
+        auto next = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Missing value for " + arg + ".");
+            }
+            return argv[++i];
+        };
+
+        if (arg == "--name") {
+            opts.name = next();
+        } else if (arg == "--ranges") {
+            opts.ranges = parse_ranges(next());
+        } else if (arg == "--page-size") {
+            opts.page_size = std::stoi(next());
+        } else if (arg == "--threads") {
+            opts.threads = std::max(std::stoi(next()), 1);
+        } else if (arg == "--benchmark") {
+            opts.benchmark = true;
+        } else {
+            positional.push_back(arg);
+        }
+    }
+
+    if (positional.size() != (opts.benchmark ? 1 : 2)) {
+        throw std::invalid_argument(
+            "Usage: cook_font <font.ttf> <outdir> [--name NAME] [--ranges 32-126,160-255] [--page-size 512] "
+            "[--threads N]\n"
+            "       cook_font <font.ttf> --benchmark [--ranges 32-126,160-255] [--threads N]");
+    }
+
+    opts.font_file = positional[0];
+    opts.out_dir = opts.benchmark ? "" : positional[1];
+
+    if (opts.name.empty()) {
+        auto base = opts.font_file.substr(opts.font_file.find_last_of("/\\") + 1);
+        opts.name = base.substr(0, base.find_last_of('.'));
+    }
+
+    return opts;
+}
+
+auto shape_glyph(msdfgen::FontHandle* font, int codepoint) -> std::optional<shaped_glyph> {
+    auto g = shaped_glyph{};
+
+    if (!msdfgen::loadGlyph(g.shape, font, codepoint, &g.advance)) {
+        return std::nullopt;
+    }
+
+    g.shape.normalize();
+    msdfgen::edgeColoringSimple(g.shape, 3.0);
+
+    g.left = g.bottom = g.right = g.top = 0;
+    g.shape.bounds(g.left, g.bottom, g.right, g.top);
+
+    g.left -= 1;
+    g.bottom -= 1;
+    g.right += 1;
+    g.top += 1;
+
+    g.width = int(g.right - g.left + 1);
+    g.height = int(g.top - g.bottom + 1);
+
+    return g;
+}
+
+// Same output as msdfgen::generateMSDF, with the rows split across threads
+void generate_msdf(msdfgen::Bitmap<msdfgen::FloatRGB>& msdf, const shaped_glyph& g, int threads) {
+    auto translate = msdfgen::Vector2(-g.left, -g.bottom);
+    auto chunk = (g.height + threads - 1) / threads;
+    auto workers = std::vector<std::thread>{};
+
+    for (int row = chunk; row < g.height; row += chunk) {
+        workers.emplace_back([&, row] {
+            msdfgen::generateMSDFRows(msdf, g.shape, px_range, 1.0, translate, row, std::min(row + chunk, g.height));
+        });
+    }
+
+    msdfgen::generateMSDFRows(msdf, g.shape, px_range, 1.0, translate, 0, std::min(chunk, g.height));
+
+    for (auto& t : workers) {
+        t.join();
+    }
+
+    msdfgen::msdfErrorCorrection(msdf, 1.00000001 / (msdfgen::Vector2(1.0) * px_range));
+}
+
+auto cook_glyph(msdfgen::FontHandle* font, double em, int codepoint, int threads) -> std::optional<cooked_glyph> {
+    auto shaped = shape_glyph(font, codepoint);
+
+    if (!shaped) {
+        return std::nullopt;
+    }
+
+    auto width = shaped->width;
+    auto height = shaped->height;
+
+    msdfgen::Bitmap<msdfgen::FloatRGB> msdf(width, height);
+    generate_msdf(msdf, *shaped, threads);
+
+    auto g = cooked_glyph{};
+    g.pixels.reserve(4 * width * height);
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            g.pixels.push_back(msdfgen::clamp(msdf(x, y).r * 256.f, 255.f));
+            g.pixels.push_back(msdfgen::clamp(msdf(x, y).g * 256.f, 255.f));
+            g.pixels.push_back(msdfgen::clamp(msdf(x, y).b * 256.f, 255.f));
+            g.pixels.push_back(255);
+        }
+    }
+
+    g.metrics.codepoint = std::uint32_t(codepoint);
+    g.metrics.advance = float(shaped->advance / em);
+    g.metrics.left = float(shaped->left / em);
+    g.metrics.bottom = float(shaped->bottom / em);
+    g.metrics.right = float(shaped->right / em);
+    g.metrics.top = float(shaped->top / em);
+    g.metrics.width = std::uint16_t(width);
+    g.metrics.height = std::uint16_t(height);
+
+    return g;
+}
+
+// Shelf packing, tallest first, returns the used height
+int pack(std::vector<cooked_glyph>& glyphs, int page_size) {
+    auto order = std::vector<std::size_t>(glyphs.size());
+    std::iota(begin(order), end(order), 0);
+    std::stable_sort(begin(order), end(order), [&](std::size_t a, std::size_t b) {
+        return glyphs[a].metrics.height > glyphs[b].metrics.height;
+    });
+
+    auto x = 0;
+    auto y = 0;
+    auto shelf_height = 0;
+
+    for (auto i : order) {
+        auto& m = glyphs[i].metrics;
+        auto w = m.width + padding;
+        auto h = m.height + padding;
+
+        if (x + w > page_size) {
+            x = 0;
+            y += shelf_height;
+            shelf_height = 0;
+        }
+
+        if (w > page_size || y + h > page_size) {
+            throw std::runtime_error("Glyphs do not fit in a " + std::to_string(page_size) + " page.");
+        }
+
+        m.x = std::uint16_t(x);
+        m.y = std::uint16_t(y);
+        x += w;
+        shelf_height = std::max(shelf_height, h);
+    }
+
+    return y + shelf_height;
+}
+
+int next_pow2(int n) {
+    auto p = 1;
+    while (p < n) {
+        p *= 2;
+    }
+    return p;
+}
+
+void write_all(std::FILE* file, const void* data, std::size_t size) {
+    if (size > 0 && std::fwrite(data, size, 1, file) != 1) {
+        throw std::runtime_error("Failed to write font file.");
+    }
+}
+
+auto load_font(const options& opts) -> std::unique_ptr<msdfgen::FontHandle, font_deleter> {
+    auto ft = msdfgen::initializeFreetype();
+
+    if (!ft) {
+        throw std::runtime_error("Failed to initialize FreeType.");
+    }
+
+    auto font = std::unique_ptr<msdfgen::FontHandle, font_deleter>(msdfgen::loadFont(ft, opts.font_file.c_str()));
+
+    if (!font) {
+        throw std::runtime_error("Failed to load font " + opts.font_file + ".");
+    }
+
+    return font;
+}
+
+auto get_codepoints(const options& opts) -> std::vector<int> {
+    // Codepoint 0 is the missing glyph fallback
+    auto codepoints = std::vector<int>{0};
+    for (auto [first, last] : opts.ranges) {
+        for (auto c = first; c <= last; ++c) {
+            codepoints.push_back(c);
+        }
+    }
+    std::sort(begin(codepoints), end(codepoints));
+    codepoints.erase(std::unique(begin(codepoints), end(codepoints)), end(codepoints));
+
+    return codepoints;
+}
+
+void cook(const options& opts) {
+    auto font = load_font(opts);
+
+    double em;
+    msdfgen::getFontScale(em, font.get());
+
+    auto codepoints = get_codepoints(opts);
+
+    auto glyphs = std::vector<cooked_glyph>{};
+    for (auto c : codepoints) {
+        if (auto g = cook_glyph(font.get(), em, c, opts.threads)) {
+            glyphs.push_back(std::move(*g));
+        }
+    }
+
+    auto atlas_width = opts.page_size;
+    auto atlas_height = next_pow2(pack(glyphs, opts.page_size));
+    auto atlas = std::vector<unsigned char>(std::size_t(atlas_width) * atlas_height * 4, 0);
+
+    for (const auto& g : glyphs) {
+        const auto& m = g.metrics;
+        for (int row = 0; row < m.height; ++row) {
+            auto src = &g.pixels[std::size_t(row) * m.width * 4];
+            auto dst = &atlas[(std::size_t(m.y + row) * atlas_width + m.x) * 4];
+            std::memcpy(dst, src, std::size_t(m.width) * 4);
+        }
+    }
+
+    auto kerning = std::vector<font_format::kerning>{};
+    for (const auto& a : glyphs) {
+        for (const auto& b : glyphs) {
+            double amount = 0;
+            if (msdfgen::getKerning(amount, font.get(), int(a.metrics.codepoint), int(b.metrics.codepoint)) &&
+                amount != 0) {
+                kerning.push_back({a.metrics.codepoint, b.metrics.codepoint, float(amount / em)});
+            }
+        }
+    }
+
+    auto base = opts.out_dir + "/" + opts.name;
+
+    if (auto error = lodepng::encode(base + ".png", atlas, unsigned(atlas_width), unsigned(atlas_height))) {
+        throw std::runtime_error("Failed to write " + base + ".png: " + lodepng_error_text(error));
+    }
+
+    auto header = font_format::header{};
+    std::memcpy(header.magic, font_format::magic, sizeof(header.magic));
+    header.version = font_format::version;
+    header.px_range = float(px_range);
+    header.atlas_width = std::uint32_t(atlas_width);
+    header.atlas_height = std::uint32_t(atlas_height);
+    header.glyph_count = std::uint32_t(glyphs.size());
+    header.kerning_count = std::uint32_t(kerning.size());
+
+    auto metrics = std::vector<font_format::glyph>{};
+    metrics.reserve(glyphs.size());
+    for (const auto& g : glyphs) {
+        metrics.push_back(g.metrics);
+    }
+
+    auto file = std::unique_ptr<std::FILE, int (*)(std::FILE*)>(std::fopen((base + ".font").c_str(), "wb"), &std::fclose);
+
+    if (!file) {
+        throw std::runtime_error("Failed to open " + base + ".font for writing.");
+    }
+
+    write_all(file.get(), &header, sizeof(header));
+    write_all(file.get(), metrics.data(), metrics.size() * sizeof(font_format::glyph));
+    write_all(file.get(), kerning.data(), kerning.size() * sizeof(font_format::kerning));
+
+    std::cout << opts.name << ": " << glyphs.size() << " glyphs, " << kerning.size() << " kerning pairs, "
+              << atlas_width << "x" << atlas_height << " atlas" << std::endl;
+}
+
+// Generates every glyph with the per-pixel reference, the batched generator and the batched generator on all threads
+void benchmark(const options& opts) {
+    using clock = std::chrono::steady_clock;
+
+    auto font = load_font(opts);
+
+    auto glyphs = std::vector<shaped_glyph>{};
+    for (auto c : get_codepoints(opts)) {
+        if (auto g = shape_glyph(font.get(), c)) {
+            glyphs.push_back(std::move(*g));
+        }
+    }
+
+    auto pixels = 0;
+    for (const auto& g : glyphs) {
+        pixels += g.width * g.height;
+    }
+
+    auto reference = std::vector<msdfgen::Bitmap<msdfgen::FloatRGB>>{};
+    reference.reserve(glyphs.size());
+
+    auto time = [&](const char* name, auto&& generate) {
+        auto max_error = 0.f;
+        auto start = clock::now();
+
+        for (std::size_t i = 0; i < glyphs.size(); ++i) {
+            const auto& g = glyphs[i];
+            msdfgen::Bitmap<msdfgen::FloatRGB> msdf(g.width, g.height);
+            generate(msdf, g);
+
+            if (reference.size() < glyphs.size()) {
+                reference.push_back(msdf);
+                continue;
+            }
+
+            for (int y = 0; y < g.height; ++y) {
+                for (int x = 0; x < g.width; ++x) {
+                    const auto& a = msdf(x, y);
+                    const auto& b = reference[i](x, y);
+                    max_error = std::max({max_error, std::abs(a.r - b.r), std::abs(a.g - b.g), std::abs(a.b - b.b)});
+                }
+            }
+        }
+
+        auto ms = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+        std::printf("%-24s %10.2f ms %10.3f us/glyph   max error %g\n", name, ms, ms * 1000 / glyphs.size(), max_error);
+    };
+
+    std::printf("%s: %zu glyphs, %d pixels, %d lanes\n", opts.font_file.c_str(), glyphs.size(), pixels, MSDFGEN_SIMD_LANES);
+
+    time("per-pixel", [](auto& msdf, const shaped_glyph& g) {
+        msdfgen::generateMSDF_scalar(msdf, g.shape, px_range, 1.0, msdfgen::Vector2(-g.left, -g.bottom));
+    });
+    time("batched", [](auto& msdf, const shaped_glyph& g) {
+        msdfgen::generateMSDF(msdf, g.shape, px_range, 1.0, msdfgen::Vector2(-g.left, -g.bottom));
+    });
+
+    auto threaded_name = "batched, " + std::to_string(opts.threads) + " threads";
+    time(threaded_name.c_str(), [&](auto& msdf, const shaped_glyph& g) { generate_msdf(msdf, g, opts.threads); });
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    try {
+        auto opts = parse_options(argc, argv);
+
+        if (opts.benchmark) {
+            benchmark(opts);
+        } else {
+            cook(opts);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "ERROR: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
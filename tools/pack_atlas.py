@@ -0,0 +1,228 @@
+import os, struct, zlib, json
+import argparse
+
+# Packs small PNG textures into atlas pages and writes a name -> (page, uv rect) table.
+# Only uses the standard library, so it runs anywhere the data packager does.
+
+parser = argparse.ArgumentParser()
+parser.add_argument('outdir', help='directory receiving the atlas pages and table')
+parser.add_argument('textures', nargs='*', help='source PNG files, the texture name is the file name without extension')
+parser.add_argument('--name', default='atlas', help='base name of the pages and table')
+parser.add_argument('--page-size', type=int, default=2048, help='maximum page width and height')
+parser.add_argument('--max-size', type=int, default=512, help='larger textures are left unpacked')
+parser.add_argument('--padding', type=int, default=1, help='edge pixels repeated around each texture')
+args = parser.parse_args()
+
+PNG_SIGNATURE = b'\x89PNG\r\n\x1a\n'
+
+class Image:
+    def __init__(self, width, height, pixels=None):
+        self.width = width
+        self.height = height
+        self.pixels = pixels if pixels is not None else bytearray(width * height * 4)
+
+    def get(self, x, y):
+        i = (y * self.width + x) * 4
+        return self.pixels[i:i + 4]
+
+    def set(self, x, y, rgba):
+        i = (y * self.width + x) * 4
+        self.pixels[i:i + 4] = rgba
+
+def read_chunks(data):
+    pos = len(PNG_SIGNATURE)
+    while pos < len(data):
+        length, ctype = struct.unpack('>I4s', data[pos:pos + 8])
+        yield ctype, data[pos + 8:pos + 8 + length]
+        pos += length + 12
+
+def paeth(a, b, c):
+    p = a + b - c
+    pa, pb, pc = abs(p - a), abs(p - b), abs(p - c)
+    if pa <= pb and pa <= pc:
+        return a
+    if pb <= pc:
+        return b
+    return c
+
+def unfilter(raw, width, height, bpp):
+    stride = width * bpp
+    out = bytearray(stride * height)
+    prev = bytearray(stride)
+    pos = 0
+    for y in range(height):
+        ftype = raw[pos]
+        line = bytearray(raw[pos + 1:pos + 1 + stride])
+        pos += 1 + stride
+        if ftype == 1:
+            for i in range(bpp, stride):
+                line[i] = (line[i] + line[i - bpp]) & 0xff
+        elif ftype == 2:
+            for i in range(stride):
+                line[i] = (line[i] + prev[i]) & 0xff
+        elif ftype == 3:
+            for i in range(stride):
+                left = line[i - bpp] if i >= bpp else 0
+                line[i] = (line[i] + ((left + prev[i]) >> 1)) & 0xff
+        elif ftype == 4:
+            for i in range(stride):
+                left = line[i - bpp] if i >= bpp else 0
+                upleft = prev[i - bpp] if i >= bpp else 0
+                line[i] = (line[i] + paeth(left, prev[i], upleft)) & 0xff
+        elif ftype != 0:
+            raise ValueError('unknown PNG filter {}'.format(ftype))
+        out[y * stride:(y + 1) * stride] = line
+        prev = line
+    return out
+
+def load_png(path):
+    with open(path, 'rb') as f:
+        data = f.read()
+
+    if not data.startswith(PNG_SIGNATURE):
+        raise ValueError('{}: not a PNG file'.format(path))
+
+    idat = bytearray()
+    palette = None
+    transparency = None
+
+    for ctype, chunk in read_chunks(data):
+        if ctype == b'IHDR':
+            width, height, depth, color, _, _, interlace = struct.unpack('>IIBBBBB', chunk)
+        elif ctype == b'PLTE':
+            palette = chunk
+        elif ctype == b'tRNS':
+            transparency = chunk
+        elif ctype == b'IDAT':
+            idat += chunk
+
+    if depth != 8 or interlace != 0:
+        raise ValueError('{}: only 8 bit non-interlaced PNGs are supported'.format(path))
+
+    channels = {0: 1, 2: 3, 3: 1, 4: 2, 6: 4}[color]
+    raw = unfilter(zlib.decompress(bytes(idat)), width, height, channels)
+
+    image = Image(width, height)
+    for i in range(width * height):
+        px = raw[i * channels:(i + 1) * channels]
+        if color == 0:
+            rgba = (px[0], px[0], px[0], 255)
+        elif color == 2:
+            rgba = (px[0], px[1], px[2], 255)
+        elif color == 3:
+            index = px[0]
+            alpha = transparency[index] if transparency is not None and index < len(transparency) else 255
+            rgba = (palette[index * 3], palette[index * 3 + 1], palette[index * 3 + 2], alpha)
+        elif color == 4:
+            rgba = (px[0], px[0], px[0], px[1])
+        else:
+            rgba = tuple(px)
+        image.pixels[i * 4:(i + 1) * 4] = bytes(rgba)
+
+    return image
+
+def save_png(path, image):
+    def chunk(ctype, payload):
+        crc = zlib.crc32(ctype + payload) & 0xffffffff
+        return struct.pack('>I', len(payload)) + ctype + payload + struct.pack('>I', crc)
+
+    stride = image.width * 4
+    raw = bytearray()
+    for y in range(image.height):
+        raw.append(0)
+        raw += image.pixels[y * stride:(y + 1) * stride]
+
+    header = struct.pack('>IIBBBBB', image.width, image.height, 8, 6, 0, 0, 0)
+
+    with open(path, 'wb') as f:
+        f.write(PNG_SIGNATURE)
+        f.write(chunk(b'IHDR', header))
+        f.write(chunk(b'IDAT', zlib.compress(bytes(raw), 9)))
+        f.write(chunk(b'IEND', b''))
+
+def next_pow2(n):
+    p = 1
+    while p < n:
+        p *= 2
+    return p
+
+# Shelf packing, tallest first so each shelf wastes little height
+def pack(sizes, page_size):
+    order = sorted(range(len(sizes)), key=lambda i: (-sizes[i][1], -sizes[i][0]))
+    placements = [None] * len(sizes)
+    pages = []
+
+    for i in order:
+        w, h = sizes[i]
+        if w > page_size or h > page_size:
+            raise ValueError('texture of {}x{} does not fit in a page'.format(w, h))
+
+        placed = False
+        for page_index, page in enumerate(pages):
+            shelf = page['shelves'][-1]
+            if shelf['x'] + w <= page_size and h <= shelf['height']:
+                placements[i] = (page_index, shelf['x'], shelf['y'])
+                shelf['x'] += w
+                placed = True
+                break
+            top = shelf['y'] + shelf['height']
+            if top + h <= page_size:
+                page['shelves'].append({'x': w, 'y': top, 'height': h})
+                placements[i] = (page_index, 0, top)
+                placed = True
+                break
+
+        if not placed:
+            pages.append({'shelves': [{'x': w, 'y': 0, 'height': h}]})
+            placements[i] = (len(pages) - 1, 0, 0)
+
+    return placements, len(pages)
+
+def blit_padded(dst, src, x, y, padding):
+    for sy in range(-padding, src.height + padding):
+        cy = min(max(sy, 0), src.height - 1)
+        for sx in range(-padding, src.width + padding):
+            cx = min(max(sx, 0), src.width - 1)
+            dst.set(x + padding + sx, y + padding + sy, src.get(cx, cy))
+
+def main():
+    textures = []
+    for path in sorted(args.textures):
+        image = load_png(path)
+        if image.width > args.max_size or image.height > args.max_size:
+            continue
+        name = os.path.splitext(os.path.basename(path))[0]
+        textures.append((name, image))
+
+    pad = args.padding
+    sizes = [(image.width + pad * 2, image.height + pad * 2) for _, image in textures]
+    placements, page_count = pack(sizes, args.page_size)
+
+    # Pages are trimmed to power of two sizes, WebGL 1 cannot repeat or mipmap other sizes
+    extents = [[1, 1] for _ in range(page_count)]
+    for (w, h), (page, x, y) in zip(sizes, placements):
+        extents[page][0] = max(extents[page][0], x + w)
+        extents[page][1] = max(extents[page][1], y + h)
+
+    page_names = ['{}{}'.format(args.name, i) for i in range(page_count)]
+    pages = [Image(next_pow2(w), next_pow2(h)) for w, h in extents]
+
+    regions = {}
+    for (name, image), (page, x, y) in zip(textures, placements):
+        blit_padded(pages[page], image, x, y, pad)
+        pw, ph = pages[page].width, pages[page].height
+        regions[name] = {
+            'texture': page_names[page],
+            'uv1': [(x + pad) / pw, (y + pad) / ph],
+            'uv2': [(x + pad + image.width) / pw, (y + pad + image.height) / ph],
+        }
+
+    os.makedirs(args.outdir, exist_ok=True)
+
+    for page_name, image in zip(page_names, pages):
+        save_png(os.path.join(args.outdir, page_name + '.png'), image)
+
+    with open(os.path.join(args.outdir, args.name + '.json'), 'w') as f:
+        json.dump({'pages': page_names, 'regions': regions}, f, indent=1, sort_keys=True)
+
+main()
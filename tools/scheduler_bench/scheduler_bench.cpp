@@ -0,0 +1,262 @@
+#include "scheduler.hpp"
+#include "thread_pool.hpp"
+
+#include <ginseng/ginseng.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// Runs a synthetic world through ember::scheduler, once on a pool without workers and once on a full pool,
+// and reports the speedup. Systems are shaped like scene_gameplay's: independent systems that each own their
+// components and split their entities over the pool, between cheap exclusive systems.
+
+namespace {
+
+using database = ginseng::database;
+using ent_id = database::ent_id;
+
+namespace component {
+
+struct transform {
+    float x, y, angle;
+};
+
+struct locomotion {
+    float target_x, target_y;
+    float duration;
+};
+
+struct sprite {
+    float time;
+    int frame;
+};
+
+struct health {
+    float value, regen;
+};
+
+struct brain {
+    float fear, timer;
+};
+
+} // namespace component
+
+struct options {
+    int entities = 100000;
+    int frames = 60;
+    int work = 16;
+    int threads = int(ember::thread_pool::default_thread_count());
+};
+
+auto parse_options(int argc, char* argv[]) -> options {
+    auto opts = options{};
+
+    for (int i = 1; i < argc; ++i) {
+        auto arg = std::string(argv[i]);
+        auto next = [&]() -> int {
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Missing value for " + arg + ".");
+            }
+            return std::stoi(argv[++i]);
+        };
+
+        if (arg == "--entities") {
+            opts.entities = std::max(next(), 1);
+        } else if (arg == "--frames") {
+            opts.frames = std::max(next(), 1);
+        } else if (arg == "--work") {
+            opts.work = std::max(next(), 1);
+        } else if (arg == "--threads") {
+            opts.threads = std::max(next(), 0);
+        } else {
+            throw std::invalid_argument(
+                "Usage: scheduler_bench [--entities 100000] [--frames 60] [--work 16] [--threads N]");
+        }
+    }
+
+    return opts;
+}
+
+/** Stand-in for per-entity game logic, iterations keeps every system's cost comparable */
+float churn(float value, int iterations) {
+    for (int i = 0; i < iterations; ++i) {
+        value = std::sin(value) * 0.5f + std::cos(value * 1.3f) * 0.5f;
+    }
+    return value;
+}
+
+/**
+ * Same shape as ember::database::parallel_visit(), calls func(coms...) for every match, split over the pool.
+ * The match list is kept by the caller to avoid reallocating every frame.
+ */
+template <typename... Coms, typename F>
+void parallel_visit(
+    database& db, ember::thread_pool& pool, std::vector<std::tuple<Coms*...>>& matches, const F& func) {
+    matches.clear();
+    db.visit([&](Coms&... coms) { matches.emplace_back(&coms...); });
+
+    pool.parallel_for(matches.size(), 256, [&](std::size_t begin, std::size_t end) {
+        for (auto i = begin; i < end; ++i) {
+            std::apply([&](Coms*... coms) { func(*coms...); }, matches[i]);
+        }
+    });
+}
+
+void populate(database& db, int count) {
+    using namespace component;
+
+    for (int i = 0; i < count; ++i) {
+        auto eid = db.create_entity();
+        auto f = float(i);
+
+        db.add_component(eid, transform{std::fmod(f * 0.37f, 100.f), std::fmod(f * 0.73f, 100.f), 0});
+
+        if (i % 2 == 0) {
+            db.add_component(eid, locomotion{std::fmod(f * 1.7f, 100.f), std::fmod(f * 2.9f, 100.f), 1});
+        }
+
+        if (i % 3 != 0) {
+            db.add_component(eid, sprite{std::fmod(f, 7.f), 0});
+        }
+
+        if (i % 4 != 3) {
+            db.add_component(eid, health{50, std::fmod(f, 5.f)});
+        }
+
+        if (i % 5 != 4) {
+            db.add_component(eid, brain{std::fmod(f, 1.f), 0});
+        }
+    }
+}
+
+/** Match lists of the parallel systems, kept between frames like database::parallel_visit()'s */
+struct match_lists {
+    std::vector<std::tuple<component::sprite*>> sprites;
+    std::vector<std::tuple<component::locomotion*, component::transform*>> locomotion;
+    std::vector<std::tuple<component::health*>> health;
+    std::vector<std::tuple<component::brain*>> brains;
+};
+
+void add_systems(ember::scheduler& sched, ember::thread_pool& pool, database& db, match_lists& lists, int work) {
+    using namespace component;
+    using ember::reads;
+    using ember::writes;
+
+    // Stand-in for the scripting system, exclusive and cheap
+    sched.add_exclusive_system("scripting", [](float) {});
+
+    // The four systems below touch disjoint components, so they overlap and each also splits its entities
+
+    sched.add_system("sprite", reads<>{}, writes<sprite>{}, [&, work](float delta) {
+        parallel_visit(db, pool, lists.sprites, [&](sprite& spr) {
+            spr.time += delta;
+            spr.frame = int(std::abs(churn(spr.time, work)) * 8) % 4;
+        });
+    });
+
+    sched.add_system("locomotion", reads<>{}, writes<locomotion, transform>{}, [&, work](float delta) {
+        parallel_visit(db, pool, lists.locomotion, [&](locomotion& loco, transform& tf) {
+            tf.x += (loco.target_x - tf.x) * delta / loco.duration;
+            tf.y += (loco.target_y - tf.y) * delta / loco.duration;
+            tf.angle = churn(std::atan2(loco.target_y - tf.y, loco.target_x - tf.x), work);
+            loco.duration -= delta;
+
+            if (loco.duration <= 0) {
+                loco.target_x = std::fmod(loco.target_x * 1.7f + 13.f, 100.f);
+                loco.target_y = std::fmod(loco.target_y * 2.9f + 31.f, 100.f);
+                loco.duration = 1;
+            }
+        });
+    });
+
+    sched.add_system("health", reads<>{}, writes<health>{}, [&, work](float delta) {
+        parallel_visit(db, pool, lists.health, [&](health& hp) {
+            hp.value = std::min(hp.value + hp.regen * delta + churn(hp.value, work) * 0.01f, 100.f);
+        });
+    });
+
+    sched.add_system("brain", reads<>{}, writes<brain>{}, [&, work](float delta) {
+        parallel_visit(db, pool, lists.brains, [&](brain& br) {
+            br.timer += delta;
+            br.fear = std::abs(churn(br.fear + br.timer, work));
+        });
+    });
+
+    // Stand-in for locomotion_sync and cleanup, exclusive and cheap
+    sched.add_exclusive_system("cleanup", [](float) {});
+}
+
+/** Sums the world's state, parallel and serial runs of the same world must agree exactly */
+double checksum(database& db) {
+    using namespace component;
+
+    auto sum = 0.0;
+    db.visit([&](const transform& tf) { sum += tf.x + tf.y + tf.angle; });
+    db.visit([&](const sprite& spr) { sum += spr.time + spr.frame; });
+    db.visit([&](const health& hp) { sum += hp.value; });
+    db.visit([&](const brain& br) { sum += br.fear; });
+    return sum;
+}
+
+struct result {
+    double ms_per_frame;
+    double checksum;
+};
+
+auto run(const options& opts, unsigned threads) -> result {
+    auto pool = ember::thread_pool(threads);
+    auto db = database{};
+    auto sched = ember::scheduler{};
+    auto lists = match_lists{};
+    constexpr auto delta = 1.f / 60.f;
+
+    populate(db, opts.entities);
+    add_systems(sched, pool, db, lists, opts.work);
+
+    sched.run(pool, delta);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < opts.frames; ++i) {
+        sched.run(pool, delta);
+    }
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+
+    return {elapsed.count() / opts.frames, checksum(db)};
+}
+
+void benchmark(const options& opts) {
+    std::printf("%d entities, %d frames, work %d\n", opts.entities, opts.frames, opts.work);
+
+    auto serial = run(opts, 0);
+    std::printf("%-12s %9.3f ms/frame\n", "serial", serial.ms_per_frame);
+
+    auto parallel = run(opts, unsigned(opts.threads));
+    auto name = std::to_string(opts.threads) + " workers";
+    std::printf("%-12s %9.3f ms/frame\n", name.c_str(), parallel.ms_per_frame);
+
+    std::printf("speedup      %9.2fx\n", serial.ms_per_frame / parallel.ms_per_frame);
+
+    if (serial.checksum != parallel.checksum) {
+        throw std::runtime_error("Parallel run diverged from the serial run.");
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    try {
+        benchmark(parse_options(argc, argv));
+    } catch (const std::exception& e) {
+        std::cerr << "ERROR: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}